@@ -0,0 +1,110 @@
+#include <math.h> /* pow */
+#include <stddef.h> /* ptrdiff_t */
+#include <stdint.h> /* UINT64_C, etc */
+#include <stdio.h> /* printf */
+#include <stdlib.h> /* EXIT_FAILURE, etc */
+#include <string.h> /* memset */
+#include <time.h> /* timespec_get */
+
+#define TPH_POISSON_IMPLEMENTATION
+#include "thinks/tph_poisson.h"
+
+#define NRUNS 9
+
+/*
+ * Benchmark comparing the row-major and tiled grid orders (see tph_poisson_args.grid_order) for
+ * increasingly large 2D and 3D domains. Both orders produce identical samplings, only the time
+ * spent creating them differs. The tiled order improves memory locality of neighbor cells, which
+ * only pays off once the grid is large enough for cache and TLB misses to dominate the cost of
+ * computing cell indices.
+ *
+ * Usage: grid_order [max_cells], where max_cells (default 10^7) is the largest grid tested.
+ */
+
+static double seconds(void)
+{
+  struct timespec ts;
+  timespec_get(&ts, TIME_UTC);
+  return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+/*
+ * Returns the best time out of NRUNS runs, or a negative value on failure. Small grids are
+ * sampled in well under a millisecond, so a single run is easily distorted by noise.
+ */
+static double time_sampling(const int32_t ndims,
+  const tph_poisson_real extent,
+  const int32_t grid_order,
+  ptrdiff_t *nsamples)
+{
+  const tph_poisson_real bounds_min[3] = { 0, 0, 0 };
+  const tph_poisson_real bounds_max[3] = { extent, extent, extent };
+  tph_poisson_args args;
+  memset(&args, 0, sizeof(tph_poisson_args));
+  args.bounds_min = bounds_min;
+  args.bounds_max = bounds_max;
+  args.radius = (tph_poisson_real)1;
+  args.ndims = ndims;
+  args.max_sample_attempts = UINT32_C(30);
+  args.seed = UINT64_C(1981);
+  args.grid_order = grid_order;
+
+  double best = -1.0;
+  for (int i = 0; i < NRUNS; ++i) {
+    tph_poisson_sampling sampling;
+    memset(&sampling, 0, sizeof(tph_poisson_sampling));
+    const double start = seconds();
+    const int ret = tph_poisson_create(&args, /*alloc=*/NULL, &sampling);
+    const double elapsed = seconds() - start;
+    if (ret != TPH_POISSON_SUCCESS) {
+      printf("Failed creating Poisson sampling! Error code: %d\n", ret);
+      return -1.0;
+    }
+    *nsamples = sampling.nsamples;
+    tph_poisson_destroy(&sampling);
+    best = (best < 0.0 || elapsed < best) ? elapsed : best;
+  }
+  return best;
+}
+
+int main(int argc, char *argv[])
+{
+  const double max_cells = argc > 1 ? atof(argv[1]) : 1e7;
+
+  for (int32_t ndims = 2; ndims <= 3; ++ndims) {
+    printf("\n%dD\n", (int)ndims);
+    printf("%12s %12s %12s %12s %8s\n", "cells", "samples", "row-major", "tiled", "ratio");
+    double crossover = -1.0;
+    for (double cells = 1e4; cells <= max_cells * 1.001; cells *= 10) {
+      /* Cell extent is slightly smaller than radius / sqrt(ndims), see tph_poisson_context_init. */
+      const double dx = 0.999 / sqrt((double)ndims);
+      const tph_poisson_real extent = (tph_poisson_real)(pow(cells, 1.0 / ndims) * dx);
+
+      ptrdiff_t nsamples = 0;
+      const double t_row_major =
+        time_sampling(ndims, extent, TPH_POISSON_GRID_ORDER_ROW_MAJOR, &nsamples);
+      const double t_tiled = time_sampling(ndims, extent, TPH_POISSON_GRID_ORDER_TILED, &nsamples);
+      if (t_row_major < 0.0 || t_tiled < 0.0) { return EXIT_FAILURE; }
+
+      printf("%12.0f %12td %11.3fs %11.3fs %8.2f\n",
+        cells,
+        nsamples,
+        t_row_major,
+        t_tiled,
+        t_row_major / t_tiled);
+      /* Smallest size from which the tiled order stays faster for all larger sizes. */
+      if (!(t_tiled < t_row_major)) {
+        crossover = -1.0;
+      } else if (crossover < 0.0) {
+        crossover = cells;
+      }
+    }
+    if (crossover > 0.0) {
+      printf("Tiled grid order is faster from about %.0f cells on.\n", crossover);
+    } else {
+      printf("Row-major grid order is as fast or faster at the largest tested size.\n");
+    }
+  }
+
+  return EXIT_SUCCESS;
+}
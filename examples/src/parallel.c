@@ -0,0 +1,82 @@
+#include <stddef.h> /* ptrdiff_t */
+#include <stdint.h> /* UINT64_C, etc */
+#include <stdio.h> /* printf */
+#include <stdlib.h> /* EXIT_FAILURE, etc */
+#include <string.h> /* memcmp, memset */
+#include <time.h> /* timespec_get */
+
+#define TPH_POISSON_C11_THREADS
+#define TPH_POISSON_IMPLEMENTATION
+#include "thinks/tph_poisson.h"
+
+/*
+ * Creates the same sampling with tph_poisson_create_parallel using an increasing number of C11
+ * threads, and verifies that the samples are the same regardless of the number of threads.
+ *
+ * Usage: parallel [max_threads], where max_threads (default 8) is the largest number of
+ * threads tested.
+ */
+
+static double seconds(void)
+{
+  struct timespec ts;
+  timespec_get(&ts, TIME_UTC);
+  return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+int main(int argc, char *argv[])
+{
+  const int32_t max_threads = argc > 1 ? (int32_t)atoi(argv[1]) : INT32_C(8);
+
+  const tph_poisson_real bounds_min[2] = { (tph_poisson_real)0, (tph_poisson_real)0 };
+  const tph_poisson_real bounds_max[2] = { (tph_poisson_real)1000, (tph_poisson_real)1000 };
+  tph_poisson_args args;
+  memset(&args, 0, sizeof(tph_poisson_args));
+  args.bounds_min = bounds_min;
+  args.bounds_max = bounds_max;
+  args.radius = (tph_poisson_real)1;
+  args.ndims = INT32_C(2);
+  args.max_sample_attempts = UINT32_C(30);
+  args.seed = UINT64_C(1981);
+  args.tile_size = (tph_poisson_real)32;
+
+  tph_poisson_sampling expected;
+  memset(&expected, 0, sizeof(tph_poisson_sampling));
+  int ret = TPH_POISSON_SUCCESS;
+
+  printf("%8s %12s %10s\n", "threads", "samples", "time");
+  for (int32_t nthreads = 1; nthreads <= max_threads; nthreads *= 2) {
+    /* The executor context is the number of threads. */
+    tph_poisson_executor executor = { tph_poisson_c11_threads_run, &nthreads };
+    tph_poisson_sampling sampling;
+    memset(&sampling, 0, sizeof(tph_poisson_sampling));
+    const double start = seconds();
+    ret = tph_poisson_create_parallel(&args, &executor, /*alloc=*/NULL, &sampling);
+    const double elapsed = seconds() - start;
+    if (ret != TPH_POISSON_SUCCESS) {
+      printf("Failed creating Poisson sampling! Error code: %d\n", ret);
+      tph_poisson_destroy(&expected);
+      return EXIT_FAILURE;
+    }
+    printf("%8d %12td %9.3fs\n", (int)nthreads, sampling.nsamples, elapsed);
+
+    if (expected.nsamples == 0) {
+      expected = sampling;
+      continue;
+    }
+    const int same = sampling.nsamples == expected.nsamples
+                     && memcmp(tph_poisson_get_samples(&sampling),
+                          tph_poisson_get_samples(&expected),
+                          (size_t)(sampling.nsamples * sampling.ndims) * sizeof(tph_poisson_real))
+                          == 0;
+    tph_poisson_destroy(&sampling);
+    if (!same) {
+      printf("Samples depend on the number of threads!\n");
+      tph_poisson_destroy(&expected);
+      return EXIT_FAILURE;
+    }
+  }
+
+  tph_poisson_destroy(&expected);
+  return EXIT_SUCCESS;
+}
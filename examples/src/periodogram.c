@@ -46,7 +46,7 @@ static void fft_shift(const int n0, const int n1, double *inout)
 }
 
 static void sampling_image(const tph_poisson_args *args,
-  const tph_poisson_sampling *s,
+  const tph_poisson_sampler *s,
   const int n0,
   const int n1,
   fftw_complex *img)
@@ -58,7 +58,7 @@ static void sampling_image(const tph_poisson_args *args,
     img[i][1] = 0.0;
   }
 
-  const double *p = tph_poisson_get_samples(s);
+  const double *p = tph_poisson_sampler_get_samples(s);
   if (p == NULL) { abort(); }
 
   const ptrdiff_t nsamples = s->nsamples;
@@ -135,17 +135,20 @@ int main(int argc, char *argv[])
     (tph_poisson_real)128, (tph_poisson_real)128 };
   /* clang-format on */
 
-  /* Configure tph_poisson arguments. Set varying seed later. */
-  tph_poisson_args args = { .bounds_min = bounds_min,
+  /* Configure tph_poisson arguments. The seed is provided for each image later. */
+  const tph_poisson_args args = { .bounds_min = bounds_min,
     .bounds_max = bounds_max,
     .radius = (tph_poisson_real)1,
     .ndims = INT32_C(2),
-    .max_sample_attempts = UINT32_C(30),
-    .seed = UINT64_C(1981) };
-
-  /* Initialize empty tph_poisson sampling. */
-  tph_poisson_sampling sampling;
-  memset(&sampling, 0, sizeof(tph_poisson_sampling));
+    .max_sample_attempts = UINT32_C(30) };
+
+  /* Create a sampler that keeps its buffers between images. Using default allocator (libc
+   * malloc). */
+  tph_poisson_sampler sampler;
+  memset(&sampler, 0, sizeof(tph_poisson_sampler));
+  if (tph_poisson_sampler_create(&args, /*alloc=*/NULL, &sampler) != TPH_POISSON_SUCCESS) {
+    abort();
+  }
 
   /* Initlialize buffers used to accumulate the average periodogram. */
   double *periodogram = (double *)malloc((size_t)n0 * (size_t)n1 * sizeof(double));
@@ -158,14 +161,11 @@ int main(int argc, char *argv[])
 
   const double scale = 1. / (double)image_count;
   for (int i = 0; i < image_count; ++i) {
-    /* Vary the seed for each image. */
-    args.seed = (uint64_t)i;
-
-    /* Populate sampling with points. Using default allocator (libc malloc). */
-    if (tph_poisson_create(&args, /*alloc=*/NULL, &sampling) != TPH_POISSON_SUCCESS) { abort(); }
+    /* Populate sampler with points, varying the seed for each image. */
+    if (tph_poisson_sampler_run(&sampler, (uint64_t)i) != TPH_POISSON_SUCCESS) { abort(); }
 
     /* Construct FFT input from sampling. */
-    sampling_image(&args, &sampling, n0, n1, in);
+    sampling_image(&args, &sampler, n0, n1, in);
 
     /* Perform FFT. */
     fftw_execute(plan);
@@ -183,7 +183,7 @@ int main(int argc, char *argv[])
   free(in);
   free(out);
   free(periodogram);
-  tph_poisson_destroy(&sampling);
+  tph_poisson_sampler_destroy(&sampler);
 
   return EXIT_SUCCESS;
 }
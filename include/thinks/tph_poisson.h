@@ -7,7 +7,7 @@
 #define TPH_POISSON_H
 
 #define TPH_POISSON_MAJOR_VERSION 0
-#define TPH_POISSON_MINOR_VERSION 4
+#define TPH_POISSON_MINOR_VERSION 5
 #define TPH_POISSON_PATCH_VERSION 0
 
 #include <stddef.h> /* size_t, ptrdiff_t, NULL */
@@ -44,29 +44,113 @@ typedef TPH_POISSON_REAL_TYPE tph_poisson_real;
 
 typedef struct tph_poisson_args_              tph_poisson_args;
 typedef struct tph_poisson_allocator_         tph_poisson_allocator;
+typedef struct tph_poisson_executor_          tph_poisson_executor;
+typedef struct tph_poisson_stream_            tph_poisson_stream;
 typedef struct tph_poisson_sampling_          tph_poisson_sampling;
 typedef struct tph_poisson_sampling_internal_ tph_poisson_sampling_internal;
+typedef struct tph_poisson_sampler_           tph_poisson_sampler;
+typedef struct tph_poisson_sampler_internal_  tph_poisson_sampler_internal;
+typedef struct tph_poisson_tiler_             tph_poisson_tiler;
+typedef struct tph_poisson_tiler_internal_    tph_poisson_tiler_internal;
 
 typedef void *(*tph_poisson_malloc_fn)(ptrdiff_t size, void *ctx);
 typedef void (*tph_poisson_free_fn)(void *ptr, ptrdiff_t size, void *ctx);
+typedef void *(*tph_poisson_realloc_fn)(void *ptr,
+                                        ptrdiff_t size,
+                                        ptrdiff_t new_size,
+                                        void *ctx);
+typedef void *(*tph_poisson_calloc_fn)(ptrdiff_t size, void *ctx);
+typedef void *(*tph_poisson_aligned_malloc_fn)(ptrdiff_t size,
+                                               ptrdiff_t alignment,
+                                               int32_t purpose,
+                                               void *ctx);
+typedef void (*tph_poisson_aligned_free_fn)(void *ptr,
+                                            ptrdiff_t size,
+                                            int32_t purpose,
+                                            void *ctx);
+typedef void (*tph_poisson_task_fn)(void *task_ctx, ptrdiff_t task_index);
+typedef void (*tph_poisson_stream_fn)(const tph_poisson_real *samples,
+                                      ptrdiff_t nsamples,
+                                      void *ctx);
+typedef void (*tph_poisson_run_fn)(tph_poisson_task_fn task,
+                                   void *task_ctx,
+                                   ptrdiff_t ntasks,
+                                   void *ctx);
 /* clang-format on */
 
 #pragma pack(push, 1)
 
 /**
- * Allocator interface. Must provide malloc and free functions.
- * Context is optional and may be NULL.
+ * Allocator interface. Must provide malloc and free functions, or aligned_malloc and aligned_free
+ * functions. Context is optional and may be NULL. Optional functions that are not used must be
+ * NULL, so allocators should be zero-initialized before setting the functions that are used.
+ *
+ * The realloc function is optional and must be NULL if not used. If provided, it is used to grow
+ * and trim sample buffers, which may then be resized in place instead of being copied to a new
+ * buffer. It must behave like realloc in libc, i.e. return a buffer of new_size bytes holding the
+ * first min(size, new_size) bytes of ptr, or NULL on failure in which case ptr is left untouched.
+ * It is never called with a NULL ptr or a zero new_size. The returned buffer needs no particular
+ * alignment, same as for the malloc function.
+ *
+ * The calloc function is optional and must be NULL if not used. If provided, it is used for the
+ * grid and other buffers that start out zeroed, which are then not written before sampling. It
+ * must return size bytes set to zero, or NULL on failure, and the memory is freed with the free
+ * function. Memory from fresh pages (e.g. mmap on Linux) is zeroed by the system and only
+ * touched when first used, which makes setting up large grids with few samples cheap.
+ *
+ * The aligned_malloc and aligned_free functions are optional and must both be NULL if not used.
+ * If provided, they are used for all memory instead of the other functions, which are then
+ * ignored. Each allocation is tagged with its purpose, one of the TPH_POISSON_ALLOC_* values,
+ * so that e.g. the grid can be placed in huge pages and the samples in NUMA-local memory. The
+ * returned buffer must hold size bytes aligned to alignment, a power of two, or be NULL on
+ * failure. Stricter alignment is fine. If TPH_POISSON_ALLOC_ZEROED is set in purpose, the
+ * memory must be zeroed. Memory is freed with aligned_free, which is passed the same size and
+ * purpose, without TPH_POISSON_ALLOC_ZEROED.
  */
 struct tph_poisson_allocator_
 {
   tph_poisson_malloc_fn malloc;
   tph_poisson_free_fn free;
   void *ctx;
+  tph_poisson_realloc_fn realloc;
+  tph_poisson_calloc_fn calloc;
+  tph_poisson_aligned_malloc_fn aligned_malloc;
+  tph_poisson_aligned_free_fn aligned_free;
+};
+
+/**
+ * Executor interface, used by tph_poisson_create_parallel to run tasks. The run function must
+ * call task(task_ctx, i) exactly once for each i in [0, ntasks), in any order and possibly
+ * concurrently, and return when all calls have returned. Context is optional and may be NULL.
+ */
+struct tph_poisson_executor_
+{
+  tph_poisson_run_fn run;
+  void *ctx;
+};
+
+/**
+ * Stream interface, used by tph_poisson_create_stream to pass samples to the caller while
+ * sampling. The samples function is called with consecutive chunks of accepted samples, in the
+ * order they were accepted, each chunk holding chunk_size samples except possibly the last one.
+ * The samples are stored as for tph_poisson_get_samples and are only valid during the call.
+ * When zero, chunk_size defaults to TPH_POISSON_STREAM_CHUNK_SIZE (1024 unless overridden when
+ * compiling the implementation), set it to 1 for a call per sample. If retain_samples is zero,
+ * samples are not kept after they have been passed to the samples function. Context is optional
+ * and may be NULL.
+ */
+struct tph_poisson_stream_
+{
+  tph_poisson_stream_fn samples;
+  void *ctx;
+  ptrdiff_t chunk_size;
+  int32_t retain_samples;
 };
 
 /**
  * Parameters used when creating a Poisson disk sampling.
  * bounds_min/max are assumed to point to arrays of length ndims.
+ * Zero-initialized optional parameters select the default behavior.
  */
 struct tph_poisson_args_
 {
@@ -76,6 +160,55 @@ struct tph_poisson_args_
   tph_poisson_real radius;
   int32_t ndims;
   uint32_t max_sample_attempts;
+
+  /* Optional. Method used to generate candidates around active samples, one of the
+   * TPH_POISSON_CANDIDATES_* values. Different methods give different samplings for the
+   * same seed. */
+  int32_t candidate_method;
+
+  /* Optional. Candidates are generated at distances [radius, annulus_outer_factor * radius]
+   * from active samples. Must be finite and > 1 when set. When zero, defaults to 2, or to
+   * 1.001 for TPH_POISSON_CANDIDATES_ANGULAR. */
+  tph_poisson_real annulus_outer_factor;
+
+  /* Optional. What the background grid stores in its cells, one of the TPH_POISSON_GRID_*
+   * values. Does not affect the resulting sampling. */
+  int32_t grid_storage;
+
+  /* Optional. How grid cells are ordered in memory, one of the TPH_POISSON_GRID_ORDER_* values.
+   * Does not affect the resulting sampling. */
+  int32_t grid_order;
+
+  /* Optional. Maximum size in bytes of a dense background grid, must not be negative. Larger
+   * grids are sparse: cells are stored in fixed-size pages that are allocated when a sample
+   * first lands in them, so that memory use follows the number of samples rather than the
+   * size of the bounds. When zero, defaults to TPH_POISSON_GRID_MAX_DENSE_SIZE (1 GiB unless
+   * overridden when compiling the implementation). Does not affect the resulting sampling. */
+  ptrdiff_t grid_max_dense_size;
+
+  /* Optional. Number of candidates generated together for an active sample, before any of
+   * them are tested against existing samples. Candidates are still tested in the order they
+   * were generated and the first valid one is accepted, so the resulting sampling does not
+   * depend on the batch size. Values larger than max_sample_attempts, or larger than 1024, are
+   * clamped. When zero, defaults to TPH_POISSON_CANDIDATE_BATCH_SIZE (1, i.e. no batching,
+   * unless overridden when compiling the implementation). */
+  uint32_t candidate_batch_size;
+
+  /* Optional. Pseudo-random number generator, one of the TPH_POISSON_PRNG_* values. Different
+   * generators give different samplings for the same seed. */
+  int32_t prng;
+
+  /* Optional. Only used by tph_poisson_create_parallel and tph_poisson_tiler_create. Side length
+   * of the cubic tiles that the bounds, or the unbounded space, are divided into. Must be at
+   * least the outer annulus radius (see annulus_outer_factor) when set. Different tile sizes give
+   * different samplings for the same seed. When zero, defaults to 8 times the outer annulus
+   * radius. */
+  tph_poisson_real tile_size;
+
+  /* Optional. How samples are laid out in memory, one of the TPH_POISSON_LAYOUT_* values. Only
+   * tph_poisson_create and tph_poisson_create_parallel support layouts other than the default.
+   * Does not affect the resulting sampling. */
+  int32_t output_layout;
 };
 
 /**
@@ -88,6 +221,33 @@ struct tph_poisson_sampling_
   tph_poisson_sampling_internal *internal;
   ptrdiff_t nsamples;
   int32_t ndims;
+  ptrdiff_t soa_stride; /** Values between dimension arrays in the SoA layout, otherwise zero. */
+};
+
+/**
+ * Reusable state for creating many samplings with the same arguments but different seeds, see
+ * tph_poisson_sampler_create. Use with tph_poisson_sampler_get_samples to retrieve the sample
+ * positions of the last run. Memory must be freed after use by calling
+ * tph_poisson_sampler_destroy.
+ */
+struct tph_poisson_sampler_
+{
+  tph_poisson_sampler_internal *internal;
+  ptrdiff_t nsamples; /** Number of samples from the last successful run, otherwise zero. */
+  int32_t ndims;
+};
+
+/**
+ * Reusable state for sampling tiles of unbounded space one at a time, see
+ * tph_poisson_tiler_create. Use with tph_poisson_tiler_get_samples to retrieve the sample
+ * positions of the last tile. Memory must be freed after use by calling tph_poisson_tiler_destroy.
+ */
+struct tph_poisson_tiler_
+{
+  tph_poisson_tiler_internal *internal;
+  ptrdiff_t nsamples; /** Number of samples in the last successfully sampled tile, else zero. */
+  int32_t ndims;
+  tph_poisson_real tile_size; /** Side length of the cubic tiles. */
 };
 
 #pragma pack(pop)
@@ -99,6 +259,101 @@ struct tph_poisson_sampling_
 #define TPH_POISSON_BAD_ALLOC     1
 #define TPH_POISSON_INVALID_ARGS  2
 #define TPH_POISSON_OVERFLOW      3
+#define TPH_POISSON_TRUNCATED     4
+
+/* Candidate generation methods, see tph_poisson_args.candidate_method. Unless noted otherwise,
+ * methods produce candidates uniformly distributed in the annulus
+ * [radius, annulus_outer_factor * radius] around an active sample.
+ *   REJECTION - Draw points in a cube and reject points outside the annulus. Default.
+ *               The acceptance rate drops quickly with the number of dimensions.
+ *   POLAR     - Direct polar (2D) or spherical (3D) mapping, no rejections. Only
+ *               valid when ndims is 2 or 3.
+ *   GAUSSIAN  - Normalized Gaussian direction and inverse-CDF radius, no rejections.
+ *               Valid for any ndims, recommended for ndims > 3.
+ *   ANGULAR   - Candidates on the circle of radius annulus_outer_factor * radius, starting
+ *               at a random angle and stepping 2 * pi / max_sample_attempts radians per
+ *               attempt (Roberts' variant of Bridson's algorithm). Gives denser samplings
+ *               with fewer attempts. Only valid when ndims is 2. */
+#define TPH_POISSON_CANDIDATES_REJECTION  0
+#define TPH_POISSON_CANDIDATES_POLAR      1
+#define TPH_POISSON_CANDIDATES_GAUSSIAN   2
+#define TPH_POISSON_CANDIDATES_ANGULAR    3
+
+/* Grid storage modes, see tph_poisson_args.grid_storage. Each grid cell holds at most one sample.
+ *   INDICES - Cells store sample indices, 16, 32 or 64 bits wide, whichever is the smallest
+ *             width that holds the largest possible number of samples (see
+ *             tph_poisson_max_samples). Default, smallest grid. Empty cells are zero, so the
+ *             grid needs no initialization if the allocator provides zeroed memory. Distance
+ *             checks read sample positions from a separate buffer.
+ *   POINTS  - Cells store sample positions inline, empty cells are NaN. Distance checks only
+ *             touch grid memory, at the cost of ndims * sizeof(tph_poisson_real) bytes per
+ *             cell. Pays off in 2D, where most cells are occupied, but is slower in higher
+ *             dimensions, where most neighbor cells are empty and the larger cells mostly add
+ *             cache misses. Requires IEEE NaN semantics (e.g. no -ffinite-math-only). */
+#define TPH_POISSON_GRID_INDICES  0
+#define TPH_POISSON_GRID_POINTS   1
+
+/* Grid cell orders, see tph_poisson_args.grid_order.
+ *   ROW_MAJOR - Cells are ordered with the first axis varying fastest. Default. Neighbor cells
+ *               along the other axes are far apart in memory for large grids.
+ *   TILED     - Cells are grouped into tiles of 16x16 (2D) or 8x8x8 (3D) cells, with Z-order
+ *               (Morton) inside tiles and row-major order between tiles. Neighbor cells are
+ *               close in memory, but cell indices are more expensive to compute. Only pays
+ *               off for very large grids, see the grid_order example for measuring the
+ *               crossover. The grid is padded to a whole number of tiles. Only valid when
+ *               ndims is 2 or 3. */
+#define TPH_POISSON_GRID_ORDER_ROW_MAJOR  0
+#define TPH_POISSON_GRID_ORDER_TILED      1
+
+/* Pseudo-random number generators, see tph_poisson_args.prng. For a given seed, every generator
+ * produces the same sequence, and thus the same sampling, on every run and platform (assuming
+ * IEEE floating point arithmetic and the same math library).
+ *   XOSHIRO256P    - A single xoshiro256+ stream seeded with SplitMix64. Default.
+ *   XOSHIRO256P_X4 - Four xoshiro256+ streams, stepped together so that the compiler can
+ *                    vectorize them. Streams are seeded in order from the same SplitMix64
+ *                    sequence, so the first stream is the same as for XOSHIRO256P. Values are
+ *                    used in stream order, i.e. value k comes from stream (k % 4). Candidate
+ *                    offsets are computed in tph_poisson_real precision, using 24 random bits
+ *                    per coordinate for float. Gives different samplings than XOSHIRO256P for
+ *                    the same seed. */
+#define TPH_POISSON_PRNG_XOSHIRO256P     0
+#define TPH_POISSON_PRNG_XOSHIRO256P_X4  1
+
+/* Sample layouts, see tph_poisson_args.output_layout.
+ *   AOS - Coordinates of each sample are stored together, i.e. x0 y0 z0 x1 y1 z1 ... Default.
+ *   SOA - One array per dimension, i.e. x0 x1 ... y0 y1 ... z0 z1 ... Coordinate i of sample j
+ *         is at index i * sampling.soa_stride + j. Each array starts at a 64-byte aligned
+ *         address and is padded with zeros to soa_stride values. Samples are transposed when
+ *         moved to their final buffer at the end of sampling, which costs about as much as the
+ *         copy that releases unused capacity in the AOS layout. */
+#define TPH_POISSON_LAYOUT_AOS  0
+#define TPH_POISSON_LAYOUT_SOA  1
+
+/* Quantized sample formats, see tph_poisson_quantize. Each coordinate is stored relative to the
+ * bounds, as t = (x - bounds_min[i]) / (bounds_max[i] - bounds_min[i]) in [0, 1].
+ *   U16 - uint16_t holding round(t * 65535). Error at most extent / 131070 per coordinate.
+ *   U32 - uint32_t holding round(t * 4294967295). Error at most extent / 8589934590 per
+ *         coordinate, less than the precision of float samples.
+ *   F16 - IEEE 754 half precision bits (binary16) of t, stored in a uint16_t. Error at most
+ *         extent / 4096 per coordinate, smaller for coordinates close to bounds_min. */
+#define TPH_POISSON_QUANTIZE_U16  0
+#define TPH_POISSON_QUANTIZE_U32  1
+#define TPH_POISSON_QUANTIZE_F16  2
+
+/* Allocation purposes, see tph_poisson_allocator.aligned_malloc.
+ *   OTHER   - Bookkeeping and scratch arrays used while sampling. Small.
+ *   GRID    - Dense background grid, or a page of a sparse grid. Large and accessed at random,
+ *             a candidate sample probes the cells around it.
+ *   SAMPLES - Sample positions, appended to in order. Holds the output of a sampling, and the
+ *             samples of each tile while sampling in parallel.
+ *   ACTIVE  - Active list, grid indices of samples that may still spawn candidates. Appended
+ *             to and erased from at random.
+ *   ZEROED  - Flag, set in addition to the purpose when the memory must be zeroed. */
+#define TPH_POISSON_ALLOC_OTHER    0
+#define TPH_POISSON_ALLOC_GRID     1
+#define TPH_POISSON_ALLOC_SAMPLES  2
+#define TPH_POISSON_ALLOC_ACTIVE   3
+#define TPH_POISSON_ALLOC_ZEROED   0x100
 
 /* clang-format on */
 
@@ -118,8 +373,16 @@ struct tph_poisson_sampling_
  *   - args.ndims is < 1, or
  *   - args.bounds_min[i] >= args.bounds_max[i], or
  *   - args.max_sample_attempts == 0, or
+ *   - args.candidate_method is not a valid method for args.ndims, or
+ *   - args.annulus_outer_factor is not zero and <= 1, or
+ *   - args.grid_storage is not a valid grid storage mode, or
+ *   - args.grid_order is not a valid grid order for args.ndims, or
+ *   - args.grid_max_dense_size is < 0, or
+ *   - args.prng is not a valid pseudo-random number generator, or
+ *   - args.output_layout is not a valid layout, or
  *   - an invalid allocator is provided.
- *   TPH_POISSON_OVERFLOW - The number of samples exceeds the maximum number.
+ *   TPH_POISSON_OVERFLOW - The number of samples exceeds the maximum number, or the number of
+ *   grid cells needed to cover the bounds cannot be represented.
  *
  * Note that when an error is returned the sampling doesn't need to be destroyed
  * using the tph_poisson_destroy function.
@@ -133,6 +396,400 @@ extern int tph_poisson_create(const tph_poisson_args *args,
   const tph_poisson_allocator *alloc,
   tph_poisson_sampling *sampling);
 
+/**
+ * Same as tph_poisson_create, but accepted samples are also passed to the stream's samples
+ * function in chunks while sampling, so that consuming samples can overlap with generating them.
+ * For a given seed the samples are the same as for tph_poisson_create, in the same order.
+ *
+ * If stream.retain_samples is non-zero the sampling holds all samples afterwards, same as for
+ * tph_poisson_create. Otherwise only the grid keeps sample positions, args.grid_storage is
+ * ignored and cells always store points, and sample memory is limited to one chunk. The sampling
+ * then holds no samples, sampling.nsamples is the number of samples passed to the stream and
+ * tph_poisson_get_samples returns NULL.
+ *
+ * If an error is returned, the samples accepted before the error may have been passed to the
+ * stream.
+ *
+ * Errors:
+ *   Same as tph_poisson_create. Additionally, the arguments are invalid if:
+ *   - stream is null, or stream.samples is null, or
+ *   - stream.chunk_size is < 0, or
+ *   - stream.retain_samples is zero and args.output_layout is not TPH_POISSON_LAYOUT_AOS.
+ *
+ * @param args     Arguments.
+ * @param stream   Stream, not used after this call returns.
+ * @param alloc    Optional custom allocator (may be null).
+ * @param sampling Sampling to store samples.
+ * @return TPH_POISSON_SUCCESS if no errors; otherwise a non-zero error code.
+ */
+extern int tph_poisson_create_stream(const tph_poisson_args *args,
+  const tph_poisson_stream *stream,
+  const tph_poisson_allocator *alloc,
+  tph_poisson_sampling *sampling);
+
+/**
+ * Same as tph_poisson_create, but samples are written directly to a buffer provided by the
+ * caller, which holds at most max_samples samples, i.e. max_samples * args.ndims values. Samples
+ * are neither copied nor reallocated, the allocator is only used for the grid and other
+ * temporary buffers. A buffer large enough to never be truncated can be sized using
+ * tph_poisson_max_samples.
+ *
+ * If the buffer is full before sampling completes, sampling stops and TPH_POISSON_TRUNCATED is
+ * returned. The buffer then holds the first max_samples samples that tph_poisson_create would
+ * have given, which satisfy the same guarantees but do not cover the whole region.
+ *
+ * Errors:
+ *   Same as tph_poisson_create. Additionally, the arguments are invalid if:
+ *   - args.output_layout is not TPH_POISSON_LAYOUT_AOS, or
+ *   - max_samples is < 0, or
+ *   - samples is null and max_samples is > 0, or
+ *   - nsamples is null.
+ *   TPH_POISSON_TRUNCATED - The buffer is too small to hold all samples.
+ *
+ * @param args        Arguments.
+ * @param alloc       Optional custom allocator (may be null).
+ * @param samples     Buffer to store samples.
+ * @param max_samples Maximum number of samples that fit in the buffer.
+ * @param nsamples    Number of samples written to the buffer, zero on errors other than
+ *                    TPH_POISSON_TRUNCATED.
+ * @return TPH_POISSON_SUCCESS if no errors; otherwise a non-zero error code.
+ */
+extern int tph_poisson_create_into(const tph_poisson_args *args,
+  const tph_poisson_allocator *alloc,
+  tph_poisson_real *samples,
+  ptrdiff_t max_samples,
+  ptrdiff_t *nsamples);
+
+/**
+ * Computes an upper bound for the number of samples created for the provided arguments, for any
+ * seed. No two samples are closer than args.radius, so balls of radius args.radius / 2 centered
+ * at the samples do not overlap and fit in the bounds grown by the same amount, which bounds the
+ * number of samples by a ratio of volumes. Each sample also has its own grid cell, which gives a
+ * tighter bound for very small bounds. The bound is about 2 times the actual number of samples
+ * in 2D and 4 times in 3D, and much less tight in higher dimensions. args.seed and
+ * args.max_sample_attempts are ignored.
+ *
+ * Errors:
+ *   TPH_POISSON_INVALID_ARGS - Same as tph_poisson_create, or max_samples is null.
+ *   TPH_POISSON_OVERFLOW - The number of grid cells needed to cover the bounds cannot be
+ *   represented.
+ *
+ * @param args        Arguments.
+ * @param max_samples Upper bound for the number of samples.
+ * @return TPH_POISSON_SUCCESS if no errors; otherwise a non-zero error code.
+ */
+extern int tph_poisson_max_samples(const tph_poisson_args *args, ptrdiff_t *max_samples);
+
+/**
+ * Estimates the number of samples created for the provided arguments, i.e. the expected number
+ * over seeds. The estimate is based on the packing density of random sequential addition in
+ * args.ndims dimensions, which is the density Bridson's algorithm approaches as
+ * args.max_sample_attempts grows, scaled down for fewer attempts. Samples near the boundary are
+ * accounted for by growing the bounds by args.radius / 4. The estimate is within about 10% of the
+ * actual number of samples for bounds spanning many radii and 10 or more attempts, and is never
+ * larger than the bound given by tph_poisson_max_samples. With very few attempts sampling may
+ * stop early, in which case there are fewer samples than estimated. args.seed is ignored.
+ *
+ * Errors:
+ *   Same as tph_poisson_max_samples.
+ *
+ * @param args     Arguments.
+ * @param nsamples Estimated number of samples, at least one.
+ * @return TPH_POISSON_SUCCESS if no errors; otherwise a non-zero error code.
+ */
+extern int tph_poisson_estimate_samples(const tph_poisson_args *args, ptrdiff_t *nsamples);
+
+/**
+ * Computes the number of bytes needed by tph_poisson_create_in_arena for the provided arguments
+ * and sample cap. This is the worst case over all seeds, i.e. the grid, the active sample list
+ * and the sample buffer sized for max_samples samples, and for sparse grids (see
+ * args.grid_max_dense_size) one grid page per sample. args.seed is ignored.
+ *
+ * Errors:
+ *   Same as tph_poisson_max_samples. Additionally, the arguments are invalid if:
+ *   - max_samples is < 0, or
+ *   - nbytes is null.
+ *   TPH_POISSON_OVERFLOW - The number of bytes cannot be represented.
+ *
+ * @param args        Arguments.
+ * @param max_samples Maximum number of samples, zero for the bound given by
+ *                    tph_poisson_max_samples, which is also used if it is smaller.
+ * @param nbytes      Number of bytes needed.
+ * @return TPH_POISSON_SUCCESS if no errors; otherwise a non-zero error code.
+ */
+extern int tph_poisson_query_memory(const tph_poisson_args *args,
+  ptrdiff_t max_samples,
+  ptrdiff_t *nbytes);
+
+/**
+ * Same as tph_poisson_create, but all memory is taken from an arena provided by the caller,
+ * which must hold at least the number of bytes given by tph_poisson_query_memory for the same
+ * arguments and sample cap. All buffers are sized up front, no allocator is called and sampling
+ * never grows or copies buffers. The arena needs no particular alignment.
+ *
+ * The sampling refers to memory in the arena, which must be kept alive until the sampling is
+ * destroyed. Destroying the sampling does not free anything, after that the arena may be reused.
+ *
+ * If max_samples samples are created before sampling completes, sampling stops and
+ * TPH_POISSON_TRUNCATED is returned, in which case the sampling holds the first max_samples
+ * samples that tph_poisson_create would have given (see tph_poisson_create_into) and must be
+ * destroyed.
+ *
+ * Errors:
+ *   Same as tph_poisson_query_memory. Additionally, the arguments are invalid if:
+ *   - args.output_layout is not TPH_POISSON_LAYOUT_AOS, or
+ *   - arena_size is < 0, or
+ *   - arena is null and arena_size is > 0, or
+ *   - sampling is null.
+ *   TPH_POISSON_BAD_ALLOC - The arena is smaller than the number of bytes needed, checked before
+ *   sampling starts.
+ *   TPH_POISSON_TRUNCATED - Sampling stopped at max_samples samples.
+ *
+ * @param args        Arguments.
+ * @param arena       Memory used for all buffers.
+ * @param arena_size  Number of bytes in the arena.
+ * @param max_samples Maximum number of samples, see tph_poisson_query_memory.
+ * @param sampling    Sampling to store samples.
+ * @return TPH_POISSON_SUCCESS if no errors; otherwise a non-zero error code.
+ */
+extern int tph_poisson_create_in_arena(const tph_poisson_args *args,
+  void *arena,
+  ptrdiff_t arena_size,
+  ptrdiff_t max_samples,
+  tph_poisson_sampling *sampling);
+
+/**
+ * Same as tph_poisson_create, but divides the bounds into tiles (see args.tile_size) that are
+ * sampled as independent tasks, which may run concurrently. Tiles are processed in up to 2^ndims
+ * phases, grouped by the parity of their tile coordinates along each axis, so that tiles in the
+ * same phase are never adjacent and never write grid cells that another one reads. Each tile
+ * starts from the samples of its already sampled neighbors and has its own pseudo-random number
+ * generator, seeded from args.seed and the tile index. For a given seed and tile size the
+ * resulting sampling is therefore the same regardless of how many threads run the tasks and in
+ * which order. The sampling differs from the one given by tph_poisson_create, and samples are
+ * ordered by tile.
+ *
+ * Cells always store points and the grid is always dense, args.grid_storage,
+ * args.grid_max_dense_size and args.candidate_batch_size are ignored. If tasks run
+ * concurrently the allocator must be thread-safe.
+ *
+ * Errors:
+ *   Same as tph_poisson_create. Additionally, the arguments are invalid if:
+ *   - args.tile_size is not zero and less than the outer annulus radius, or
+ *   - an executor without a run function is provided.
+ *
+ * @param sampling Sampling to store samples.
+ * @param args     Arguments.
+ * @param executor Optional executor (may be null), if null tasks are run one at a time on the
+ *                 calling thread.
+ * @param alloc    Optional custom allocator (may be null).
+ * @return TPH_POISSON_SUCCESS if no errors; otherwise a non-zero error code.
+ */
+extern int tph_poisson_create_parallel(const tph_poisson_args *args,
+  const tph_poisson_executor *executor,
+  const tph_poisson_allocator *alloc,
+  tph_poisson_sampling *sampling);
+
+#ifdef TPH_POISSON_C11_THREADS
+/**
+ * Run function for tph_poisson_executor that runs tasks on C11 threads. The executor context
+ * must point to an int32_t holding the number of threads to use, including the calling thread.
+ * Only available if TPH_POISSON_C11_THREADS is defined, both where the implementation is
+ * compiled and where this function is called.
+ */
+extern void tph_poisson_c11_threads_run(tph_poisson_task_fn task,
+  void *task_ctx,
+  ptrdiff_t ntasks,
+  void *ctx);
+#endif
+
+/**
+ * Initializes a sampler, which creates samplings for the provided arguments using
+ * tph_poisson_sampler_run. The grid, the active sample list and the sample buffer are allocated
+ * once and kept between runs. Between runs only the grid cells holding samples are reset, which
+ * avoids most of the allocation and initialization cost of tph_poisson_create when many samplings
+ * of small domains are created. For a given seed a run gives the same samples as
+ * tph_poisson_create. args.seed is ignored, the seed is provided for each run instead.
+ *
+ * Errors:
+ *   Same as tph_poisson_create, except that the number of samples is not checked. Additionally,
+ *   the arguments are invalid if args.output_layout is not TPH_POISSON_LAYOUT_AOS.
+ *
+ * Note that when an error is returned the sampler doesn't need to be destroyed using the
+ * tph_poisson_sampler_destroy function.
+ *
+ * @param args    Arguments, not used after this call returns.
+ * @param alloc   Optional custom allocator (may be null).
+ * @param sampler Sampler to initialize.
+ * @return TPH_POISSON_SUCCESS if no errors; otherwise a non-zero error code.
+ */
+extern int tph_poisson_sampler_create(const tph_poisson_args *args,
+  const tph_poisson_allocator *alloc,
+  tph_poisson_sampler *sampler);
+
+/**
+ * Creates a sampling using the arguments given when the sampler was created and the provided
+ * seed. Samples from previous runs are discarded, pointers returned by
+ * tph_poisson_sampler_get_samples before this call are invalidated. Same as
+ * tph_poisson_sampler_begin followed by a single tph_poisson_sampler_step without a limit.
+ *
+ * Errors:
+ *   TPH_POISSON_BAD_ALLOC - Failed memory allocation.
+ *   TPH_POISSON_INVALID_ARGS - The sampler has not been initialized.
+ *   TPH_POISSON_OVERFLOW - The number of samples exceeds the maximum number.
+ *
+ * When an error is returned the sampler has no samples, but may be run again.
+ *
+ * @param sampler Sampler.
+ * @param seed    Seed.
+ * @return TPH_POISSON_SUCCESS if no errors; otherwise a non-zero error code.
+ */
+extern int tph_poisson_sampler_run(tph_poisson_sampler *sampler, uint64_t seed);
+
+/**
+ * Begins a sampling using the arguments given when the sampler was created and the provided
+ * seed, without generating any samples. Samples are then generated in steps of bounded work by
+ * calling tph_poisson_sampler_step until it reports that sampling is done, e.g. once per frame.
+ * Samples from previous runs are discarded, pointers returned by tph_poisson_sampler_get_samples
+ * before this call are invalidated.
+ *
+ * Errors:
+ *   TPH_POISSON_INVALID_ARGS - The sampler has not been initialized.
+ *
+ * @param sampler Sampler.
+ * @param seed    Seed.
+ * @return TPH_POISSON_SUCCESS if no errors; otherwise a non-zero error code.
+ */
+extern int tph_poisson_sampler_begin(tph_poisson_sampler *sampler, uint64_t seed);
+
+/**
+ * Continues the sampling begun by tph_poisson_sampler_begin, testing about max_attempts
+ * candidates before returning. Candidates are tested in the same order as for
+ * tph_poisson_sampler_run, so once done the samples are the same as for a run with the same seed,
+ * regardless of the number of steps. An active sample gets all its attempts within one step, so a
+ * step may test up to args.max_sample_attempts - 1 more candidates than max_attempts, and always
+ * makes progress. The first step also places the first sample.
+ *
+ * After each step, sampler.nsamples and tph_poisson_sampler_get_samples give the samples created
+ * so far, which the next step only appends to. The next step may move the samples, which
+ * invalidates pointers returned by tph_poisson_sampler_get_samples before it.
+ *
+ * Errors:
+ *   TPH_POISSON_BAD_ALLOC - Failed memory allocation.
+ *   TPH_POISSON_INVALID_ARGS - The arguments are invalid if:
+ *   - the sampler has not been initialized, or no sampling has been begun since the sampler was
+ *     created or a step failed, or
+ *   - max_attempts is < 0, or
+ *   - done is null.
+ *   TPH_POISSON_OVERFLOW - The number of samples exceeds the maximum number.
+ *
+ * When an error is returned the sampler has no samples, but a new sampling may be begun.
+ *
+ * @param sampler      Sampler.
+ * @param max_attempts Number of candidates to test, zero for no limit.
+ * @param done         Set to non-zero if there are no more active samples, i.e. sampling is
+ *                     complete, otherwise zero. Further steps do nothing once done.
+ * @return TPH_POISSON_SUCCESS if no errors; otherwise a non-zero error code.
+ */
+extern int tph_poisson_sampler_step(tph_poisson_sampler *sampler,
+  ptrdiff_t max_attempts,
+  int32_t *done);
+
+/**
+ * @brief Frees all memory used by the sampler. Note that the sampler itself is not free'd.
+ * @param sampler Sampler.
+ */
+extern void tph_poisson_sampler_destroy(tph_poisson_sampler *sampler);
+
+/**
+ * Returns a pointer to the samples from the last run of the sampler, stored in the same way as
+ * for tph_poisson_get_samples. Use sampler.ndims and sampler.nsamples to unpack the samples.
+ * @param sampler Sampler.
+ * @return Pointer to samples, or NULL if the sampler has not been initialized or the last run
+ * failed.
+ */
+extern const tph_poisson_real *tph_poisson_sampler_get_samples(const tph_poisson_sampler *sampler);
+
+/**
+ * Initializes a tiler, which samples tiles of unbounded space on demand, in any order, using
+ * tph_poisson_tiler_run. Space is divided into cubic tiles (see args.tile_size), the tile with
+ * integer coordinates t covering [t[i] * tile_size, (t[i] + 1) * tile_size] along each axis i.
+ * The samples of a tile are a function of args.seed, the tile coordinates and the arguments only,
+ * so a tile is the same regardless of which tiles were sampled before it.
+ *
+ * Each tile is first sampled on its own, with a pseudo-random number generator seeded from
+ * args.seed and the tile coordinates. Tiles are ranked by a hash of the same values. Seams are
+ * then resolved by dropping the samples of a tile that are not further than args.radius from a
+ * sample of a higher ranked adjacent tile, so no two samples of any set of tiles are closer to
+ * each other than args.radius. Samples near seams are therefore somewhat sparser than inside tiles.
+ * Samples of adjacent tiles that lie near the shared border, the halo, are kept in a cache of
+ * cache_size tiles, least recently used tiles are evicted first. On a cache miss the adjacent
+ * tile is sampled again, so sampling a tile costs about as much as sampling up to 3^ndims tiles
+ * when tiles are visited in random order, and much less when neighboring tiles are sampled
+ * together.
+ *
+ * args.bounds_min and args.bounds_max are ignored and may be null, args.seed is the seed for
+ * all tiles. Tile coordinates far from the origin lose precision, as for any samples far from
+ * the origin.
+ *
+ * Errors:
+ *   Same as tph_poisson_sampler_create, except for the requirements on the bounds.
+ *   Additionally, the arguments are invalid if:
+ *   - args.tile_size is not zero and less than the outer annulus radius, or
+ *   - cache_size is < 0.
+ *
+ * Note that when an error is returned the tiler doesn't need to be destroyed using the
+ * tph_poisson_tiler_destroy function.
+ *
+ * @param args       Arguments, not used after this call returns.
+ * @param cache_size Number of tiles whose halos are cached. When zero, defaults to
+ *                   TPH_POISSON_TILE_CACHE_SIZE (64 unless overridden when compiling the
+ *                   implementation).
+ * @param alloc      Optional custom allocator (may be null).
+ * @param tiler      Tiler to initialize.
+ * @return TPH_POISSON_SUCCESS if no errors; otherwise a non-zero error code.
+ */
+extern int tph_poisson_tiler_create(const tph_poisson_args *args,
+  ptrdiff_t cache_size,
+  const tph_poisson_allocator *alloc,
+  tph_poisson_tiler *tiler);
+
+/**
+ * Samples the tile with the provided coordinates, an array of tiler.ndims values. Samples from
+ * the previous tile are discarded, pointers returned by tph_poisson_tiler_get_samples before this
+ * call are invalidated. Samples are in the order they were accepted when sampling the tile.
+ *
+ * Errors:
+ *   TPH_POISSON_BAD_ALLOC - Failed memory allocation.
+ *   TPH_POISSON_INVALID_ARGS - The arguments are invalid if:
+ *   - the tiler has not been initialized, or
+ *   - tile is null, or
+ *   - a tile coordinate is INT64_MIN or INT64_MAX.
+ *   TPH_POISSON_OVERFLOW - The number of samples exceeds the maximum number.
+ *
+ * When an error is returned the tiler has no samples, but may be run again.
+ *
+ * @param tiler Tiler.
+ * @param tile  Tile coordinates.
+ * @return TPH_POISSON_SUCCESS if no errors; otherwise a non-zero error code.
+ */
+extern int tph_poisson_tiler_run(tph_poisson_tiler *tiler, const int64_t *tile);
+
+/**
+ * @brief Frees all memory used by the tiler. Note that the tiler itself is not free'd.
+ * @param tiler Tiler.
+ */
+extern void tph_poisson_tiler_destroy(tph_poisson_tiler *tiler);
+
+/**
+ * Returns a pointer to the samples of the last tile sampled by the tiler, stored in the same way
+ * as for tph_poisson_get_samples. Use tiler.ndims and tiler.nsamples to unpack the samples.
+ * @param tiler Tiler.
+ * @return Pointer to samples, or NULL if the tiler has not been initialized, the last run failed
+ * or the tile has no samples.
+ */
+extern const tph_poisson_real *tph_poisson_tiler_get_samples(const tph_poisson_tiler *tiler);
+
 /**
  * @brief Frees all memory used by the sampling. Note that the sampling itself is not free'd.
  * @param sampling Sampling to store samples.
@@ -143,6 +800,8 @@ extern void tph_poisson_destroy(tph_poisson_sampling *sampling);
  * Returns a pointer to the samples in the provided sampling. Samples are stored as
  * N-dimensional points, i.e. the first N values are the coordinates of the first point, etc.
  * Note that sampling.ndims and sampling.nsamples can be used to unpack the raw samples into points.
+ * If the sampling was created with args.output_layout set to TPH_POISSON_LAYOUT_SOA, the samples
+ * are stored as one array per dimension instead, see sampling.soa_stride.
  * @param sampling Sampling to store samples.
  * @return Pointer to samples, or NULL if the sampling has not been successfully initialized by a
  * call to the tph_poisson_create function (without being destroy by the tph_poisson_destroy
@@ -150,6 +809,42 @@ extern void tph_poisson_destroy(tph_poisson_sampling *sampling);
  */
 extern const tph_poisson_real *tph_poisson_get_samples(const tph_poisson_sampling *sampling);
 
+/**
+ * Writes the samples of the provided sampling as quantized coordinates relative to the bounds,
+ * in one of the TPH_POISSON_QUANTIZE_* formats, to a buffer provided by the caller. Values are
+ * stored in the same layout as the samples, i.e. sampling.nsamples * sampling.ndims values, or
+ * sampling.soa_stride * sampling.ndims values in the SoA layout with zeros as padding. The
+ * sampling may be destroyed afterwards, keeping only the quantized samples.
+ *
+ * Quantization moves each sample by at most the Euclidean norm of the per-coordinate errors
+ * given for the format, so two quantized samples may be closer than args.radius by up to twice
+ * that distance. Samples are only written if that distance is not larger than
+ * tolerance * args.radius.
+ *
+ * Errors:
+ *   TPH_POISSON_INVALID_ARGS - The arguments are invalid if:
+ *   - sampling has not been successfully created, or
+ *   - args is invalid (see tph_poisson_create), or args.ndims is not sampling.ndims, or
+ *   - format is not a valid format, or
+ *   - tolerance is < 0, or
+ *   - samples is null, or nbytes is less than the size of the values written, or
+ *   - the quantization error may be larger than tolerance * args.radius.
+ *
+ * @param sampling  Sampling.
+ * @param args      Arguments used to create the sampling, the bounds and the radius are used.
+ * @param format    Format, one of the TPH_POISSON_QUANTIZE_* values.
+ * @param tolerance Largest allowed quantization error, relative to args.radius.
+ * @param samples   Buffer to store quantized samples, aligned for the values of the format.
+ * @param nbytes    Size of the buffer in bytes.
+ * @return TPH_POISSON_SUCCESS if no errors; otherwise a non-zero error code.
+ */
+extern int tph_poisson_quantize(const tph_poisson_sampling *sampling,
+  const tph_poisson_args *args,
+  int32_t format,
+  tph_poisson_real tolerance,
+  void *samples,
+  ptrdiff_t nbytes);
+
 /* END PUBLIC API ----------------------------------------------------------- */
 
 #ifdef __cplusplus
@@ -166,12 +861,27 @@ extern const tph_poisson_real *tph_poisson_get_samples(const tph_poisson_samplin
 #include <stdalign.h> /* alignof */
 #include <stdbool.h> /* bool, true, false */
 
+#ifdef TPH_POISSON_C11_THREADS
+#include <stdatomic.h> /* atomic_fetch_add, etc */
+#include <threads.h> /* thrd_create, thrd_join */
+#endif
+
 #if defined(_MSC_VER) && !defined(__cplusplus)
 #define TPH_POISSON_INLINE __inline
 #else
 #define TPH_POISSON_INLINE inline
 #endif
 
+/* Functions in the sampling loop must be inlined into the fixed-dimension kernels (see
+ * tph_poisson_run_impl) for loops over dimensions to be unrolled. */
+#if defined(_MSC_VER)
+#define TPH_POISSON_FORCE_INLINE __forceinline
+#elif defined(__GNUC__) || defined(__clang__)
+#define TPH_POISSON_FORCE_INLINE TPH_POISSON_INLINE __attribute__((always_inline))
+#else
+#define TPH_POISSON_FORCE_INLINE TPH_POISSON_INLINE
+#endif
+
 #ifndef TPH_POISSON_ASSERT
 #include <assert.h>
 #define TPH_POISSON_ASSERT(_X_) assert((_X_))
@@ -187,6 +897,124 @@ extern const tph_poisson_real *tph_poisson_get_samples(const tph_poisson_samplin
 #define TPH_POISSON_MEMSET(_S_, _C_, _N_) memset((_S_), (_C_), (_N_))
 #endif
 
+#ifndef TPH_POISSON_MEMMOVE
+#include <string.h>
+#define TPH_POISSON_MEMMOVE(_DST_, _SRC_, _N_) memmove((_DST_), (_SRC_), (_N_))
+#endif
+
+/* Math functions used by some candidate generation methods and by sample count estimates. These
+ * are always evaluated in double precision, regardless of tph_poisson_real. */
+/* clang-format off */
+#if ( defined(TPH_POISSON_DSQRT) || defined(TPH_POISSON_DCOS) || defined(TPH_POISSON_DSIN) || \
+      defined(TPH_POISSON_DLOG)  || defined(TPH_POISSON_DPOW)) &&                             \
+    (!defined(TPH_POISSON_DSQRT) || !defined(TPH_POISSON_DCOS) || !defined(TPH_POISSON_DSIN) || \
+     !defined(TPH_POISSON_DLOG)  || !defined(TPH_POISSON_DPOW))
+#error \
+  "TPH_POISSON_DSQRT, TPH_POISSON_DCOS, TPH_POISSON_DSIN, TPH_POISSON_DLOG and TPH_POISSON_DPOW must all be defined; or none of them."
+#endif
+#if !defined(TPH_POISSON_DSQRT)
+#include <math.h>
+#define TPH_POISSON_DSQRT(_X_)     sqrt((_X_))
+#define TPH_POISSON_DCOS(_X_)      cos((_X_))
+#define TPH_POISSON_DSIN(_X_)      sin((_X_))
+#define TPH_POISSON_DLOG(_X_)      log((_X_))
+#define TPH_POISSON_DPOW(_X_, _Y_) pow((_X_), (_Y_))
+#endif
+/* clang-format on */
+
+#define TPH_POISSON_TWO_PI 6.283185307179586476925
+
+/* Fixed-dimension kernels are instantiated for 1 up to this number of dimensions. Must match the
+ * kernels dispatched to in tph_poisson_create. */
+#define TPH_POISSON_KERNEL_MAX_NDIMS 4
+
+/* Maximum number of cells in the neighbor-cell stencil. In higher dimensions neighbor cells are
+ * enumerated one by one for each candidate sample instead. */
+#ifndef TPH_POISSON_STENCIL_MAX_SIZE
+#define TPH_POISSON_STENCIL_MAX_SIZE 4096
+#endif
+
+/* Default maximum size in bytes of a dense grid, see tph_poisson_args.grid_max_dense_size. */
+#ifndef TPH_POISSON_GRID_MAX_DENSE_SIZE
+#define TPH_POISSON_GRID_MAX_DENSE_SIZE ((ptrdiff_t)1 << 30)
+#endif
+
+/* Default number of candidates generated together, see tph_poisson_args.candidate_batch_size. */
+#ifndef TPH_POISSON_CANDIDATE_BATCH_SIZE
+#define TPH_POISSON_CANDIDATE_BATCH_SIZE 1
+#endif
+
+/* Alignment in bytes of the dimension arrays in the SoA sample layout, see
+ * TPH_POISSON_LAYOUT_SOA. */
+#define TPH_POISSON_SOA_ALIGNMENT 64
+
+/* Default number of samples per call to the stream, see tph_poisson_stream.chunk_size. */
+#ifndef TPH_POISSON_STREAM_CHUNK_SIZE
+#define TPH_POISSON_STREAM_CHUNK_SIZE 1024
+#endif
+
+/* Default number of tiles whose halos are cached by a tiler, see tph_poisson_tiler_create. */
+#ifndef TPH_POISSON_TILE_CACHE_SIZE
+#define TPH_POISSON_TILE_CACHE_SIZE 64
+#endif
+
+/* Sparse grids store (1 << TPH_POISSON_GRID_PAGE_BITS) consecutive cells per page. Pages hold a
+ * whole number of tiles for the tiled grid order. */
+#define TPH_POISSON_GRID_PAGE_BITS 12
+
+/* Parallel sampling (see tph_poisson_create_parallel) updates the occupancy bitmap from several
+ * threads, and bits of cells in different tiles may share words. Where atomic builtins are
+ * available they are used for all bitmap accesses, relaxed loads compile to plain loads.
+ * Otherwise parallel sampling does not use the bitmap. */
+#if defined(__GNUC__) || defined(__clang__)
+#define TPH_POISSON_ATOMIC_LOAD_U64(_P_) __atomic_load_n((_P_), __ATOMIC_RELAXED)
+#define TPH_POISSON_ATOMIC_OR_U64(_P_, _V_) \
+  (void)__atomic_fetch_or((_P_), (_V_), __ATOMIC_RELAXED)
+#endif
+
+/* Maximum number of threads used by tph_poisson_c11_threads_run. */
+#ifndef TPH_POISSON_MAX_THREADS
+#define TPH_POISSON_MAX_THREADS 64
+#endif
+
+/* Distances to neighbor samples are computed several at a time using SIMD instructions when the
+ * target supports it, see tph_poisson_batch_within_radius. Define TPH_POISSON_NO_SIMD to always
+ * use scalar code. */
+#if !defined(TPH_POISSON_NO_SIMD)
+#if defined(__AVX__)
+#include <immintrin.h>
+#define TPH_POISSON_SIMD_AVX
+#define TPH_POISSON_SIMD_BYTES 32
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define TPH_POISSON_SIMD_SSE2
+#define TPH_POISSON_SIMD_BYTES 16
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#define TPH_POISSON_SIMD_NEON
+#define TPH_POISSON_SIMD_BYTES 16
+#endif
+#endif
+
+/* Non-zero if tph_poisson_real is float or double, respectively. Both are compile-time
+ * constants. */
+#define TPH_POISSON_REAL_IS_FLOAT \
+  (sizeof(tph_poisson_real) == sizeof(float) && (tph_poisson_real)0.5 > 0)
+#define TPH_POISSON_REAL_IS_DOUBLE \
+  (sizeof(tph_poisson_real) == sizeof(double) && (tph_poisson_real)0.5 > 0)
+
+/* Number of samples whose distances are computed together. */
+#if defined(TPH_POISSON_SIMD_BYTES)
+#define TPH_POISSON_SIMD_LANES                                 \
+  ((TPH_POISSON_REAL_IS_FLOAT || TPH_POISSON_REAL_IS_DOUBLE) \
+      ? (ptrdiff_t)(TPH_POISSON_SIMD_BYTES / sizeof(tph_poisson_real))  \
+      : (ptrdiff_t)1)
+#define TPH_POISSON_SIMD_MAX_LANES (TPH_POISSON_SIMD_BYTES / 4)
+#else
+#define TPH_POISSON_SIMD_LANES ((ptrdiff_t)1)
+#define TPH_POISSON_SIMD_MAX_LANES 1
+#endif
+
 /*
  * MEMORY
  */
@@ -197,10 +1025,20 @@ extern const tph_poisson_real *tph_poisson_get_samples(const tph_poisson_samplin
 #error \
   "TPH_POISSON_MALLOC and TPH_POISSON_FREE must both be defined; or none of them."
 #endif
+#if defined(TPH_POISSON_REALLOC) && !defined(TPH_POISSON_MALLOC)
+#error \
+  "TPH_POISSON_REALLOC requires TPH_POISSON_MALLOC and TPH_POISSON_FREE to be defined."
+#endif
+#if defined(TPH_POISSON_CALLOC) && !defined(TPH_POISSON_MALLOC)
+#error \
+  "TPH_POISSON_CALLOC requires TPH_POISSON_MALLOC and TPH_POISSON_FREE to be defined."
+#endif
 #if !defined(TPH_POISSON_MALLOC) && !defined(TPH_POISSON_FREE)
 #include <stdlib.h>
 #define TPH_POISSON_MALLOC(_SIZE_) malloc((_SIZE_))
 #define TPH_POISSON_FREE(_PTR_) free((_PTR_))
+#define TPH_POISSON_REALLOC(_PTR_, _SIZE_) realloc((_PTR_), (_SIZE_))
+#define TPH_POISSON_CALLOC(_SIZE_) calloc(1, (_SIZE_))
 #endif
 /* clang-format on */
 
@@ -220,12 +1058,44 @@ static TPH_POISSON_INLINE void tph_poisson_free(void *ptr, ptrdiff_t size, void
   TPH_POISSON_FREE(ptr);
 }
 
+#ifdef TPH_POISSON_REALLOC
+static TPH_POISSON_INLINE void *
+  tph_poisson_realloc(void *ptr, ptrdiff_t size, ptrdiff_t new_size, void *ctx)
+{
+  (void)size;
+  (void)ctx;
+  return TPH_POISSON_REALLOC(ptr, (size_t)new_size);
+}
+#endif
+
+#ifdef TPH_POISSON_CALLOC
+static TPH_POISSON_INLINE void *tph_poisson_calloc(ptrdiff_t size, void *ctx)
+{
+  (void)ctx;
+  return TPH_POISSON_CALLOC((size_t)size);
+}
+#endif
+
 /**
- * Default allocator used when no custom allocator is provided.
+ * Default allocator used when no custom allocator is provided. Memory functions provided with
+ * TPH_POISSON_MALLOC and TPH_POISSON_FREE are only used to resize buffers in place if
+ * TPH_POISSON_REALLOC is also provided, and to get zeroed memory if TPH_POISSON_CALLOC is.
  */
 static tph_poisson_allocator tph_poisson_default_alloc = { tph_poisson_malloc,
   tph_poisson_free,
-  /*.ctx=*/NULL };
+  /*.ctx=*/NULL,
+#ifdef TPH_POISSON_REALLOC
+  tph_poisson_realloc,
+#else
+  /*.realloc=*/NULL,
+#endif
+#ifdef TPH_POISSON_CALLOC
+  tph_poisson_calloc,
+#else
+  /*.calloc=*/NULL,
+#endif
+  /*.aligned_malloc=*/NULL,
+  /*.aligned_free=*/NULL };
 
 /**
  * @brief Returns a pointer aligned to the provided alignment. The address pointed
@@ -243,25 +1113,120 @@ static TPH_POISSON_INLINE void *tph_poisson_align(void *const ptr, const size_t
   return (void *)(((uintptr_t)ptr + (alignment - 1)) & ~(alignment - 1));
 }
 
-/*
- * PSEUDO-RANDOM NUMBER GENERATION
+/**
+ * @brief Returns true if the allocator provides malloc and free functions, or aligned_malloc and
+ * aligned_free functions (see tph_poisson_allocator).
+ * @param alloc Allocator.
+ * @return True if the allocator can be used.
  */
-
-typedef struct tph_poisson_splitmix64_state_
+static bool tph_poisson_alloc_valid(const tph_poisson_allocator *alloc)
 {
-  uint64_t s;
-} tph_poisson_splitmix64_state;
+  return ((int)(alloc->malloc != NULL && alloc->free != NULL)
+           | (int)(alloc->aligned_malloc != NULL && alloc->aligned_free != NULL))
+         == 1;
+}
 
 /**
- * @brief Returns a pseudo-random number generated using the SplitMix64 algorithm and mutates the
- * state in preparation for subsequent calls.
- * @param state State to be mutated into the next number in the sequence.
- * @return A pseudo-random number
+ * @brief Copies the allocator, or the default allocator if alloc is NULL. The realloc and calloc
+ * functions are cleared if aligned functions are provided, since they are not used then.
+ * @param alloc Allocator, or NULL.
+ * @param dst   Copy.
  */
-static uint64_t tph_poisson_splitmix64(tph_poisson_splitmix64_state *state)
+static void tph_poisson_alloc_copy(const tph_poisson_allocator *alloc, tph_poisson_allocator *dst)
 {
-  uint64_t result = (state->s += 0x9E3779B97f4A7C15);
-  result = (result ^ (result >> 30)) * 0xBF58476D1CE4E5B9;
+  TPH_POISSON_ASSERT(!alloc || tph_poisson_alloc_valid(alloc));
+  *dst = alloc != NULL ? *alloc : tph_poisson_default_alloc;
+  if (dst->aligned_malloc == NULL || dst->aligned_free == NULL) {
+    dst->aligned_malloc = NULL;
+    dst->aligned_free = NULL;
+  } else {
+    dst->realloc = NULL;
+    dst->calloc = NULL;
+  }
+}
+
+/**
+ * @brief Returns the number of bytes that must be added to a buffer to align it manually. Memory
+ * from aligned_malloc is already aligned.
+ * @param alloc     Allocator.
+ * @param alignment Alignment of objects intended to be stored in the buffer.
+ * @return Alignment slack in bytes.
+ */
+static TPH_POISSON_INLINE ptrdiff_t tph_poisson_alloc_slack(const tph_poisson_allocator *alloc,
+  const ptrdiff_t alignment)
+{
+  return alloc->aligned_malloc != NULL ? 0 : alignment;
+}
+
+/**
+ * @brief Allocates memory using aligned_malloc if the allocator provides it, otherwise using
+ * malloc, or calloc for zeroed memory. Only memory from aligned_malloc is aligned, see
+ * tph_poisson_alloc_slack.
+ * @param alloc     Allocator.
+ * @param size      Size in bytes.
+ * @param alignment Alignment of objects intended to be stored in the buffer.
+ * @param purpose   One of the TPH_POISSON_ALLOC_* values, possibly with TPH_POISSON_ALLOC_ZEROED.
+ * @return Memory buffer, or NULL on failure.
+ */
+static void *tph_poisson_mem_alloc(const tph_poisson_allocator *alloc,
+  const ptrdiff_t size,
+  const ptrdiff_t alignment,
+  const int32_t purpose)
+{
+  TPH_POISSON_ASSERT((alignment > 0) & ((alignment & (alignment - 1)) == 0));
+  void *mem = NULL;
+  if (alloc->aligned_malloc != NULL) {
+    mem = alloc->aligned_malloc(size, alignment, purpose, alloc->ctx);
+    TPH_POISSON_ASSERT(((uintptr_t)mem & (uintptr_t)(alignment - 1)) == 0);
+  } else if ((purpose & TPH_POISSON_ALLOC_ZEROED) == 0) {
+    mem = alloc->malloc(size, alloc->ctx);
+  } else if (alloc->calloc != NULL) {
+    mem = alloc->calloc(size, alloc->ctx);
+  } else {
+    mem = alloc->malloc(size, alloc->ctx);
+    if (mem != NULL) { TPH_POISSON_MEMSET(mem, 0, (size_t)size); }
+  }
+  return mem;
+}
+
+/**
+ * @brief Frees memory allocated with tph_poisson_mem_alloc.
+ * @param alloc   Allocator.
+ * @param mem     Memory buffer.
+ * @param size    Size in bytes, same as when allocated.
+ * @param purpose Same as when allocated, TPH_POISSON_ALLOC_ZEROED is ignored.
+ */
+static void tph_poisson_mem_free(const tph_poisson_allocator *alloc,
+  void *mem,
+  const ptrdiff_t size,
+  const int32_t purpose)
+{
+  if (alloc->aligned_free != NULL) {
+    alloc->aligned_free(mem, size, purpose & ~TPH_POISSON_ALLOC_ZEROED, alloc->ctx);
+  } else {
+    alloc->free(mem, size, alloc->ctx);
+  }
+}
+
+/*
+ * PSEUDO-RANDOM NUMBER GENERATION
+ */
+
+typedef struct tph_poisson_splitmix64_state_
+{
+  uint64_t s;
+} tph_poisson_splitmix64_state;
+
+/**
+ * @brief Returns a pseudo-random number generated using the SplitMix64 algorithm and mutates the
+ * state in preparation for subsequent calls.
+ * @param state State to be mutated into the next number in the sequence.
+ * @return A pseudo-random number
+ */
+static uint64_t tph_poisson_splitmix64(tph_poisson_splitmix64_state *state)
+{
+  uint64_t result = (state->s += 0x9E3779B97f4A7C15);
+  result = (result ^ (result >> 30)) * 0xBF58476D1CE4E5B9;
   result = (result ^ (result >> 27)) * 0x94D049BB133111EB;
   return result ^ (result >> 31);
 }
@@ -312,6 +1277,72 @@ static uint64_t tph_poisson_xoshiro256p_next(tph_poisson_xoshiro256p_state *stat
   return result;
 }
 
+/* Number of streams in tph_poisson_xoshiro256p_x4_state. */
+#define TPH_POISSON_PRNG_LANES 4
+
+typedef struct tph_poisson_xoshiro256p_x4_state_
+{
+  uint64_t s[4][TPH_POISSON_PRNG_LANES]; /** s[i][lane], word i of each stream's state. */
+  uint64_t out[TPH_POISSON_PRNG_LANES]; /** Values from the last step, one per stream. */
+  ptrdiff_t next; /** Index of the next value in out to return. */
+} tph_poisson_xoshiro256p_x4_state;
+
+/**
+ * @brief Initializes a multi-stream xoshiro256+ state. Streams are initialized in order with
+ * consecutive values from a single SplitMix64 sequence, so the first stream is initialized as in
+ * tph_poisson_xoshiro256p_init.
+ * @param state The state to initialize.
+ * @param seed  Seed value, can be zero.
+ */
+static void tph_poisson_xoshiro256p_x4_init(tph_poisson_xoshiro256p_x4_state *state,
+  const uint64_t seed)
+{
+  tph_poisson_splitmix64_state sm_state = { seed };
+  for (ptrdiff_t j = 0; j < TPH_POISSON_PRNG_LANES; ++j) {
+    for (int i = 0; i < 4; ++i) { state->s[i][j] = tph_poisson_splitmix64(&sm_state); }
+  }
+  state->next = TPH_POISSON_PRNG_LANES;
+}
+
+/**
+ * @brief Steps all streams once, storing one new value per stream. Same as
+ * tph_poisson_xoshiro256p_next for each stream, written as a loop over streams so that the
+ * compiler can vectorize it.
+ * @param state State to be mutated.
+ */
+static void tph_poisson_xoshiro256p_x4_step(tph_poisson_xoshiro256p_x4_state *state)
+{
+  uint64_t *s0 = state->s[0];
+  uint64_t *s1 = state->s[1];
+  uint64_t *s2 = state->s[2];
+  uint64_t *s3 = state->s[3];
+  uint64_t t = 0;
+  for (ptrdiff_t j = 0; j < TPH_POISSON_PRNG_LANES; ++j) {
+    state->out[j] = s0[j] + s3[j];
+    t = s1[j] << 17;
+    s2[j] ^= s0[j];
+    s3[j] ^= s1[j];
+    s1[j] ^= s2[j];
+    s0[j] ^= s3[j];
+    s2[j] ^= t;
+    s3[j] = (s3[j] << 45) | (s3[j] >> 49);
+  }
+  state->next = 0;
+}
+
+/**
+ * @brief Returns the next pseudo-random number from a multi-stream xoshiro256+ state, taking
+ * values from the streams in turn.
+ * @param state State to be mutated.
+ * @return A pseudo-random number.
+ */
+static TPH_POISSON_INLINE uint64_t tph_poisson_xoshiro256p_x4_next(
+  tph_poisson_xoshiro256p_x4_state *state)
+{
+  if (state->next == TPH_POISSON_PRNG_LANES) { tph_poisson_xoshiro256p_x4_step(state); }
+  return state->out[state->next++];
+}
+
 /*
  * MISC
  */
@@ -328,6 +1359,17 @@ static TPH_POISSON_INLINE double tph_poisson_to_double(const uint64_t x)
   return (double)(x >> 11) * 0x1.0p-53;
 }
 
+/**
+ * @brief Returns a floating point number in [0..1), using the upper 24 bits of x, which is all
+ * that fits in the mantissa of a float.
+ * @param x Bit representation.
+ * @return A number in [0..1).
+ */
+static TPH_POISSON_INLINE float tph_poisson_to_float(const uint64_t x)
+{
+  return (float)(x >> 40) * 0x1.0p-24f;
+}
+
 /*
  * VECTOR
  */
@@ -344,16 +1386,18 @@ typedef struct tph_poisson_vec_
 
 /**
  * @brief Frees all memory associated with the vector.
- * @param vec   Vector.
- * @param alloc Allocator.
+ * @param vec     Vector.
+ * @param alloc   Allocator.
+ * @param purpose Allocation purpose, one of the TPH_POISSON_ALLOC_* values.
  */
 static TPH_POISSON_INLINE void tph_poisson_vec_free(tph_poisson_vec *vec,
-  const tph_poisson_allocator *alloc)
+  const tph_poisson_allocator *alloc,
+  const int32_t purpose)
 {
   TPH_POISSON_ASSERT(vec != NULL);
   TPH_POISSON_ASSERT(alloc != NULL);
   if (((int)(vec->mem != NULL) & (int)(vec->mem_size > 0)) == 1) {
-    alloc->free(vec->mem, vec->mem_size, alloc->ctx);
+    tph_poisson_mem_free(alloc, vec->mem, vec->mem_size, purpose);
   }
 }
 
@@ -368,6 +1412,46 @@ static TPH_POISSON_INLINE ptrdiff_t tph_poisson_vec_size(const tph_poisson_vec *
   return (ptrdiff_t)((intptr_t)vec->end - (intptr_t)vec->begin);
 }
 
+/**
+ * @brief Resizes the memory buffer of a non-empty vector using the realloc function of the
+ * allocator, which may resize the buffer in place. If the buffer moves, the alignment correction
+ * of the new buffer may differ from that of the old one, in which case the elements are moved to
+ * the aligned position. This cannot overwrite elements, new_mem_size includes space for the
+ * largest alignment correction.
+ * @param vec          Vector, with a non-empty memory buffer.
+ * @param alloc        Allocator, with a realloc function.
+ * @param new_mem_size Size of the new memory buffer in bytes, including alignment.
+ * @param alignment    Alignment of objects intended to be stored in the vector.
+ * @return TPH_POISSON_SUCCESS, or a non-zero error code.
+ */
+static int tph_poisson_vec_realloc(tph_poisson_vec *vec,
+  const tph_poisson_allocator *alloc,
+  const ptrdiff_t new_mem_size,
+  const ptrdiff_t alignment)
+{
+  TPH_POISSON_ASSERT(alloc->realloc != NULL);
+  TPH_POISSON_ASSERT(vec->mem != NULL && vec->mem_size > 0);
+  const ptrdiff_t offset = (intptr_t)vec->begin - (intptr_t)vec->mem;
+  const ptrdiff_t size = (intptr_t)vec->end - (intptr_t)vec->begin;
+  TPH_POISSON_ASSERT(new_mem_size >= size + alignment);
+
+  /* On failure the old buffer is left untouched, so the vector is still valid. */
+  void *const new_mem = alloc->realloc(vec->mem, vec->mem_size, new_mem_size, alloc->ctx);
+  if (new_mem == NULL) { return TPH_POISSON_BAD_ALLOC; }
+  void *const new_begin = tph_poisson_align(new_mem, (size_t)alignment);
+  if ((intptr_t)new_begin - (intptr_t)new_mem != offset && size > 0) {
+    /* Source and destination may overlap. */
+    TPH_POISSON_MEMMOVE(new_begin, (const void *)((intptr_t)new_mem + offset), (size_t)size);
+  }
+
+  /* Configure vector to use the new buffer. */
+  vec->mem = new_mem;
+  vec->mem_size = new_mem_size;
+  vec->begin = new_begin;
+  vec->end = (void *)((intptr_t)new_begin + size);
+  return TPH_POISSON_SUCCESS;
+}
+
 /**
  * @brief Increase the capacity of the vector (the total number of elements that the vector can hold
  * without requiring reallocation) to a value that's greater or equal to new_cap. If new_cap is
@@ -377,12 +1461,14 @@ static TPH_POISSON_INLINE ptrdiff_t tph_poisson_vec_size(const tph_poisson_vec *
  * @param alloc     Allocator.
  * @param new_cap   Minimum number of elements that can be stored without requiring reallocation.
  * @param alignment Alignment of objects intended to be stored in the vector.
+ * @param purpose   Allocation purpose, one of the TPH_POISSON_ALLOC_* values.
  * @return TPH_POISSON_SUCCESS, or a non-zero error code.
  */
 static int tph_poisson_vec_reserve(tph_poisson_vec *vec,
   const tph_poisson_allocator *alloc,
   const ptrdiff_t new_cap,
-  const ptrdiff_t alignment)
+  const ptrdiff_t alignment,
+  const int32_t purpose)
 {
   TPH_POISSON_ASSERT(vec != NULL);
   TPH_POISSON_ASSERT(alloc != NULL);
@@ -392,11 +1478,14 @@ static int tph_poisson_vec_reserve(tph_poisson_vec *vec,
   /* NOTE: For zero-initialized vector cap is 0. */
   const ptrdiff_t cap = vec->mem_size - ((intptr_t)vec->begin - (intptr_t)vec->mem);
   if (new_cap <= cap) { return TPH_POISSON_SUCCESS; }
+  if (alloc->realloc != NULL && vec->mem_size > 0) {
+    return tph_poisson_vec_realloc(vec, alloc, new_cap + alignment, alignment);
+  }
 
   /* Allocate and align a new buffer with sufficient capacity. Take into account that
    * the memory returned by the allocator may not match the requested alignment. */
-  const ptrdiff_t new_mem_size = new_cap + alignment;
-  void *const new_mem = alloc->malloc(new_mem_size, alloc->ctx);
+  const ptrdiff_t new_mem_size = new_cap + tph_poisson_alloc_slack(alloc, alignment);
+  void *const new_mem = tph_poisson_mem_alloc(alloc, new_mem_size, alignment, purpose);
   if (new_mem == NULL) { return TPH_POISSON_BAD_ALLOC; }
   void *const new_begin = tph_poisson_align(new_mem, (size_t)alignment);
 
@@ -411,7 +1500,7 @@ static int tph_poisson_vec_reserve(tph_poisson_vec *vec,
   /* Destroy the old buffer (if any). */
   if (vec->mem_size > 0) {
     TPH_POISSON_ASSERT(vec->mem != NULL);
-    alloc->free(vec->mem, vec->mem_size, alloc->ctx);
+    tph_poisson_mem_free(alloc, vec->mem, vec->mem_size, purpose);
   }
 
   /* Configure vector to use the new buffer. */
@@ -432,13 +1521,15 @@ static int tph_poisson_vec_reserve(tph_poisson_vec *vec,
  * @param buf       Pointer to values to be added. Assumed to be non-null.
  * @param n         Number of bytes to copy from values. Assumed to be > 0.
  * @param alignment Alignment of objects intended to be stored in the vector.
+ * @param purpose   Allocation purpose, one of the TPH_POISSON_ALLOC_* values.
  * @return TPH_POISSON_SUCCESS, or a non-zero error code.
  */
 static int tph_poisson_vec_append(tph_poisson_vec *vec,
   const tph_poisson_allocator *alloc,
   const void *buf,
   const ptrdiff_t n,
-  const ptrdiff_t alignment)
+  const ptrdiff_t alignment,
+  const int32_t purpose)
 {
   TPH_POISSON_ASSERT(vec != NULL);
   TPH_POISSON_ASSERT(alloc != NULL);
@@ -458,30 +1549,36 @@ static int tph_poisson_vec_append(tph_poisson_vec *vec,
     /* Allocate and align a new buffer with sufficient capacity. Take into
      * account that the memory returned by the allocator may not be aligned to
      * the type of element that will be stored. */
-    new_cap += alignment;
-    void *new_mem = alloc->malloc(new_cap, alloc->ctx);
-    if (new_mem == NULL) { return TPH_POISSON_BAD_ALLOC; }
-    void *new_begin = tph_poisson_align(new_mem, (size_t)alignment);
-
-    const ptrdiff_t size = (intptr_t)vec->end - (intptr_t)vec->begin;
+    new_cap += tph_poisson_alloc_slack(alloc, alignment);
+    if (alloc->realloc != NULL && vec->mem_size > 0) {
+      /* Existing buffer may be grown in place. */
+      const int ret = tph_poisson_vec_realloc(vec, alloc, new_cap, alignment);
+      if (ret != TPH_POISSON_SUCCESS) { return ret; }
+    } else {
+      void *new_mem = tph_poisson_mem_alloc(alloc, new_cap, alignment, purpose);
+      if (new_mem == NULL) { return TPH_POISSON_BAD_ALLOC; }
+      void *new_begin = tph_poisson_align(new_mem, (size_t)alignment);
+
+      const ptrdiff_t size = (intptr_t)vec->end - (intptr_t)vec->begin;
+
+      /* Copy existing data (if any) to the new buffer. */
+      if (size > 0) {
+        TPH_POISSON_ASSERT(vec->begin != NULL);
+        TPH_POISSON_MEMCPY(new_begin, vec->begin, (size_t)size);
+      }
 
-    /* Copy existing data (if any) to the new buffer. */
-    if (size > 0) {
-      TPH_POISSON_ASSERT(vec->begin != NULL);
-      TPH_POISSON_MEMCPY(new_begin, vec->begin, (size_t)size);
-    }
+      /* Destroy the old buffer (if any). */
+      if (vec->mem_size > 0) {
+        TPH_POISSON_ASSERT(vec->mem != NULL);
+        tph_poisson_mem_free(alloc, vec->mem, vec->mem_size, purpose);
+      }
 
-    /* Destroy the old buffer (if any). */
-    if (vec->mem_size > 0) {
-      TPH_POISSON_ASSERT(vec->mem != NULL);
-      alloc->free(vec->mem, vec->mem_size, alloc->ctx);
+      /* Configure vector to use the new buffer. */
+      vec->mem = new_mem;
+      vec->mem_size = new_cap;
+      vec->begin = new_begin;
+      vec->end = (void *)((intptr_t)new_begin + size);
     }
-
-    /* Configure vector to use the new buffer. */
-    vec->mem = new_mem;
-    vec->mem_size = new_cap;
-    vec->begin = new_begin;
-    vec->end = (void *)((intptr_t)new_begin + size);
   }
   TPH_POISSON_ASSERT(vec->mem_size - ((intptr_t)vec->begin - (intptr_t)vec->mem) >= req_cap);
   TPH_POISSON_ASSERT((intptr_t)vec->end % alignment == 0);
@@ -521,13 +1618,16 @@ static void tph_poisson_vec_erase_swap(tph_poisson_vec *vec, const ptrdiff_t pos
 
 /**
  * @brief Requests the removal of unused capacity.
- * @param vec   Vector.
- * @param alloc Allocator.
+ * @param vec       Vector.
+ * @param alloc     Allocator.
+ * @param alignment Alignment of objects stored in the vector.
+ * @param purpose   Allocation purpose, one of the TPH_POISSON_ALLOC_* values.
  * @return TPH_POISSON_SUCCESS, or a non-zero error code.
  */
 static int tph_poisson_vec_shrink_to_fit(tph_poisson_vec *vec,
   const tph_poisson_allocator *alloc,
-  const ptrdiff_t alignment)
+  const ptrdiff_t alignment,
+  const int32_t purpose)
 {
   TPH_POISSON_ASSERT(vec != NULL);
   TPH_POISSON_ASSERT(alloc != NULL);
@@ -540,7 +1640,7 @@ static int tph_poisson_vec_shrink_to_fit(tph_poisson_vec *vec,
     if (vec->mem != NULL) {
       /* Existing vector is empty but has capacity. */
       TPH_POISSON_ASSERT(vec->mem_size > 0);
-      alloc->free(vec->mem, vec->mem_size, alloc->ctx);
+      tph_poisson_mem_free(alloc, vec->mem, vec->mem_size, purpose);
       TPH_POISSON_MEMSET((void *)vec, 0, sizeof(tph_poisson_vec));
     }
     TPH_POISSON_ASSERT(vec->mem == NULL);
@@ -550,19 +1650,23 @@ static int tph_poisson_vec_shrink_to_fit(tph_poisson_vec *vec,
 
   /* Check if allocating a new buffer (size + alignment) would be smaller than
    * the existing buffer. */
-  TPH_POISSON_ASSERT(vec->mem_size > alignment);
-  const ptrdiff_t new_mem_size = size + alignment;
+  const ptrdiff_t slack = tph_poisson_alloc_slack(alloc, alignment);
+  TPH_POISSON_ASSERT(vec->mem_size > slack);
+  const ptrdiff_t new_mem_size = size + slack;
+  if (vec->mem_size > new_mem_size && alloc->realloc != NULL) {
+    return tph_poisson_vec_realloc(vec, alloc, new_mem_size, alignment);
+  }
   if (vec->mem_size > new_mem_size) {
     /* Allocate and align a new buffer with sufficient capacity. Take into
      * account that the memory returned by the allocator may not be aligned to
      * the type of element that will be stored. */
-    void *const new_mem = alloc->malloc(new_mem_size, alloc->ctx);
+    void *const new_mem = tph_poisson_mem_alloc(alloc, new_mem_size, alignment, purpose);
     if (new_mem == NULL) { return TPH_POISSON_BAD_ALLOC; }
     void *const new_begin = tph_poisson_align(new_mem, (size_t)alignment);
 
     /* Copy existing data to the new buffer and destroy the old buffer. */
     TPH_POISSON_MEMCPY(new_begin, vec->begin, (size_t)size);
-    alloc->free(vec->mem, vec->mem_size, alloc->ctx);
+    tph_poisson_mem_free(alloc, vec->mem, vec->mem_size, purpose);
 
     /* Configure vector to use the new buffer. */
     vec->mem = new_mem;
@@ -584,8 +1688,26 @@ struct tph_poisson_sampling_internal_
   ptrdiff_t mem_size;
 
   tph_poisson_vec samples; /** ElemT = tph_poisson_real */
+  bool samples_capped; /** The sample buffer cannot grow, it holds at most max_samples. */
+  ptrdiff_t max_samples;
+
+  /* Streaming only, see tph_poisson_create_stream. Samples in the buffer before stream_flushed
+   * have been passed to the stream. Samples that are not retained are dropped from the buffer
+   * once passed, stream_count is the number of samples passed so far. */
+  const tph_poisson_stream *stream;
+  ptrdiff_t stream_chunk_size;
+  ptrdiff_t stream_flushed;
+  ptrdiff_t stream_count;
 };
 
+/* clang-format off */
+typedef struct tph_poisson_stencil_cell_
+{
+  ptrdiff_t offset; /** Linear grid index offset relative to the center cell. */
+  uint64_t mask;    /** One bit per dimension, see tph_poisson_stencil_build. */
+} tph_poisson_stencil_cell;
+/* clang-format on */
+
 typedef struct tph_poisson_context_
 {
   void *mem;
@@ -594,18 +1716,61 @@ typedef struct tph_poisson_context_
   tph_poisson_real radius; /** No two samples are closer to each other than the radius. */
   int32_t ndims; /** Number of dimensions, typically 2 or 3. */
   uint32_t max_sample_attempts; /** Maximum attempts when spawning samples from existing ones. */
+  ptrdiff_t attempt_budget; /** Candidates tested per run before stopping, zero for no limit. */
+  int32_t candidate_method; /** How candidates are generated around active samples. */
+  double annulus_outer; /** Outer radius of the candidate annulus, relative to the radius. */
+  double angular_start; /** Start angle for the current active sample (ANGULAR method only). */
+  uint32_t candidate_batch_size; /** Number of candidates generated together, see below. */
   tph_poisson_real *bounds_min; /** Hyper-rectangle lower bound. */
   tph_poisson_real *bounds_max; /** Hyper-rectangle upper bound. */
+
+  /* Parallel sampling only, otherwise NULL. Candidates are only accepted if their cell has grid
+   * indices in [region_min, region_max), i.e. if it lies in the tile being sampled. */
+  ptrdiff_t *region_min;
+  ptrdiff_t *region_max;
+
   tph_poisson_xoshiro256p_state prng_state; /** Pseudo-random number generator state. */
+  tph_poisson_xoshiro256p_x4_state *prng_x4; /** Multi-stream generator state, or NULL. */
 
-  tph_poisson_vec active_indices; /** ElemT = ptrdiff_t */
+  /* Linear grid indices of active samples, stored as unsigned integers of active_cell_size bytes,
+   * the smallest of 2, 4 or 8 bytes that holds any linear grid index. */
+  tph_poisson_vec active_cells;
+  ptrdiff_t active_cell_size;
 
   tph_poisson_real grid_dx; /** Uniform cell extent. */
   tph_poisson_real grid_dx_rcp; /** 1 / dx */
   ptrdiff_t grid_linear_size; /** Total number of grid cells. */
   ptrdiff_t *grid_size; /** Number of grid cells in each dimension. */
   ptrdiff_t *grid_stride; /** Strides in each dimension, used to compute linear index. */
-  uint32_t *grid_cells; /** Grid cells storing indices to points inside them. */
+
+  /* Tiled grid order only, otherwise NULL. The linear index of a cell is the sum over axes i of
+   * grid_axis[grid_axis_start[i] + grid_index[i]]. */
+  ptrdiff_t *grid_axis;
+  ptrdiff_t *grid_axis_start;
+
+  int32_t grid_storage; /** What cells store, see tph_poisson_args.grid_storage. */
+  ptrdiff_t grid_cell_size; /** Bytes per cell, 2, 4 or 8 when storing sample indices. */
+  void *grid_cells; /** Dense grid cells, NULL for sparse grids. */
+  uint64_t *grid_occupancy; /** Dense grids only, one bit per cell, set if the cell has a sample. */
+
+  /* Dense grids only, cells and occupancy bits are allocated separately from the context memory,
+   * see TPH_POISSON_ALLOC_GRID. The size does not include alignment slack. */
+  void *grid_mem;
+  ptrdiff_t grid_mem_size;
+
+  /* Sparse grids only, otherwise NULL. Pages are allocated when a sample first lands in them, a
+   * NULL page has only empty cells. Page memory is over-allocated for alignment, the raw
+   * pointers are kept for freeing. */
+  void **grid_pages;
+  void **grid_page_mem;
+  ptrdiff_t grid_page_count;
+
+  /* Neighbor cells that need to be checked around the cell of a candidate sample, ordered
+   * nearest-first. Only used in low dimensions, where the stencil is small. */
+  int32_t stencil_reach; /** Maximum cell offset along any axis. */
+  ptrdiff_t stencil_size; /** Number of stencil cells, zero if no stencil is used. */
+  tph_poisson_stencil_cell *stencil;
+  uint8_t *stencil_steps; /** Tiled grid order only, see tph_poisson_stencil_build. */
 
   /* Arrays of size ndims. Pre-allocated in the context to provide 'scratch' variables that are used
    * during the creation of a sampling, but don't need to be stored afterwards. */
@@ -613,8 +1778,65 @@ typedef struct tph_poisson_context_
   ptrdiff_t *grid_index;
   ptrdiff_t *min_grid_index;
   ptrdiff_t *max_grid_index;
+
+  /* Scratch storage for batched candidate generation, see tph_poisson_spawn_batched. NULL if
+   * candidates are generated one at a time. */
+  tph_poisson_real *candidates; /** candidate_batch_size * ndims positions. */
+  tph_poisson_xoshiro256p_state *candidate_prng_states; /** PRNG state after each candidate. */
+  tph_poisson_xoshiro256p_x4_state *candidate_prng_x4_states; /** Same, multi-stream generator. */
+  uint8_t *candidate_inside; /** Non-zero if a candidate is inside the bounds. */
 } tph_poisson_context;
 
+/* States of a sampler between steps, see tph_poisson_sampler_step. */
+#define TPH_POISSON_STEP_IDLE     0 /* No sampling begun, or the last step failed. */
+#define TPH_POISSON_STEP_RUNNING  1
+#define TPH_POISSON_STEP_DONE     2
+
+struct tph_poisson_sampler_internal_
+{
+  tph_poisson_sampling_internal sampling; /** Allocator, memory and samples of the last run. */
+  tph_poisson_context ctx; /** Kept between runs, the grid only holds the last run's samples. */
+  int32_t step_state; /** One of the TPH_POISSON_STEP_* values. */
+};
+
+/* Cached halo of a tile, see tph_poisson_tiler_run. */
+typedef struct tph_poisson_tile_halo_
+{
+  int64_t *tile; /** Tile coordinates, ndims values. */
+  tph_poisson_vec samples; /** Samples near the tile border, ElemT = tph_poisson_real. */
+  uint64_t last_used; /** Cache clock when last used, zero if the entry is empty. */
+} tph_poisson_tile_halo;
+
+struct tph_poisson_tiler_internal_
+{
+  tph_poisson_allocator alloc;
+  void *mem;
+  ptrdiff_t mem_size;
+
+  tph_poisson_sampler sampler; /** Samples one tile at a time, relative to the tile origin. */
+  uint64_t seed;
+  tph_poisson_real radius;
+  tph_poisson_real tile_size;
+
+  /* Samples closer than this to the tile border are kept in the halo. Slightly wider than the
+   * radius, so that rounding when offsetting samples by the tile origin never leaves out a sample
+   * that is closer than the radius to a sample of an adjacent tile. */
+  tph_poisson_real border;
+
+  tph_poisson_vec samples; /** Samples of the last tile, ElemT = tph_poisson_real. */
+  tph_poisson_vec dropped; /** Non-zero for dropped samples of the tile, ElemT = uint8_t. */
+
+  /* Least recently used cache of tile halos. */
+  tph_poisson_tile_halo *cache;
+  ptrdiff_t cache_size;
+  uint64_t cache_clock;
+
+  /* Arrays of size ndims, scratch variables. */
+  int64_t *neighbor;
+  tph_poisson_real *origin;
+  tph_poisson_real *sample;
+};
+
 /**
  * @brief Returns an allocated instance of sampling internal data. If allocator is NULL,
  * a default allocator is used. The instance must be free'd using the free function that
@@ -624,38 +1846,266 @@ typedef struct tph_poisson_context_
  */
 static tph_poisson_sampling_internal *tph_poisson_alloc_internal(const tph_poisson_allocator *alloc)
 {
-  TPH_POISSON_ASSERT(!alloc || (alloc && ((alloc->malloc != NULL) & (alloc->free != NULL))));
-
-  const ptrdiff_t mem_size =
-    (ptrdiff_t)(sizeof(tph_poisson_sampling_internal) + alignof(tph_poisson_sampling_internal));
-  tph_poisson_malloc_fn malloc_fn =
-    alloc != NULL ? alloc->malloc : tph_poisson_default_alloc.malloc;
-  void *alloc_ctx = alloc != NULL ? alloc->ctx : tph_poisson_default_alloc.ctx;
-  void *mem = malloc_fn(mem_size, alloc_ctx);
+  tph_poisson_allocator internal_alloc;
+  tph_poisson_alloc_copy(alloc, &internal_alloc);
+
+  const ptrdiff_t alignment = (ptrdiff_t)alignof(tph_poisson_sampling_internal);
+  const ptrdiff_t mem_size = (ptrdiff_t)sizeof(tph_poisson_sampling_internal)
+                             + tph_poisson_alloc_slack(&internal_alloc, alignment);
+  void *mem = tph_poisson_mem_alloc(
+    &internal_alloc, mem_size, alignment, TPH_POISSON_ALLOC_OTHER | TPH_POISSON_ALLOC_ZEROED);
   if (mem == NULL) { return NULL; }
-  TPH_POISSON_MEMSET(mem, 0, (size_t)mem_size);
-  void *aligned_mem = tph_poisson_align(mem, alignof(tph_poisson_sampling_internal));
+  void *aligned_mem = tph_poisson_align(mem, (size_t)alignment);
   tph_poisson_sampling_internal *internal = (tph_poisson_sampling_internal *)aligned_mem;
-  internal->alloc.malloc = malloc_fn;
-  internal->alloc.free = alloc != NULL ? alloc->free : tph_poisson_default_alloc.free;
-  internal->alloc.ctx = alloc_ctx;
+  internal->alloc = internal_alloc;
   internal->mem = mem;
   internal->mem_size = mem_size;
   return internal;
 }
 
 /**
- * @brief Initialize the context using the provided allocator and arguments. Sets up the
- * data structures needed to perform a single run, but that don't need to be kept alive
- * after the run has been completed.
- * @param ctx   Context.
- * @param alloc Allocator.
- * @param args  Arguments.
- * @return TPH_POISSON_SUCCESS, or a non-zero error code.
+ * @brief Returns the number of cells in the box [-reach, reach]^ndims, which is an upper bound for
+ * the number of cells in the stencil. Returns zero if the box is too large to be used as a stencil,
+ * in which case neighbor cells are enumerated without a stencil.
+ * @param ndims Number of dimensions.
+ * @param reach Maximum cell offset along any axis.
+ * @return Stencil capacity, or zero.
  */
-static int tph_poisson_context_init(const tph_poisson_allocator *alloc,
-  const tph_poisson_args *args,
-  tph_poisson_context *ctx)
+static ptrdiff_t tph_poisson_stencil_capacity(const int32_t ndims, const int32_t reach)
+{
+  /* Stencil masks store (2 * reach + 1) bits per axis in a 64-bit integer. */
+  const ptrdiff_t width = 2 * (ptrdiff_t)reach + 1;
+  if ((ptrdiff_t)ndims * width > 64) { return 0; }
+  ptrdiff_t capacity = 1;
+  for (int32_t i = 0; i < ndims; ++i) {
+    capacity *= width;
+    if (capacity > TPH_POISSON_STENCIL_MAX_SIZE) { return 0; }
+  }
+  return capacity;
+}
+
+/**
+ * @brief Populates the stencil, i.e. the list of neighbor cells that may hold a sample closer than
+ * the radius to a sample in the center cell. Assumes that grid strides have been initialized and
+ * that the stencil has room for tph_poisson_stencil_capacity cells.
+ *
+ * The minimum distance between a point in the center cell and a point in the cell at offset o is
+ * grid_dx * sqrt(sum(max(|o[i]| - 1, 0)^2)), cells where this distance is not less than the radius
+ * are culled. Since grid_dx is slightly smaller than radius / sqrt(ndims) this comparison never
+ * ties. The remaining cells are stored nearest-first, making early exits more likely when testing
+ * candidates, which are typically rejected because of a nearby sample.
+ *
+ * Each stencil cell stores a bit mask with the bit (i * (2 * reach + 1) + o[i] + reach) set for
+ * each axis i. Testing if a cell lies in a box of allowed offsets then reduces to a single AND.
+ * Linear offsets only apply to the row-major grid order. For the tiled grid order each stencil cell
+ * also stores the bit indices (i * (2 * reach + 1) + o[i] + reach) of its mask, one per axis.
+ * @param ctx Context.
+ */
+static void tph_poisson_stencil_build(tph_poisson_context *ctx)
+{
+  const int32_t ndims = ctx->ndims;
+  const ptrdiff_t reach = ctx->stencil_reach;
+  const ptrdiff_t width = 2 * reach + 1;
+  const double r_sqr = (double)ctx->radius * (double)ctx->radius;
+  const double dx_sqr = (double)ctx->grid_dx * (double)ctx->grid_dx;
+  const ptrdiff_t max_gap_sqr = (ptrdiff_t)ndims * (reach - 1) * (reach - 1);
+
+  /* Use scratch storage to enumerate offsets. */
+  ptrdiff_t *o = ctx->grid_index;
+  ptrdiff_t gap = 0;
+  ptrdiff_t gap_sqr = 0;
+  ptrdiff_t offset = 0;
+  uint64_t mask = 0;
+  int32_t i = 0;
+  ctx->stencil_size = 0;
+
+  /* Enumerate all offsets once for each (integer) squared gap, which gives a stable
+   * nearest-first ordering without having to sort. The stencil is small enough for
+   * this to be cheap. */
+  for (ptrdiff_t key = 0; key <= max_gap_sqr; ++key) {
+    for (i = 0; i < ndims; ++i) { o[i] = -reach; }
+    do {
+      gap_sqr = 0;
+      offset = 0;
+      mask = 0;
+      for (i = 0; i < ndims; ++i) {
+        gap = (o[i] < 0 ? -o[i] : o[i]) - 1;
+        if (gap > 0) { gap_sqr += gap * gap; }
+        offset += o[i] * ctx->grid_stride[i];
+        mask |= (uint64_t)1 << (i * width + o[i] + reach);
+      }
+      if ((int)(gap_sqr == key) & (int)((double)gap_sqr * dx_sqr < r_sqr)) {
+        TPH_POISSON_ASSERT(ctx->stencil_size < tph_poisson_stencil_capacity(ndims, (int32_t)reach));
+        ctx->stencil[ctx->stencil_size].offset = offset;
+        ctx->stencil[ctx->stencil_size].mask = mask;
+        if (ctx->stencil_steps != NULL) {
+          for (i = 0; i < ndims; ++i) {
+            ctx->stencil_steps[ctx->stencil_size * ndims + i] =
+              (uint8_t)(i * width + o[i] + reach);
+          }
+        }
+        ++ctx->stencil_size;
+      }
+
+      /* Next offset, see tph_poisson_existing_sample_within_radius. */
+      for (i = 0; i < ndims; ++i) {
+        if (++o[i] <= reach) { break; }
+        o[i] = -reach;
+      }
+    } while (i != ndims);
+  }
+}
+
+/**
+ * @brief Returns the number of bits per axis used for Z-order indexing inside tiles, see
+ * TPH_POISSON_GRID_ORDER_TILED. Tiles have (1 << tile_bits) cells along each axis.
+ * @param ndims Number of dimensions, 2 or 3.
+ * @return Tile bits.
+ */
+static int32_t tph_poisson_tile_bits(const int32_t ndims)
+{
+  TPH_POISSON_ASSERT(ndims == 2 || ndims == 3);
+  return ndims == 2 ? 4 : 3;
+}
+
+/**
+ * @brief Populates the per-axis index tables for the tiled grid order. Assumes that grid sizes
+ * have been initialized.
+ *
+ * With t = tile_bits, the cell at grid index g is in tile (g[i] >> t) and has local index
+ * l[i] = g[i] & ((1 << t) - 1) along axis i. Inside a tile, bit b of l[i] is stored at bit
+ * (b * ndims + i), i.e. Z-order. Tiles are stored in row-major order. Both terms are sums over
+ * axes, so the linear index is too.
+ * @param ctx Context.
+ */
+static void tph_poisson_grid_axis_build(tph_poisson_context *ctx)
+{
+  const int32_t ndims = ctx->ndims;
+  const int32_t tile_bits = tph_poisson_tile_bits(ndims);
+  const ptrdiff_t tile_width = (ptrdiff_t)1 << tile_bits;
+  ptrdiff_t tile_stride = (ptrdiff_t)1 << (tile_bits * ndims);
+  ptrdiff_t start = 0;
+  ptrdiff_t local = 0;
+  for (int32_t i = 0; i < ndims; ++i) {
+    ctx->grid_axis_start[i] = start;
+    for (ptrdiff_t g = 0; g < ctx->grid_size[i]; ++g) {
+      local = 0;
+      for (int32_t b = 0; b < tile_bits; ++b) {
+        local |= ((g >> b) & 1) << (b * ndims + i);
+      }
+      ctx->grid_axis[start + g] = (g >> tile_bits) * tile_stride + local;
+    }
+    start += ctx->grid_size[i];
+    tile_stride *= (ctx->grid_size[i] + tile_width - 1) >> tile_bits;
+  }
+}
+
+/**
+ * @brief Returns the contribution of grid index xi along axis i to the linear index of a cell.
+ * @param ctx Context.
+ * @param i   Axis.
+ * @param xi  Grid index along axis i.
+ * @return Linear index contribution.
+ */
+static TPH_POISSON_FORCE_INLINE ptrdiff_t tph_poisson_grid_axis_index(
+  const tph_poisson_context *ctx,
+  const int32_t i,
+  const ptrdiff_t xi)
+{
+  TPH_POISSON_ASSERT((0 <= xi) & (xi < ctx->grid_size[i]));
+  /* Cannot overflow, the grid linear size is checked in tph_poisson_context_init. */
+  return ctx->grid_axis != NULL ? ctx->grid_axis[ctx->grid_axis_start[i] + xi]
+                                : xi * ctx->grid_stride[i];
+}
+
+/**
+ * @brief Returns the uniform grid cell extent for the provided radius. Slightly smaller than the
+ * largest extent for which a cell can hold at least one sample, to avoid numerical issues.
+ * @param radius Radius.
+ * @param ndims  Number of dimensions.
+ * @return Cell extent.
+ */
+static tph_poisson_real tph_poisson_grid_dx(const tph_poisson_real radius, const int32_t ndims)
+{
+  return ((tph_poisson_real)0.999 * radius) / TPH_POISSON_SQRT((tph_poisson_real)ndims);
+}
+
+/**
+ * @brief Returns the number of bytes (2, 4 or 8) of the smallest unsigned integer type that holds
+ * the values [0, n]. Grid cells store sample indices plus one in [1, n], zero means empty.
+ * @param n Largest value.
+ * @return Integer size in bytes.
+ */
+static ptrdiff_t tph_poisson_index_size(const ptrdiff_t n)
+{
+  if (n <= (ptrdiff_t)UINT16_MAX) { return (ptrdiff_t)sizeof(uint16_t); }
+  if ((uint64_t)n <= (uint64_t)UINT32_MAX) { return (ptrdiff_t)sizeof(uint32_t); }
+  return (ptrdiff_t)sizeof(uint64_t);
+}
+
+/**
+ * @brief Returns element i of an array of unsigned integers of the provided size (2, 4 or 8
+ * bytes).
+ * @param array Integer array.
+ * @param i     Element index.
+ * @param size  Integer size in bytes.
+ * @return Integer value.
+ */
+static TPH_POISSON_FORCE_INLINE ptrdiff_t tph_poisson_index_load(const void *array,
+  const ptrdiff_t i,
+  const ptrdiff_t size)
+{
+  if (size == (ptrdiff_t)sizeof(uint32_t)) { return (ptrdiff_t)((const uint32_t *)array)[i]; }
+  if (size == (ptrdiff_t)sizeof(uint16_t)) { return (ptrdiff_t)((const uint16_t *)array)[i]; }
+  TPH_POISSON_ASSERT(size == (ptrdiff_t)sizeof(uint64_t));
+  return (ptrdiff_t)((const uint64_t *)array)[i];
+}
+
+/**
+ * @brief Sets element i of an array of unsigned integers of the provided size (2, 4 or 8 bytes).
+ * @param array Integer array.
+ * @param i     Element index.
+ * @param size  Integer size in bytes.
+ * @param value Non-negative value that fits in the integer type.
+ */
+static TPH_POISSON_FORCE_INLINE void tph_poisson_index_store(void *array,
+  const ptrdiff_t i,
+  const ptrdiff_t size,
+  const ptrdiff_t value)
+{
+  TPH_POISSON_ASSERT(value >= 0);
+  if (size == (ptrdiff_t)sizeof(uint32_t)) {
+    TPH_POISSON_ASSERT((uint64_t)value <= (uint64_t)UINT32_MAX);
+    ((uint32_t *)array)[i] = (uint32_t)value;
+  } else if (size == (ptrdiff_t)sizeof(uint16_t)) {
+    TPH_POISSON_ASSERT(value <= (ptrdiff_t)UINT16_MAX);
+    ((uint16_t *)array)[i] = (uint16_t)value;
+  } else {
+    TPH_POISSON_ASSERT(size == (ptrdiff_t)sizeof(uint64_t));
+    ((uint64_t *)array)[i] = (uint64_t)value;
+  }
+}
+
+/**
+ * @brief Returns the volume of the unit ball, V(n) = V(n - 2) * 2 * pi / n.
+ * @param ndims Number of dimensions.
+ * @return Volume of the unit ball.
+ */
+static double tph_poisson_unit_ball_volume(const int32_t ndims)
+{
+  double volume = (ndims & 1) == 1 ? 2.0 : 1.0; /* V(1) or V(0). */
+  for (int32_t n = 2 + (ndims & 1); n <= ndims; n += 2) {
+    volume *= TPH_POISSON_TWO_PI / (double)n;
+  }
+  return volume;
+}
+
+/**
+ * @brief Checks the arguments, see tph_poisson_create for the requirements.
+ * @param args Arguments.
+ * @return TPH_POISSON_SUCCESS, or TPH_POISSON_INVALID_ARGS.
+ */
+static int tph_poisson_args_validate(const tph_poisson_args *args)
 {
   /* clang-format off */
   bool valid_args = (args != NULL);
@@ -665,32 +2115,140 @@ static int tph_poisson_context_init(const tph_poisson_allocator *alloc,
   valid_args &= (args->max_sample_attempts > 0);
   valid_args &= (args->bounds_min != NULL);
   valid_args &= (args->bounds_max != NULL);
+  valid_args &= ((int)(args->candidate_method == TPH_POISSON_CANDIDATES_REJECTION)
+                 | (int)(args->candidate_method == TPH_POISSON_CANDIDATES_POLAR
+                         && (args->ndims == 2 || args->ndims == 3))
+                 | (int)(args->candidate_method == TPH_POISSON_CANDIDATES_GAUSSIAN)
+                 | (int)(args->candidate_method == TPH_POISSON_CANDIDATES_ANGULAR
+                         && args->ndims == 2)) == 1;
+  valid_args &= ((int)(args->annulus_outer_factor > 1)
+                 | (int)(args->annulus_outer_factor >= 0 && args->annulus_outer_factor <= 0)) == 1;
+  valid_args &= ((int)(args->grid_storage == TPH_POISSON_GRID_INDICES)
+                 | (int)(args->grid_storage == TPH_POISSON_GRID_POINTS)) == 1;
+  valid_args &= ((int)(args->grid_order == TPH_POISSON_GRID_ORDER_ROW_MAJOR)
+                 | (int)(args->grid_order == TPH_POISSON_GRID_ORDER_TILED
+                         && (args->ndims == 2 || args->ndims == 3))) == 1;
+  valid_args &= (args->grid_max_dense_size >= 0);
+  valid_args &= ((int)(args->prng == TPH_POISSON_PRNG_XOSHIRO256P)
+                 | (int)(args->prng == TPH_POISSON_PRNG_XOSHIRO256P_X4)) == 1;
+  valid_args &= ((int)(args->output_layout == TPH_POISSON_LAYOUT_AOS)
+                 | (int)(args->output_layout == TPH_POISSON_LAYOUT_SOA)) == 1;
   if (!valid_args) { return TPH_POISSON_INVALID_ARGS; }
   for (int32_t i = 0; i < args->ndims; ++i) {
     valid_args &= (args->bounds_max[i] > args->bounds_min[i]);
   }
   if (!valid_args) { return TPH_POISSON_INVALID_ARGS; }
   /* clang-format on */
+  return TPH_POISSON_SUCCESS;
+}
+
+/**
+ * @brief Returns the outer radius of the candidate annulus relative to the radius, see
+ * tph_poisson_args.annulus_outer_factor.
+ * @param args Arguments, assumed to be valid.
+ * @return Outer annulus radius factor.
+ */
+static double tph_poisson_annulus_outer(const tph_poisson_args *args)
+{
+  if (args->annulus_outer_factor > 1) { return (double)args->annulus_outer_factor; }
+  return args->candidate_method == TPH_POISSON_CANDIDATES_ANGULAR ? 1.001 : 2.0;
+}
+
+/**
+ * @brief Initialize the context using the provided allocator and arguments. Sets up the
+ * data structures needed to perform a single run, but that don't need to be kept alive
+ * after the run has been completed. If the allocator is NULL nothing is allocated, only the
+ * grid layout and the size of the context memory (ctx->mem_size) are computed.
+ * @param ctx   Context.
+ * @param alloc Allocator, or NULL.
+ * @param args  Arguments.
+ * @return TPH_POISSON_SUCCESS, or a non-zero error code.
+ */
+static int tph_poisson_context_init(const tph_poisson_allocator *alloc,
+  const tph_poisson_args *args,
+  tph_poisson_context *ctx)
+{
+  const int valid = tph_poisson_args_validate(args);
+  if (valid != TPH_POISSON_SUCCESS) { return valid; }
 
   ctx->radius = args->radius;
   ctx->ndims = args->ndims;
   ctx->max_sample_attempts = args->max_sample_attempts;
-
-  /* Use a slightly smaller radius to avoid numerical issues. */
-  ctx->grid_dx =
-    ((tph_poisson_real)0.999 * ctx->radius) / TPH_POISSON_SQRT((tph_poisson_real)ctx->ndims);
+  ctx->attempt_budget = 0;
+  ctx->candidate_method = args->candidate_method;
+  ctx->annulus_outer = tph_poisson_annulus_outer(args);
+  ctx->angular_start = 0;
+  ctx->candidate_batch_size =
+    args->candidate_batch_size > 0 ? args->candidate_batch_size : TPH_POISSON_CANDIDATE_BATCH_SIZE;
+  ctx->candidate_batch_size = ctx->candidate_batch_size < ctx->max_sample_attempts
+                                ? ctx->candidate_batch_size
+                                : ctx->max_sample_attempts;
+  ctx->candidate_batch_size =
+    ctx->candidate_batch_size < 1024 ? ctx->candidate_batch_size : UINT32_C(1024);
+  const ptrdiff_t batch_size =
+    ctx->candidate_batch_size > 1 ? (ptrdiff_t)ctx->candidate_batch_size : 0;
+
+  ctx->grid_dx = tph_poisson_grid_dx(ctx->radius, ctx->ndims);
   ctx->grid_dx_rcp = (tph_poisson_real)1 / ctx->grid_dx;
 
-  /* Seed pseudo-random number generator. */
+  /* Seed pseudo-random number generator. The multi-stream generator state is stored in context
+   * memory and initialized below. */
   tph_poisson_xoshiro256p_init(&ctx->prng_state, args->seed);
-
-  /* Compute grid linear size so that we know how much memory to allocate for grid cells. */
+  const bool prng_x4 = args->prng == TPH_POISSON_PRNG_XOSHIRO256P_X4;
+
+  /* Compute grid linear size so that we know how much memory to allocate for grid cells. A tiled
+   * grid is padded to a whole number of tiles along each axis. Sizes are checked so that linear
+   * grid indices can never overflow. */
+  const bool tiled = args->grid_order == TPH_POISSON_GRID_ORDER_TILED;
+  const ptrdiff_t tile_mask = tiled ? ((ptrdiff_t)1 << tph_poisson_tile_bits(ctx->ndims)) - 1 : 0;
+  const tph_poisson_real max_extent = (tph_poisson_real)(PTRDIFF_MAX / 4);
+  tph_poisson_real extent = 0;
+  ptrdiff_t grid_axis_size = 0;
+  ptrdiff_t size_i = 0;
   ctx->grid_linear_size = 1;
   for (int32_t i = 0; i < ctx->ndims; ++i) {
-    /* Not checking for overflow! */
-    ctx->grid_linear_size *=
-      (ptrdiff_t)TPH_POISSON_CEIL((args->bounds_max[i] - args->bounds_min[i]) * ctx->grid_dx_rcp);
+    extent = TPH_POISSON_CEIL((args->bounds_max[i] - args->bounds_min[i]) * ctx->grid_dx_rcp);
+    if (!(extent < max_extent)) { return TPH_POISSON_OVERFLOW; }
+    size_i = ((ptrdiff_t)extent + tile_mask) & ~tile_mask;
+    if (size_i > PTRDIFF_MAX / ctx->grid_linear_size) { return TPH_POISSON_OVERFLOW; }
+    ctx->grid_linear_size *= size_i;
+    grid_axis_size += (ptrdiff_t)extent;
+  }
+
+  /* A sample can only be closer than the radius to samples in cells at most this many cells away
+   * along each axis. */
+  ctx->stencil_reach = (int32_t)TPH_POISSON_CEIL(ctx->radius * ctx->grid_dx_rcp);
+  const ptrdiff_t stencil_capacity = tph_poisson_stencil_capacity(ctx->ndims, ctx->stencil_reach);
+
+  /* Number of bytes per grid cell. Sample indices are stored in the smallest integer type that
+   * holds the largest possible number of samples, which halves grid memory for small samplings
+   * and lifts the limit on the number of samples for very large ones. Same for the linear grid
+   * indices in the active list. */
+  const bool store_points = args->grid_storage == TPH_POISSON_GRID_POINTS;
+  ctx->grid_storage = args->grid_storage;
+  if (store_points) {
+    ctx->grid_cell_size = (ptrdiff_t)(ctx->ndims) * (ptrdiff_t)sizeof(tph_poisson_real);
+  } else {
+    ptrdiff_t max_samples = 0;
+    const int ret = tph_poisson_max_samples(args, &max_samples);
+    if (ret != TPH_POISSON_SUCCESS) { return ret; }
+    ctx->grid_cell_size = tph_poisson_index_size(max_samples);
   }
+  ctx->active_cell_size = tph_poisson_index_size(ctx->grid_linear_size);
+
+  /* Use a sparse grid if the dense grid would be too large. The dense grid size limit is also
+   * capped so that the total context memory size cannot overflow. */
+  ptrdiff_t max_dense_size =
+    args->grid_max_dense_size > 0 ? args->grid_max_dense_size : TPH_POISSON_GRID_MAX_DENSE_SIZE;
+  max_dense_size = max_dense_size < PTRDIFF_MAX / 4 ? max_dense_size : PTRDIFF_MAX / 4;
+  const bool sparse = ctx->grid_linear_size > max_dense_size / ctx->grid_cell_size;
+  ctx->grid_page_count =
+    sparse ? (ctx->grid_linear_size >> TPH_POISSON_GRID_PAGE_BITS)
+               + (ptrdiff_t)((ctx->grid_linear_size
+                               & (((ptrdiff_t)1 << TPH_POISSON_GRID_PAGE_BITS) - 1))
+                             != 0)
+           : 0;
+  const ptrdiff_t occupancy_words = (ctx->grid_linear_size + 63) >> 6;
 
   /* clang-format off */
   ctx->mem_size = 
@@ -700,12 +2258,58 @@ static int tph_poisson_context_init(const tph_poisson_allocator *alloc,
     /* grid_index, min_grid_index, max_grid_index, grid.size, grid.stride*/
     (ptrdiff_t)(ctx->ndims * 5) * (ptrdiff_t)sizeof(ptrdiff_t) 
       + (ptrdiff_t)alignof(ptrdiff_t) +  
-    /* grid.cells */         
-    ctx->grid_linear_size * (ptrdiff_t)sizeof(uint32_t) + (ptrdiff_t)alignof(uint32_t); 
-  ctx->mem = alloc->malloc(ctx->mem_size, alloc->ctx);
+    /* stencil */
+    stencil_capacity * (ptrdiff_t)sizeof(tph_poisson_stencil_cell)
+      + (ptrdiff_t)alignof(tph_poisson_stencil_cell) +
+    /* grid_axis, grid_axis_start, stencil_steps (tiled only) */
+    (tiled ? (grid_axis_size + ctx->ndims) * (ptrdiff_t)sizeof(ptrdiff_t)
+            + stencil_capacity * ctx->ndims * (ptrdiff_t)sizeof(uint8_t)
+          : 0) +
+    /* grid.pages, grid.page_mem (sparse only) */
+    ctx->grid_page_count * 2 * (ptrdiff_t)sizeof(void *) + (ptrdiff_t)alignof(void *) +
+    /* prng_x4 (multi-stream generator only) */
+    (prng_x4 ? (ptrdiff_t)sizeof(tph_poisson_xoshiro256p_x4_state) : 0) +
+    /* candidates, candidate_prng_states or candidate_prng_x4_states, candidate_inside
+     * (batched only) */
+    batch_size * ((ptrdiff_t)(ctx->ndims) * (ptrdiff_t)sizeof(tph_poisson_real)
+                  + (prng_x4 ? (ptrdiff_t)sizeof(tph_poisson_xoshiro256p_x4_state)
+                             : (ptrdiff_t)sizeof(tph_poisson_xoshiro256p_state))
+                  + (ptrdiff_t)sizeof(uint8_t))
+      + (ptrdiff_t)alignof(tph_poisson_real) + (ptrdiff_t)alignof(tph_poisson_xoshiro256p_x4_state);
+  /* Dense grid cells, rounded up to the alignment of the occupancy words that follow them. Both
+   * are aligned to uint64_t, which is at least the cell alignment. */
+  ctx->grid_mem_size =
+    sparse ? 0
+           : ((ctx->grid_linear_size * ctx->grid_cell_size + (ptrdiff_t)sizeof(uint64_t) - 1)
+               & ~((ptrdiff_t)sizeof(uint64_t) - 1))
+               + occupancy_words * (ptrdiff_t)sizeof(uint64_t);
   /* clang-format on */
+  if (alloc == NULL) { return TPH_POISSON_SUCCESS; }
+
+  /* Context memory starts out zeroed, so that sparse grid pages are NULL. */
+  ctx->mem = tph_poisson_mem_alloc(alloc,
+    ctx->mem_size,
+    (ptrdiff_t)alignof(tph_poisson_real),
+    TPH_POISSON_ALLOC_OTHER | TPH_POISSON_ALLOC_ZEROED);
   if (ctx->mem == NULL) { return TPH_POISSON_BAD_ALLOC; }
-  TPH_POISSON_MEMSET(ctx->mem, 0, (size_t)ctx->mem_size);
+
+  /* The dense grid also starts out zeroed, which means empty for cells storing sample indices
+   * and for the occupancy bitmap. Zeroed memory from the allocator is not written here, so that
+   * the grid is only touched where samples are added. */
+  if (!sparse) {
+    ctx->grid_mem = tph_poisson_mem_alloc(alloc,
+      ctx->grid_mem_size + tph_poisson_alloc_slack(alloc, (ptrdiff_t)alignof(uint64_t)),
+      (ptrdiff_t)alignof(uint64_t),
+      TPH_POISSON_ALLOC_GRID | TPH_POISSON_ALLOC_ZEROED);
+    if (ctx->grid_mem == NULL) {
+      tph_poisson_mem_free(alloc, ctx->mem, ctx->mem_size, TPH_POISSON_ALLOC_OTHER);
+      return TPH_POISSON_BAD_ALLOC;
+    }
+    uint8_t *grid_cells = (uint8_t *)tph_poisson_align(ctx->grid_mem, alignof(uint64_t));
+    ctx->grid_cells = grid_cells;
+    ctx->grid_occupancy =
+      (uint64_t *)(grid_cells + ctx->grid_mem_size - occupancy_words * (ptrdiff_t)sizeof(uint64_t));
+  }
 
   /* Initialize context pointers. Make sure alignment is correct. */
   void *ptr = ctx->mem;
@@ -734,8 +2338,37 @@ static int tph_poisson_context_init(const tph_poisson_allocator *alloc,
   TPH_POISSON_CTX_ALLOC(tph_poisson_real, ctx->ndims, ctx->bounds_min);
   TPH_POISSON_CTX_ALLOC(tph_poisson_real, ctx->ndims, ctx->bounds_max);
   TPH_POISSON_CTX_ALLOC(tph_poisson_real, ctx->ndims, ctx->sample);
-  ptr = tph_poisson_align(ptr, alignof(uint32_t));
-  TPH_POISSON_CTX_ALLOC(uint32_t, ctx->grid_linear_size, ctx->grid_cells);
+  if (stencil_capacity > 0) {
+    ptr = tph_poisson_align(ptr, alignof(tph_poisson_stencil_cell));
+    TPH_POISSON_CTX_ALLOC(tph_poisson_stencil_cell, stencil_capacity, ctx->stencil);
+  }
+  if (tiled) {
+    /* Alignment of ptrdiff_t is not larger than that of the stencil cells. */
+    TPH_POISSON_ASSERT(stencil_capacity > 0);
+    TPH_POISSON_CTX_ALLOC(ptrdiff_t, grid_axis_size, ctx->grid_axis);
+    TPH_POISSON_CTX_ALLOC(ptrdiff_t, ctx->ndims, ctx->grid_axis_start);
+    TPH_POISSON_CTX_ALLOC(uint8_t, stencil_capacity * ctx->ndims, ctx->stencil_steps);
+  }
+  if (sparse) {
+    /* Pages are NULL (i.e. not allocated) after the context memory has been zeroed. */
+    ptr = tph_poisson_align(ptr, alignof(void *));
+    TPH_POISSON_CTX_ALLOC(void *, ctx->grid_page_count, ctx->grid_pages);
+    TPH_POISSON_CTX_ALLOC(void *, ctx->grid_page_count, ctx->grid_page_mem);
+  }
+  /* Generator states have the same alignment, that of uint64_t. */
+  ptr = tph_poisson_align(ptr, alignof(tph_poisson_xoshiro256p_x4_state));
+  if (prng_x4) { TPH_POISSON_CTX_ALLOC(tph_poisson_xoshiro256p_x4_state, 1, ctx->prng_x4); }
+  if (batch_size > 0) {
+    if (prng_x4) {
+      TPH_POISSON_CTX_ALLOC(
+        tph_poisson_xoshiro256p_x4_state, batch_size, ctx->candidate_prng_x4_states);
+    } else {
+      TPH_POISSON_CTX_ALLOC(tph_poisson_xoshiro256p_state, batch_size, ctx->candidate_prng_states);
+    }
+    ptr = tph_poisson_align(ptr, alignof(tph_poisson_real));
+    TPH_POISSON_CTX_ALLOC(tph_poisson_real, batch_size * ctx->ndims, ctx->candidates);
+    TPH_POISSON_CTX_ALLOC(uint8_t, batch_size, ctx->candidate_inside);
+  }
 #undef TPH_POISSON_CTX_ALLOC
 
   /* Copy bounds into context memory buffer to improve locality. */
@@ -754,435 +2387,2944 @@ static int tph_poisson_context_init(const tph_poisson_allocator *alloc,
     ctx->grid_stride[i] = ctx->grid_stride[i - 1] * ctx->grid_size[i - 1];
   }
 
-  /* Initialize cells with sentinel value 0xFFFFFFFF, indicating no sample there.
-   * Cell values are later set to sample indices. */
-  TPH_POISSON_MEMSET(
-    ctx->grid_cells, 0xFF, (size_t)(ctx->grid_linear_size * (ptrdiff_t)sizeof(uint32_t)));
+  if (prng_x4) { tph_poisson_xoshiro256p_x4_init(ctx->prng_x4, args->seed); }
+
+  if (tiled) { tph_poisson_grid_axis_build(ctx); }
+
+  /* Stencil cells store linear offsets, which depend on the grid strides. */
+  if (stencil_capacity > 0) { tph_poisson_stencil_build(ctx); }
+
+  /* Cells storing points are initialized with all bits set, which gives NaN coordinates that are
+   * never closer than the radius to anything. Cells storing sample indices are already empty.
+   * Sparse grid pages are initialized when allocated. */
+  if (!sparse && store_points) {
+    TPH_POISSON_MEMSET(
+      ctx->grid_cells, 0xFF, (size_t)(ctx->grid_linear_size * ctx->grid_cell_size));
+  }
+
+  return TPH_POISSON_SUCCESS;
+}
+
+/**
+ * @brief Returns the alignment of grid cells, sample indices are aligned to their size.
+ * @param ctx Context.
+ * @return Cell alignment.
+ */
+static TPH_POISSON_INLINE ptrdiff_t tph_poisson_grid_cell_alignment(const tph_poisson_context *ctx)
+{
+  return ctx->grid_storage == TPH_POISSON_GRID_POINTS ? (ptrdiff_t)alignof(tph_poisson_real)
+                                                       : ctx->grid_cell_size;
+}
+
+/**
+ * @brief Returns the byte value of empty grid cells, see tph_poisson_context_init.
+ * @param ctx Context.
+ * @return Byte value, all bits set (NaN coordinates) for points and zero for sample indices.
+ */
+static TPH_POISSON_INLINE int tph_poisson_grid_empty_byte(const tph_poisson_context *ctx)
+{
+  return ctx->grid_storage == TPH_POISSON_GRID_POINTS ? 0xFF : 0;
+}
+
+/**
+ * @brief Returns the number of bytes allocated for each sparse grid page.
+ * @param ctx Context.
+ * @return Page allocation size.
+ */
+static TPH_POISSON_INLINE ptrdiff_t tph_poisson_grid_page_alloc_size(const tph_poisson_context *ctx)
+{
+  return (ctx->grid_cell_size << TPH_POISSON_GRID_PAGE_BITS) + tph_poisson_grid_cell_alignment(ctx);
+}
+
+/**
+ * @brief Frees all memory allocated by the context.
+ * @param ctx Context.
+ */
+static void tph_poisson_context_destroy(tph_poisson_context *ctx, tph_poisson_allocator *alloc)
+{
+  TPH_POISSON_ASSERT(ctx && alloc);
+  tph_poisson_vec_free(&ctx->active_cells, alloc, TPH_POISSON_ALLOC_ACTIVE);
+  for (ptrdiff_t i = 0; i < ctx->grid_page_count; ++i) {
+    if (ctx->grid_page_mem[i] != NULL) {
+      tph_poisson_mem_free(alloc,
+        ctx->grid_page_mem[i],
+        tph_poisson_grid_page_alloc_size(ctx),
+        TPH_POISSON_ALLOC_GRID);
+    }
+  }
+  if (ctx->grid_mem != NULL) {
+    tph_poisson_mem_free(alloc,
+      ctx->grid_mem,
+      ctx->grid_mem_size + tph_poisson_alloc_slack(alloc, (ptrdiff_t)alignof(uint64_t)),
+      TPH_POISSON_ALLOC_GRID);
+  }
+  tph_poisson_mem_free(alloc, ctx->mem, ctx->mem_size, TPH_POISSON_ALLOC_OTHER);
+}
+
+/**
+ * @brief Returns the cells of a dense grid, or the cells of the sparse grid page that holds
+ * linear grid index k. In both cases k is updated to index into the returned cells. Returns NULL
+ * if the page has not been allocated, in which case the cell is empty.
+ * @param ctx Context.
+ * @param k   Linear grid index, updated to be relative to the returned cells.
+ * @return Grid cells, or NULL.
+ */
+static TPH_POISSON_FORCE_INLINE void *tph_poisson_grid_cells(const tph_poisson_context *ctx,
+  ptrdiff_t *k)
+{
+  TPH_POISSON_ASSERT((0 <= *k) & (*k < ctx->grid_linear_size));
+  if (ctx->grid_pages == NULL) { return ctx->grid_cells; }
+  void *page = ctx->grid_pages[*k >> TPH_POISSON_GRID_PAGE_BITS];
+  *k &= ((ptrdiff_t)1 << TPH_POISSON_GRID_PAGE_BITS) - 1;
+  return page;
+}
+
+/**
+ * @brief Allocates the sparse grid page holding linear grid index k, with all cells empty.
+ * @param ctx   Context.
+ * @param alloc Allocator.
+ * @param k     Linear grid index.
+ * @return TPH_POISSON_SUCCESS, or a non-zero error code.
+ */
+static int tph_poisson_grid_page_alloc(tph_poisson_context *ctx,
+  tph_poisson_allocator *alloc,
+  const ptrdiff_t k)
+{
+  const ptrdiff_t page_index = k >> TPH_POISSON_GRID_PAGE_BITS;
+  TPH_POISSON_ASSERT(ctx->grid_pages != NULL);
+  TPH_POISSON_ASSERT(ctx->grid_pages[page_index] == NULL);
+  const int empty = tph_poisson_grid_empty_byte(ctx);
+  void *mem = tph_poisson_mem_alloc(alloc,
+    tph_poisson_grid_page_alloc_size(ctx),
+    tph_poisson_grid_cell_alignment(ctx),
+    empty == 0 ? TPH_POISSON_ALLOC_GRID | TPH_POISSON_ALLOC_ZEROED : TPH_POISSON_ALLOC_GRID);
+  if (mem == NULL) { return TPH_POISSON_BAD_ALLOC; }
+  void *page = tph_poisson_align(mem, (size_t)tph_poisson_grid_cell_alignment(ctx));
+  if (empty != 0) {
+    TPH_POISSON_MEMSET(
+      page, empty, (size_t)(ctx->grid_cell_size << TPH_POISSON_GRID_PAGE_BITS));
+  }
+  ctx->grid_page_mem[page_index] = mem;
+  ctx->grid_pages[page_index] = page;
+  return TPH_POISSON_SUCCESS;
+}
+
+/**
+ * @brief Returns true if p is element-wise inclusively inside b_min and b_max; otherwise false.
+ * Assumes that b_min is element-wise less than b_max.
+ * @param p     Position to test.
+ * @param b_min Minimum bounds.
+ * @param b_max Maximum bounds.
+ * @param ndims Number of values in p, b_min, and b_max.
+ * @return Non-zero if p is element-wise inclusively inside the bounded region; otherwise zero.
+ */
+static TPH_POISSON_FORCE_INLINE bool tph_poisson_inside(const tph_poisson_real *p,
+  const tph_poisson_real *b_min,
+  const tph_poisson_real *b_max,
+  const int32_t ndims)
+{
+  /* Note returns true if ndims <= 0.  */
+  bool inside = true;
+  for (int32_t i = 0; i < ndims; ++i) {
+    /* No early exit, always check all dims. */
+    TPH_POISSON_ASSERT(b_min[i] < b_max[i]);
+    inside &= (p[i] >= b_min[i]);
+    inside &= (p[i] <= b_max[i]);
+  }
+  return inside;
+}
+
+/**
+ * @brief Returns true if a candidate sample is inside the bounds and, for parallel sampling, in
+ * the tile being sampled; otherwise false.
+ * @param ctx   Context.
+ * @param p     Candidate sample position.
+ * @param ndims Number of dimensions, same as ctx->ndims.
+ * @return Non-zero if the candidate may be added; otherwise zero.
+ */
+static TPH_POISSON_FORCE_INLINE bool tph_poisson_candidate_inside(const tph_poisson_context *ctx,
+  const tph_poisson_real *p,
+  const int32_t ndims)
+{
+  bool inside = tph_poisson_inside(p, ctx->bounds_min, ctx->bounds_max, ndims);
+  if (inside && ctx->region_min != NULL) {
+    /* Same grid indices as in tph_poisson_add_sample, so that tiles never share cells. */
+    ptrdiff_t xi = 0;
+    for (int32_t i = 0; i < ndims; ++i) {
+      xi = (ptrdiff_t)TPH_POISSON_FLOOR((p[i] - ctx->bounds_min[i]) * ctx->grid_dx_rcp);
+      inside &= (xi >= ctx->region_min[i]);
+      inside &= (xi < ctx->region_max[i]);
+    }
+  }
+  return inside;
+}
+
+/**
+ * @brief Returns the linear grid index of the cell containing a sample.
+ * @param ctx    Context.
+ * @param sample Sample position, inside the bounds.
+ * @param ndims  Number of dimensions, same as ctx->ndims.
+ * @return Linear grid index.
+ */
+static TPH_POISSON_FORCE_INLINE ptrdiff_t tph_poisson_cell_index(const tph_poisson_context *ctx,
+  const tph_poisson_real *sample,
+  const int32_t ndims)
+{
+  ptrdiff_t k = 0;
+  for (int32_t i = 0; i < ndims; ++i) {
+    k += tph_poisson_grid_axis_index(ctx,
+      i,
+      (ptrdiff_t)TPH_POISSON_FLOOR((sample[i] - ctx->bounds_min[i]) * ctx->grid_dx_rcp));
+  }
+  return k;
+}
+
+/**
+ * @brief Appends a linear grid index to the active list.
+ * @param ctx   Context.
+ * @param alloc Allocator.
+ * @param k     Linear grid index.
+ * @return TPH_POISSON_SUCCESS, or a non-zero error code.
+ */
+static TPH_POISSON_FORCE_INLINE int tph_poisson_active_push(tph_poisson_context *ctx,
+  tph_poisson_allocator *alloc,
+  const ptrdiff_t k)
+{
+  uint64_t buf = 0;
+  tph_poisson_index_store(&buf, 0, ctx->active_cell_size, k);
+  return tph_poisson_vec_append(&ctx->active_cells,
+    alloc,
+    &buf,
+    ctx->active_cell_size,
+    ctx->active_cell_size,
+    TPH_POISSON_ALLOC_ACTIVE);
+}
+
+/**
+ * @brief Passes the samples that have not yet been passed to the stream, and drops them from the
+ * sample buffer unless they are retained.
+ * @param internal Internal data, with a stream.
+ * @param ndims    Number of dimensions.
+ */
+static void tph_poisson_stream_flush(tph_poisson_sampling_internal *internal, const int32_t ndims)
+{
+  TPH_POISSON_ASSERT(internal->stream != NULL);
+  const ptrdiff_t sample_size = (ptrdiff_t)sizeof(tph_poisson_real) * ndims;
+  const ptrdiff_t nsamples = tph_poisson_vec_size(&internal->samples) / sample_size;
+  const ptrdiff_t n = nsamples - internal->stream_flushed;
+  if (n == 0) { return; }
+  internal->stream->samples(
+    (const tph_poisson_real *)internal->samples.begin + internal->stream_flushed * ndims,
+    n,
+    internal->stream->ctx);
+  internal->stream_count += n;
+  if (internal->stream->retain_samples != 0) {
+    internal->stream_flushed = nsamples;
+  } else {
+    internal->samples.end = internal->samples.begin;
+  }
+}
+
+/**
+ * @brief Add a sample, which is assumed here to fulfill all the Poisson requirements. Updates the
+ * necessary internal data structures and the context.
+ * @param ctx      Context.
+ * @param internal Internal data.
+ * @param sample   Sample to add.
+ * @param ndims    Number of dimensions, same as ctx->ndims.
+ * @return TPH_POISSON_SUCCESS, or a non-zero error code.
+ */
+static TPH_POISSON_FORCE_INLINE int tph_poisson_add_sample(tph_poisson_context *ctx,
+  tph_poisson_sampling_internal *internal,
+  const tph_poisson_real *sample,
+  const int32_t ndims)
+{
+  TPH_POISSON_ASSERT(ndims == ctx->ndims);
+  TPH_POISSON_ASSERT(tph_poisson_inside(sample, ctx->bounds_min, ctx->bounds_max, ndims));
+  TPH_POISSON_ASSERT(
+    tph_poisson_vec_size(&internal->samples) % ((ptrdiff_t)sizeof(tph_poisson_real) * ndims)
+    == 0);
+  const ptrdiff_t sample_index =
+    tph_poisson_vec_size(&internal->samples) / ((ptrdiff_t)sizeof(tph_poisson_real) * ndims);
+  if (ctx->grid_storage == TPH_POISSON_GRID_INDICES
+      && tph_poisson_index_size(sample_index + 1) > ctx->grid_cell_size) {
+    /* The sample index plus one must fit in a grid cell. Cannot happen unless the bound used
+     * to pick the cell size is wrong, see tph_poisson_context_init. */
+    return TPH_POISSON_OVERFLOW;
+  }
+  if (internal->samples_capped && sample_index == internal->max_samples) {
+    /* The sample buffer is full, see tph_poisson_create_into and tph_poisson_create_in_arena. */
+    return TPH_POISSON_TRUNCATED;
+  }
+
+  const ptrdiff_t k = tph_poisson_cell_index(ctx, sample, ndims);
+  int ret = TPH_POISSON_SUCCESS;
+  ptrdiff_t kk = k;
+  void *cells = tph_poisson_grid_cells(ctx, &kk);
+  if (cells == NULL) {
+    ret = tph_poisson_grid_page_alloc(ctx, &internal->alloc, k);
+    if (ret != TPH_POISSON_SUCCESS) { return ret; }
+    kk = k;
+    cells = tph_poisson_grid_cells(ctx, &kk);
+  }
+
+  ret = tph_poisson_vec_append(&internal->samples,
+    &internal->alloc,
+    sample,
+    (ptrdiff_t)sizeof(tph_poisson_real) * ndims,
+    (ptrdiff_t)alignof(tph_poisson_real),
+    TPH_POISSON_ALLOC_SAMPLES);
+  if (ret != TPH_POISSON_SUCCESS) { return ret; }
+  ret = tph_poisson_active_push(ctx, &internal->alloc, k);
+  if (ret != TPH_POISSON_SUCCESS) { return ret; }
+
+  /* Record sample in grid. Each grid cell can hold up to one sample,
+   * and once a cell has been assigned a sample it should not be updated.
+   * It is assumed here that the cell is empty before being assigned a
+   * sample. Cells store sample indices plus one, zero means empty. */
+  if (ctx->grid_storage == TPH_POISSON_GRID_POINTS) {
+    tph_poisson_real *cell_point = (tph_poisson_real *)cells + kk * ndims;
+    TPH_POISSON_ASSERT(!(cell_point[0] <= cell_point[0]));
+    for (int32_t i = 0; i < ndims; ++i) { cell_point[i] = sample[i]; }
+  } else {
+    TPH_POISSON_ASSERT(tph_poisson_index_load(cells, kk, ctx->grid_cell_size) == 0);
+    tph_poisson_index_store(cells, kk, ctx->grid_cell_size, sample_index + 1);
+  }
+  if (ctx->grid_occupancy != NULL) {
+#ifdef TPH_POISSON_ATOMIC_OR_U64
+    if (ctx->region_min != NULL) {
+      TPH_POISSON_ATOMIC_OR_U64(&ctx->grid_occupancy[k >> 6], (uint64_t)1 << (k & 63));
+    } else {
+      ctx->grid_occupancy[k >> 6] |= (uint64_t)1 << (k & 63);
+    }
+#else
+    ctx->grid_occupancy[k >> 6] |= (uint64_t)1 << (k & 63);
+#endif
+  }
+  if (internal->stream != NULL
+      && sample_index + 1 - internal->stream_flushed == internal->stream_chunk_size) {
+    tph_poisson_stream_flush(internal, ndims);
+  }
+  return TPH_POISSON_SUCCESS;
+}
+
+/**
+ * @brief Empties the grid cells holding the provided samples, which are assumed to be all the
+ * samples in the grid. Dense grids where many cells are occupied are re-initialized entirely
+ * instead, which is faster than resetting cells one at a time. Sparse grid pages are kept.
+ * @param ctx     Context.
+ * @param samples Samples, ElemT = tph_poisson_real.
+ */
+static void tph_poisson_grid_clear(tph_poisson_context *ctx, const tph_poisson_vec *samples)
+{
+  const int32_t ndims = ctx->ndims;
+  const ptrdiff_t nsamples =
+    tph_poisson_vec_size(samples) / ((ptrdiff_t)sizeof(tph_poisson_real) * ndims);
+  if (ctx->grid_pages == NULL && nsamples > ctx->grid_linear_size / 8) {
+    /* See tph_poisson_context_init. */
+    TPH_POISSON_MEMSET(ctx->grid_cells,
+      tph_poisson_grid_empty_byte(ctx),
+      (size_t)(ctx->grid_linear_size * ctx->grid_cell_size));
+    TPH_POISSON_MEMSET(ctx->grid_occupancy,
+      0,
+      (size_t)((ctx->grid_linear_size + 63) >> 6) * sizeof(uint64_t));
+    return;
+  }
+  const tph_poisson_real *sample = (const tph_poisson_real *)samples->begin;
+  const int empty = tph_poisson_grid_empty_byte(ctx);
+  ptrdiff_t k = 0;
+  ptrdiff_t kk = 0;
+  void *cells = NULL;
+  for (ptrdiff_t j = 0; j < nsamples; ++j, sample += ndims) {
+    k = tph_poisson_cell_index(ctx, sample, ndims);
+    kk = k;
+    cells = tph_poisson_grid_cells(ctx, &kk);
+    TPH_POISSON_ASSERT(cells != NULL);
+    TPH_POISSON_MEMSET(
+      (uint8_t *)cells + kk * ctx->grid_cell_size, empty, (size_t)ctx->grid_cell_size);
+    if (ctx->grid_occupancy != NULL) {
+      ctx->grid_occupancy[k >> 6] &= ~((uint64_t)1 << (k & 63));
+    }
+  }
+}
+
+/**
+ * @brief Returns a pseudo-random number, advancing the state of the pseudo-random number
+ * generator (in context).
+ * @param ctx Context.
+ * @return A pseudo-random number.
+ */
+static TPH_POISSON_FORCE_INLINE uint64_t tph_poisson_rand_u64(tph_poisson_context *ctx)
+{
+  return ctx->prng_x4 != NULL ? tph_poisson_xoshiro256p_x4_next(ctx->prng_x4)
+                              : tph_poisson_xoshiro256p_next(&ctx->prng_state);
+}
+
+/**
+ * @brief Returns a pseudo-random number in [0..1), advancing the state of the pseudo-random number
+ * generator (in context).
+ * @param ctx Context.
+ * @return A number in [0..1).
+ */
+static TPH_POISSON_FORCE_INLINE double tph_poisson_rand_double(tph_poisson_context *ctx)
+{
+  return tph_poisson_to_double(tph_poisson_rand_u64(ctx));
+}
+
+/**
+ * @brief Returns a pseudo-random number in [0..1) in tph_poisson_real precision, advancing the
+ * state of the pseudo-random number generator (in context). Only used with the multi-stream
+ * generator, see TPH_POISSON_PRNG_XOSHIRO256P_X4.
+ * @param ctx Context.
+ * @return A number in [0..1).
+ */
+static TPH_POISSON_FORCE_INLINE tph_poisson_real tph_poisson_rand_real(tph_poisson_context *ctx)
+{
+  const uint64_t x = tph_poisson_rand_u64(ctx);
+  return TPH_POISSON_REAL_IS_FLOAT ? (tph_poisson_real)tph_poisson_to_float(x)
+                                   : (tph_poisson_real)tph_poisson_to_double(x);
+}
+
+/**
+ * @brief Generate a pseudo-random offset with magnitude in (1, R] by rejection sampling, where R is
+ * the outer radius of the annulus: offsets are drawn in the cube [-R, R]^ndims until one falls
+ * inside the annulus.
+ * @param ctx    Context.
+ * @param offset Output offset.
+ * @param ndims  Number of dimensions, same as ctx->ndims.
+ */
+static TPH_POISSON_FORCE_INLINE void
+  tph_poisson_rand_annulus_offset_rejection(tph_poisson_context *ctx,
+    tph_poisson_real *offset,
+    const int32_t ndims)
+{
+  const double outer = ctx->annulus_outer;
+  const tph_poisson_real outer_real = (tph_poisson_real)outer;
+  const tph_poisson_real outer_sqr = (tph_poisson_real)(outer * outer);
+  const bool prng_x4 = ctx->prng_x4 != NULL;
+  int32_t i = 0;
+  tph_poisson_real sqr_mag = 0;
+  for (;;) {
+    /* Generate a random component in the range [-R, R] for each dimension. */
+    sqr_mag = 0;
+    for (i = 0; i < ndims; ++i) {
+      offset[i] = prng_x4 ? outer_real * (2 * tph_poisson_rand_real(ctx) - 1)
+                          : (tph_poisson_real)(-outer + 2 * outer * tph_poisson_rand_double(ctx));
+      sqr_mag += offset[i] * offset[i];
+    }
+
+    /* The randomized offset is not guaranteed to be within the radial
+     * distance that we need to guarantee. If we found an offset with
+     * magnitude in the range (1, R] we are done, otherwise generate a new
+     * offset. Continue until a valid offset is found. */
+    if (((int)((tph_poisson_real)1 < sqr_mag) & (int)(sqr_mag <= outer_sqr)) == 1) {
+      return;
+    }
+  }
+}
+
+/**
+ * @brief Generate a pseudo-random offset with magnitude in [1, R], uniformly distributed in the
+ * annulus, using polar (2D) or spherical (3D) coordinates.
+ * @param ctx    Context.
+ * @param offset Output offset.
+ * @param ndims  Number of dimensions, 2 or 3, same as ctx->ndims.
+ */
+static TPH_POISSON_FORCE_INLINE void tph_poisson_rand_annulus_offset_polar(tph_poisson_context *ctx,
+  tph_poisson_real *offset,
+  const int32_t ndims)
+{
+  TPH_POISSON_ASSERT(ndims == 2 || ndims == 3);
+  const double outer = ctx->annulus_outer;
+  const double phi = TPH_POISSON_TWO_PI * tph_poisson_rand_double(ctx);
+  if (ndims == 2) {
+    /* The area inside radius r is proportional to r^2, invert the CDF (r^2 - 1) / (R^2 - 1). */
+    const double r = TPH_POISSON_DSQRT(1 + (outer * outer - 1) * tph_poisson_rand_double(ctx));
+    offset[0] = (tph_poisson_real)(r * TPH_POISSON_DCOS(phi));
+    offset[1] = (tph_poisson_real)(r * TPH_POISSON_DSIN(phi));
+  } else {
+    /* Uniform z in [-1, 1] gives a uniform direction on the sphere (Archimedes). The volume inside
+     * radius r is proportional to r^3, invert the CDF (r^3 - 1) / (R^3 - 1). */
+    const double z = 1 - 2 * tph_poisson_rand_double(ctx);
+    const double r =
+      TPH_POISSON_DPOW(1 + (outer * outer * outer - 1) * tph_poisson_rand_double(ctx), 1.0 / 3.0);
+    const double s = r * TPH_POISSON_DSQRT(1 - z * z);
+    offset[0] = (tph_poisson_real)(s * TPH_POISSON_DCOS(phi));
+    offset[1] = (tph_poisson_real)(s * TPH_POISSON_DSIN(phi));
+    offset[2] = (tph_poisson_real)(r * z);
+  }
+}
+
+/**
+ * @brief Generate a pseudo-random offset with magnitude in [1, R], uniformly distributed in the
+ * annulus. The direction is a normalized vector of Gaussian components (Box-Muller) and the
+ * magnitude is found by inverting the CDF (r^ndims - 1) / (R^ndims - 1).
+ * @param ctx    Context.
+ * @param offset Output offset.
+ * @param ndims  Number of dimensions, same as ctx->ndims.
+ */
+static TPH_POISSON_FORCE_INLINE void
+  tph_poisson_rand_annulus_offset_gaussian(tph_poisson_context *ctx,
+    tph_poisson_real *offset,
+    const int32_t ndims)
+{
+  int32_t i = 0;
+  double g = 0;
+  double phi = 0;
+  double sqr_mag = 0;
+  do {
+    /* Gaussian components are computed in pairs. Use 1 - u, in (0, 1], to avoid log(0). */
+    sqr_mag = 0;
+    for (i = 0; i < ndims; i += 2) {
+      g = TPH_POISSON_DSQRT(-2 * TPH_POISSON_DLOG(1 - tph_poisson_rand_double(ctx)));
+      phi = TPH_POISSON_TWO_PI * tph_poisson_rand_double(ctx);
+      offset[i] = (tph_poisson_real)(g * TPH_POISSON_DCOS(phi));
+      sqr_mag += (double)offset[i] * (double)offset[i];
+      if (i + 1 < ndims) {
+        offset[i + 1] = (tph_poisson_real)(g * TPH_POISSON_DSIN(phi));
+        sqr_mag += (double)offset[i + 1] * (double)offset[i + 1];
+      }
+    }
+    /* A zero vector has no direction, but is astronomically unlikely. */
+  } while (!(sqr_mag > 0));
+
+  /* Written as R * (u + (1 - u) * R^-ndims)^(1 / ndims) to avoid overflow for large ndims. */
+  const double outer = ctx->annulus_outer;
+  const double u = tph_poisson_rand_double(ctx);
+  const double r = outer
+                   * TPH_POISSON_DPOW(
+                     u + (1 - u) * TPH_POISSON_DPOW(outer, -(double)ndims), 1 / (double)ndims);
+  const double scale = r / TPH_POISSON_DSQRT(sqr_mag);
+  for (i = 0; i < ndims; ++i) { offset[i] = (tph_poisson_real)(scale * (double)offset[i]); }
+}
+
+/**
+ * @brief Generate an offset with magnitude R on the unit circle scaled by R, where R is the outer
+ * radius of the annulus. Attempts around an active sample are equally spaced in angle, starting
+ * at a pseudo-random angle that is drawn on the first attempt.
+ * @param ctx     Context.
+ * @param attempt Attempt index for the current active sample.
+ * @param offset  Output offset.
+ */
+static TPH_POISSON_FORCE_INLINE void tph_poisson_angular_offset(tph_poisson_context *ctx,
+  const uint32_t attempt,
+  tph_poisson_real *offset)
+{
+  if (attempt == 0) { ctx->angular_start = TPH_POISSON_TWO_PI * tph_poisson_rand_double(ctx); }
+  const double phi =
+    ctx->angular_start + (TPH_POISSON_TWO_PI * attempt) / (double)ctx->max_sample_attempts;
+  offset[0] = (tph_poisson_real)(ctx->annulus_outer * TPH_POISSON_DCOS(phi));
+  offset[1] = (tph_poisson_real)(ctx->annulus_outer * TPH_POISSON_DSIN(phi));
+}
+
+/**
+ * @brief Generate a pseudo-random sample position that is guaranteed be at a distance
+ * [radius, annulus_outer * radius] from the provided center position.
+ * @param ctx     Context.
+ * @param center  Center position.
+ * @param attempt Attempt index for the current active sample.
+ * @param sample  Output sample position.
+ * @param ndims   Number of dimensions, same as ctx->ndims.
+ */
+static TPH_POISSON_FORCE_INLINE void tph_poisson_rand_annulus_sample(tph_poisson_context *ctx,
+  const tph_poisson_real *center,
+  const uint32_t attempt,
+  tph_poisson_real *sample,
+  const int32_t ndims)
+{
+  /* Use sample storage to temporarily store the offset. */
+  switch (ctx->candidate_method) {
+  case TPH_POISSON_CANDIDATES_POLAR:
+    tph_poisson_rand_annulus_offset_polar(ctx, sample, ndims);
+    break;
+  case TPH_POISSON_CANDIDATES_GAUSSIAN:
+    tph_poisson_rand_annulus_offset_gaussian(ctx, sample, ndims);
+    break;
+  case TPH_POISSON_CANDIDATES_ANGULAR:
+    TPH_POISSON_ASSERT(ndims == 2);
+    tph_poisson_angular_offset(ctx, attempt, sample);
+    break;
+  default:
+    TPH_POISSON_ASSERT(ctx->candidate_method == TPH_POISSON_CANDIDATES_REJECTION);
+    tph_poisson_rand_annulus_offset_rejection(ctx, sample, ndims);
+    break;
+  }
+
+  /* Add the offset scaled by radius to the center coordinate to produce the final sample. */
+  for (int32_t i = 0; i < ndims; ++i) { sample[i] = center[i] + ctx->radius * sample[i]; }
+}
+
+/**
+ * @brief Computes the grid index range in which the provided sample position needs to check for
+ * other samples that are possible closer than the radius (given in context).
+ * @param ctx            Context.
+ * @param sample         Input sample position.
+ * @param min_grid_index Minimum grid index.
+ * @param max_grid_index Maximum grid index.
+ * @param ndims          Number of dimensions, same as ctx->ndims.
+ */
+static TPH_POISSON_FORCE_INLINE void tph_poisson_grid_index_bounds(tph_poisson_context *ctx,
+  const tph_poisson_real *sample,
+  ptrdiff_t *min_grid_index,
+  ptrdiff_t *max_grid_index,
+  const int32_t ndims)
+{
+#ifdef TPH_POISSON_GRID_CLAMP
+#error "TPH_POISSON_GRID_CLAMP already defined!"
+#endif
+  /* clang-format off */
+#define TPH_POISSON_GRID_CLAMP(grid_index, grid_size) \
+  if ((grid_index) < 0) {                             \
+    (grid_index) = 0;                                 \
+  } else if ((grid_index) >= (grid_size)) {           \
+    (grid_index) = (grid_size) - 1;                   \
+  }
+  /* clang-format on */
+
+  tph_poisson_real si = 0;
+  for (int32_t i = 0; i < ndims; ++i) {
+    TPH_POISSON_ASSERT(ctx->grid_size[i] > 0);
+    si = sample[i] - ctx->bounds_min[i];
+    min_grid_index[i] = (ptrdiff_t)TPH_POISSON_FLOOR((si - ctx->radius) * ctx->grid_dx_rcp);
+    max_grid_index[i] = (ptrdiff_t)TPH_POISSON_FLOOR((si + ctx->radius) * ctx->grid_dx_rcp);
+    TPH_POISSON_GRID_CLAMP(min_grid_index[i], ctx->grid_size[i]);
+    TPH_POISSON_GRID_CLAMP(max_grid_index[i], ctx->grid_size[i]);
+  }
+#undef TPH_POISSON_GRID_CLAMP
+}
+
+/**
+ * @brief Returns the sample stored in the grid cell with linear index k, or NULL if the cell is
+ * known to be empty or holds the active sample. Empty cells of sparse grids storing points may be
+ * returned, those have NaN coordinates.
+ * @param ctx         Context.
+ * @param samples     Samples.
+ * @param active_cell Linear grid index of the existing sample that 'spawned' the sample tested
+ *                    here, which is ignored. May be -1, in which case no sample is ignored.
+ * @param k           Linear grid index.
+ * @param ndims       Number of dimensions, same as ctx->ndims.
+ * @return Cell sample, or NULL.
+ */
+static TPH_POISSON_FORCE_INLINE const tph_poisson_real *tph_poisson_cell_sample(
+  const tph_poisson_context *ctx,
+  const tph_poisson_vec *samples,
+  const ptrdiff_t active_cell,
+  const ptrdiff_t k,
+  const int32_t ndims)
+{
+  if (k == active_cell) { return NULL; }
+  /* Most probed cells are empty. The occupancy bitmap is much smaller than the grid cells, and
+   * thus more likely to be cached, so check it before loading the cell. */
+#ifdef TPH_POISSON_ATOMIC_LOAD_U64
+  if (ctx->grid_occupancy != NULL
+      && ((TPH_POISSON_ATOMIC_LOAD_U64(&ctx->grid_occupancy[k >> 6]) >> (k & 63)) & 1) == 0) {
+#else
+  if (ctx->grid_occupancy != NULL
+      && ((ctx->grid_occupancy[k >> 6] >> (k & 63)) & 1) == 0) {
+#endif
+    return NULL;
+  }
+  ptrdiff_t kk = k;
+  const void *cells = tph_poisson_grid_cells(ctx, &kk);
+  if (cells == NULL) { return NULL; }
+  if (ctx->grid_storage == TPH_POISSON_GRID_POINTS) {
+    /* Empty cells have NaN coordinates, distance comparisons are false for those. */
+    return (const tph_poisson_real *)cells + kk * ndims;
+  }
+  const ptrdiff_t cell = tph_poisson_index_load(cells, kk, ctx->grid_cell_size);
+  if (cell == 0) { return NULL; }
+  return (const tph_poisson_real *)samples->begin + (cell - 1) * ndims;
+}
+
+/**
+ * @brief Returns true if the sample stored in the grid cell with linear index k is closer than the
+ * radius to the provided sample; otherwise false. Empty cells and the cell holding the active
+ * sample are ignored.
+ * @param ctx         Context.
+ * @param samples     Samples.
+ * @param sample      Input sample position.
+ * @param active_cell Linear grid index of the existing sample that 'spawned' the sample tested
+ *                    here, which is ignored. May be -1, in which case no sample is ignored.
+ * @param k           Linear grid index.
+ * @param ndims       Number of dimensions, same as ctx->ndims.
+ */
+static TPH_POISSON_FORCE_INLINE bool tph_poisson_cell_sample_within_radius(
+  const tph_poisson_context *ctx,
+  const tph_poisson_vec *samples,
+  const tph_poisson_real *sample,
+  const ptrdiff_t active_cell,
+  const ptrdiff_t k,
+  const int32_t ndims)
+{
+  const tph_poisson_real *cell_sample =
+    tph_poisson_cell_sample(ctx, samples, active_cell, k, ndims);
+  if (cell_sample == NULL) { return false; }
+
+  /* Compute (squared) distance to the existing sample and then check if the existing sample is
+   * closer than (squared) radius to the provided sample. */
+  tph_poisson_real di = sample[0] - cell_sample[0];
+  tph_poisson_real d_sqr = di * di;
+  for (int32_t i = 1; i < ndims; ++i) {
+    di = sample[i] - cell_sample[i];
+    d_sqr += di * di;
+  }
+  return d_sqr < ctx->radius * ctx->radius;
+}
+
+/* Samples gathered from neighbor cells, stored per axis. Coordinate i of sample j is
+ * coords[i * TPH_POISSON_SIMD_LANES + j]. */
+typedef struct tph_poisson_batch_
+{
+  tph_poisson_real coords[TPH_POISSON_KERNEL_MAX_NDIMS * TPH_POISSON_SIMD_MAX_LANES];
+  ptrdiff_t size; /** Number of gathered samples. */
+  ptrdiff_t scalar; /** Number of samples left to test one by one before gathering starts. */
+} tph_poisson_batch;
+
+/**
+ * @brief Returns true if any of the TPH_POISSON_SIMD_LANES samples in the (full) batch is closer
+ * than the radius to the provided sample; otherwise false. Squared distances are computed with the
+ * same operations, in the same order, as in tph_poisson_cell_sample_within_radius. Results are
+ * therefore the same, unless the compiler contracts the scalar version into fused multiply-adds.
+ * @param batch  Batch of samples.
+ * @param sample Input sample position.
+ * @param r_sqr  Squared radius.
+ * @param ndims  Number of dimensions, at most TPH_POISSON_KERNEL_MAX_NDIMS.
+ */
+static TPH_POISSON_FORCE_INLINE bool tph_poisson_batch_within_radius(const tph_poisson_batch *batch,
+  const tph_poisson_real *sample,
+  const tph_poisson_real r_sqr,
+  const int32_t ndims)
+{
+  const tph_poisson_real *c = batch->coords;
+  const ptrdiff_t lanes = TPH_POISSON_SIMD_LANES;
+  int32_t i = 0;
+#if defined(TPH_POISSON_SIMD_AVX)
+  if (TPH_POISSON_REAL_IS_FLOAT) {
+    __m256 di = _mm256_sub_ps(_mm256_set1_ps((float)sample[0]), _mm256_loadu_ps((const float *)c));
+    __m256 d_sqr = _mm256_mul_ps(di, di);
+    for (i = 1; i < ndims; ++i) {
+      di = _mm256_sub_ps(
+        _mm256_set1_ps((float)sample[i]), _mm256_loadu_ps((const float *)(c + i * lanes)));
+      d_sqr = _mm256_add_ps(d_sqr, _mm256_mul_ps(di, di));
+    }
+    return _mm256_movemask_ps(_mm256_cmp_ps(d_sqr, _mm256_set1_ps((float)r_sqr), _CMP_LT_OQ))
+           != 0;
+  }
+  if (TPH_POISSON_REAL_IS_DOUBLE) {
+    __m256d di =
+      _mm256_sub_pd(_mm256_set1_pd((double)sample[0]), _mm256_loadu_pd((const double *)c));
+    __m256d d_sqr = _mm256_mul_pd(di, di);
+    for (i = 1; i < ndims; ++i) {
+      di = _mm256_sub_pd(
+        _mm256_set1_pd((double)sample[i]), _mm256_loadu_pd((const double *)(c + i * lanes)));
+      d_sqr = _mm256_add_pd(d_sqr, _mm256_mul_pd(di, di));
+    }
+    return _mm256_movemask_pd(_mm256_cmp_pd(d_sqr, _mm256_set1_pd((double)r_sqr), _CMP_LT_OQ))
+           != 0;
+  }
+#elif defined(TPH_POISSON_SIMD_SSE2)
+  if (TPH_POISSON_REAL_IS_FLOAT) {
+    __m128 di = _mm_sub_ps(_mm_set1_ps((float)sample[0]), _mm_loadu_ps((const float *)c));
+    __m128 d_sqr = _mm_mul_ps(di, di);
+    for (i = 1; i < ndims; ++i) {
+      di = _mm_sub_ps(_mm_set1_ps((float)sample[i]), _mm_loadu_ps((const float *)(c + i * lanes)));
+      d_sqr = _mm_add_ps(d_sqr, _mm_mul_ps(di, di));
+    }
+    return _mm_movemask_ps(_mm_cmplt_ps(d_sqr, _mm_set1_ps((float)r_sqr))) != 0;
+  }
+  if (TPH_POISSON_REAL_IS_DOUBLE) {
+    __m128d di = _mm_sub_pd(_mm_set1_pd((double)sample[0]), _mm_loadu_pd((const double *)c));
+    __m128d d_sqr = _mm_mul_pd(di, di);
+    for (i = 1; i < ndims; ++i) {
+      di =
+        _mm_sub_pd(_mm_set1_pd((double)sample[i]), _mm_loadu_pd((const double *)(c + i * lanes)));
+      d_sqr = _mm_add_pd(d_sqr, _mm_mul_pd(di, di));
+    }
+    return _mm_movemask_pd(_mm_cmplt_pd(d_sqr, _mm_set1_pd((double)r_sqr))) != 0;
+  }
+#elif defined(TPH_POISSON_SIMD_NEON)
+  if (TPH_POISSON_REAL_IS_FLOAT) {
+    float32x4_t di = vsubq_f32(vdupq_n_f32((float)sample[0]), vld1q_f32((const float *)c));
+    float32x4_t d_sqr = vmulq_f32(di, di);
+    for (i = 1; i < ndims; ++i) {
+      di = vsubq_f32(vdupq_n_f32((float)sample[i]), vld1q_f32((const float *)(c + i * lanes)));
+      d_sqr = vaddq_f32(d_sqr, vmulq_f32(di, di));
+    }
+    return vmaxvq_u32(vcltq_f32(d_sqr, vdupq_n_f32((float)r_sqr))) != 0;
+  }
+  if (TPH_POISSON_REAL_IS_DOUBLE) {
+    float64x2_t di = vsubq_f64(vdupq_n_f64((double)sample[0]), vld1q_f64((const double *)c));
+    float64x2_t d_sqr = vmulq_f64(di, di);
+    for (i = 1; i < ndims; ++i) {
+      di = vsubq_f64(vdupq_n_f64((double)sample[i]), vld1q_f64((const double *)(c + i * lanes)));
+      d_sqr = vaddq_f64(d_sqr, vmulq_f64(di, di));
+    }
+    return vmaxvq_u32(vreinterpretq_u32_u64(vcltq_f64(d_sqr, vdupq_n_f64((double)r_sqr)))) != 0;
+  }
+#endif
+  /* Scalar version, for any number of lanes. */
+  bool within = false;
+  tph_poisson_real di = 0;
+  tph_poisson_real d_sqr = 0;
+  for (ptrdiff_t j = 0; j < lanes; ++j) {
+    di = sample[0] - c[j];
+    d_sqr = di * di;
+    for (i = 1; i < ndims; ++i) {
+      di = sample[i] - c[i * lanes + j];
+      d_sqr += di * di;
+    }
+    within |= (d_sqr < r_sqr);
+  }
+  return within;
+}
+
+/**
+ * @brief Adds the sample in the grid cell with linear index k (if any, see tph_poisson_cell_sample)
+ * to the batch. Distances are computed once the batch is full.
+ *
+ * Most candidates are rejected because of one of the first few samples found in the
+ * (nearest-first) stencil. Waiting for a full batch before testing those would waste the early
+ * exit, so the first samples are tested one by one.
+ * @param ctx         Context.
+ * @param batch       Batch of samples.
+ * @param samples     Samples.
+ * @param sample      Input sample position.
+ * @param active_cell Linear grid index of the active sample, or -1.
+ * @param k           Linear grid index.
+ * @param ndims       Number of dimensions, at most TPH_POISSON_KERNEL_MAX_NDIMS.
+ * @return True if a full batch had a sample closer than the radius to the provided sample.
+ */
+static TPH_POISSON_FORCE_INLINE bool tph_poisson_batch_push(const tph_poisson_context *ctx,
+  tph_poisson_batch *batch,
+  const tph_poisson_vec *samples,
+  const tph_poisson_real *sample,
+  const ptrdiff_t active_cell,
+  const ptrdiff_t k,
+  const int32_t ndims)
+{
+  const tph_poisson_real *cell_sample =
+    tph_poisson_cell_sample(ctx, samples, active_cell, k, ndims);
+  if (cell_sample == NULL) { return false; }
+  if (batch->scalar > 0) {
+    --batch->scalar;
+    tph_poisson_real di = sample[0] - cell_sample[0];
+    tph_poisson_real d_sqr = di * di;
+    for (int32_t i = 1; i < ndims; ++i) {
+      di = sample[i] - cell_sample[i];
+      d_sqr += di * di;
+    }
+    return d_sqr < ctx->radius * ctx->radius;
+  }
+  const ptrdiff_t lanes = TPH_POISSON_SIMD_LANES;
+  for (int32_t i = 0; i < ndims; ++i) { batch->coords[i * lanes + batch->size] = cell_sample[i]; }
+  if (++batch->size < lanes) { return false; }
+  batch->size = 0;
+  return tph_poisson_batch_within_radius(batch, sample, ctx->radius * ctx->radius, ndims);
+}
+
+/**
+ * @brief Returns true if any sample remaining in a partially filled batch is closer than the
+ * radius to the provided sample; otherwise false. Unused lanes are filled with copies of the first
+ * sample, which does not change the result.
+ * @param ctx    Context.
+ * @param batch  Batch of samples.
+ * @param sample Input sample position.
+ * @param ndims  Number of dimensions, at most TPH_POISSON_KERNEL_MAX_NDIMS.
+ */
+static TPH_POISSON_FORCE_INLINE bool tph_poisson_batch_flush(const tph_poisson_context *ctx,
+  tph_poisson_batch *batch,
+  const tph_poisson_real *sample,
+  const int32_t ndims)
+{
+  if (batch->size == 0) { return false; }
+  const ptrdiff_t lanes = TPH_POISSON_SIMD_LANES;
+  for (int32_t i = 0; i < ndims; ++i) {
+    for (ptrdiff_t j = batch->size; j < lanes; ++j) {
+      batch->coords[i * lanes + j] = batch->coords[i * lanes];
+    }
+  }
+  batch->size = 0;
+  return tph_poisson_batch_within_radius(batch, sample, ctx->radius * ctx->radius, ndims);
+}
+
+/**
+ * @brief Returns true if there exists another sample within the radius used to
+ * construct the grid; otherwise false.
+ * @param ctx                 Context.
+ * @param samples             Samples.
+ * @param sample              Input sample position.
+ * @param active_cell         Linear grid index of the existing sample that 'spawned' the sample
+ *                            tested here, which is ignored. May be -1, in which case no sample is
+ *                            ignored.
+ * @param min_grid_index      Minimum grid index.
+ * @param max_grid_index      Maximum grid index.
+ * @param ndims               Number of dimensions, same as ctx->ndims.
+ */
+static TPH_POISSON_FORCE_INLINE bool tph_poisson_existing_sample_within_radius(
+  tph_poisson_context *ctx,
+  const tph_poisson_vec *samples,
+  const tph_poisson_real *sample,
+  const ptrdiff_t active_cell,
+  const ptrdiff_t *min_grid_index,
+  const ptrdiff_t *max_grid_index,
+  const int32_t ndims)
+{
+  TPH_POISSON_ASSERT(ndims == ctx->ndims);
+  int32_t i = -1;
+  ptrdiff_t k = -1;
+
+  if (ctx->stencil_size > 0) {
+    /* Find the cell containing the sample and express the grid index range as a box of allowed
+     * offsets relative to that cell. Offsets outside the range are either too far away from
+     * the sample or outside the grid. Stencil cells outside the box are skipped using their
+     * masks, all other stencil cells are found with a single add. */
+    const ptrdiff_t reach = ctx->stencil_reach;
+    const ptrdiff_t width = 2 * reach + 1;
+    const bool tiled = ctx->grid_axis != NULL;
+    const ptrdiff_t *axis = NULL;
+    /* Tiled grid order only, linear index contributions indexed by mask bit. */
+    ptrdiff_t rows[64];
+    uint64_t allowed = 0;
+    ptrdiff_t ci = 0;
+    ptrdiff_t lo = 0;
+    ptrdiff_t hi = 0;
+    ptrdiff_t o = 0;
+    k = 0;
+    for (i = 0; i < ndims; ++i) {
+      TPH_POISSON_ASSERT(min_grid_index[i] <= max_grid_index[i]);
+      ci = (ptrdiff_t)TPH_POISSON_FLOOR((sample[i] - ctx->bounds_min[i]) * ctx->grid_dx_rcp);
+      ci = ci < min_grid_index[i] ? min_grid_index[i]
+                                  : (max_grid_index[i] < ci ? max_grid_index[i] : ci);
+      lo = min_grid_index[i] - ci;
+      hi = max_grid_index[i] - ci;
+      lo = lo < -reach ? -reach : lo;
+      hi = reach < hi ? reach : hi;
+      allowed |= (((uint64_t)1 << (hi - lo + 1)) - 1) << (i * width + lo + reach);
+      if (tiled) {
+        axis = ctx->grid_axis + ctx->grid_axis_start[i] + ci;
+        for (o = lo; o <= hi; ++o) { rows[i * width + o + reach] = axis[o]; }
+      } else {
+        /* Not checking for overflow! */
+        k += ci * ctx->grid_stride[i];
+      }
+    }
+
+    /* Samples in stencil cells are gathered into batches, whose distances to the sample are
+     * computed together using SIMD instructions, see tph_poisson_batch_within_radius. */
+    const bool batched = TPH_POISSON_SIMD_LANES > 1 && ndims <= TPH_POISSON_KERNEL_MAX_NDIMS;
+    tph_poisson_batch batch;
+    batch.size = 0;
+    batch.scalar = TPH_POISSON_SIMD_LANES;
+
+    const tph_poisson_stencil_cell *stencil = ctx->stencil;
+    const ptrdiff_t stencil_size = ctx->stencil_size;
+    if (tiled) {
+      /* Sum up the linear index from per-axis contributions. */
+      const uint8_t *steps = ctx->stencil_steps;
+      for (ptrdiff_t j = 0; j < stencil_size; ++j, steps += ndims) {
+        if ((stencil[j].mask & ~allowed) != 0) { continue; }
+        k = rows[steps[0]];
+        for (i = 1; i < ndims; ++i) { k += rows[steps[i]]; }
+        if (batched) {
+          if (tph_poisson_batch_push(ctx, &batch, samples, sample, active_cell, k, ndims)) {
+            return true;
+          }
+        } else if (tph_poisson_cell_sample_within_radius(
+                     ctx, samples, sample, active_cell, k, ndims)) {
+          return true;
+        }
+      }
+      return batched && tph_poisson_batch_flush(ctx, &batch, sample, ndims);
+    }
+    for (ptrdiff_t j = 0; j < stencil_size; ++j) {
+      if ((stencil[j].mask & ~allowed) != 0) { continue; }
+      if (batched) {
+        if (tph_poisson_batch_push(
+              ctx, &batch, samples, sample, active_cell, k + stencil[j].offset, ndims)) {
+          return true;
+        }
+      } else if (tph_poisson_cell_sample_within_radius(
+                   ctx, samples, sample, active_cell, k + stencil[j].offset, ndims)) {
+        return true;
+      }
+    }
+    return batched && tph_poisson_batch_flush(ctx, &batch, sample, ndims);
+  }
+
+  TPH_POISSON_MEMCPY(
+    ctx->grid_index, min_grid_index, (size_t)(ndims * (ptrdiff_t)sizeof(ptrdiff_t)));
+  do {
+    /* Compute linear grid index. */
+    k = 0;
+    for (i = 0; i < ndims; ++i) { k += tph_poisson_grid_axis_index(ctx, i, ctx->grid_index[i]); }
+
+    if (tph_poisson_cell_sample_within_radius(ctx, samples, sample, active_cell, k, ndims)) {
+      return true;
+    }
+
+    /* Iterate over grid index range. Enumerate every grid index between min_grid_index and
+     * max_grid_index (inclusive) exactly once. Assumes that min_index is element-wise less than or
+     * equal to max_index. */
+    for (i = 0; i < ndims; ++i) {
+      TPH_POISSON_ASSERT(min_grid_index[i] <= max_grid_index[i]);
+      ctx->grid_index[i]++;
+      if (ctx->grid_index[i] <= max_grid_index[i]) { break; }
+      ctx->grid_index[i] = min_grid_index[i];
+    }
+    /* If the above loop ran to completion, without triggering the break, the grid_index has been
+     * set to its original value (min_grid_index). Since this was the starting value for grid_index
+     * we exit the outer loop when this happens. */
+  } while (i != ndims);
+
+  /* No existing sample was found to be closer to the provided sample than the radius. */
+  return false;
+}
+
+/**
+ * @brief Generate a random sample within the given bounds (in context).
+ * @param ctx    Context.
+ * @param sample Output sample.
+ */
+static void tph_poisson_rand_sample(tph_poisson_context *ctx, tph_poisson_real *sample)
+{
+  int32_t i = 0;
+  for (; i < ctx->ndims; ++i) {
+    TPH_POISSON_ASSERT(ctx->bounds_max[i] > ctx->bounds_min[i]);
+    sample[i] =
+      ctx->bounds_min[i]
+      + (tph_poisson_real)(tph_poisson_rand_double(ctx))
+          * (ctx->bounds_max[i] - ctx->bounds_min[i]);
+    /* Clamp to avoid numerical issues. */
+    /* clang-format off */
+    sample[i] = sample[i] < ctx->bounds_min[i] ? ctx->bounds_min[i] 
+      : (ctx->bounds_max[i] < sample[i] ? ctx->bounds_max[i] : sample[i]);
+    /* clang-format on */
+  }
+}
+
+/**
+ * @brief Makes up to max_sample_attempts attempts to spawn a new sample around an active sample,
+ * generating candidates in batches of candidate_batch_size. Candidates in a batch are generated,
+ * and then checked against the bounds, in tight loops over the batch. Candidates are then tested
+ * against existing samples in order and the first valid candidate is added. The pseudo-random
+ * number generator state after each candidate is stored and restored for the added candidate, so
+ * the results are the same as when generating candidates one at a time.
+ * @param ctx           Context.
+ * @param internal      Internal data.
+ * @param active_sample Position of the active sample.
+ * @param active_cell   Linear grid index of the active sample, or -1, see
+ *                      tph_poisson_existing_sample_within_radius.
+ * @param min_grid_index Scratch storage for minimum grid index.
+ * @param max_grid_index Scratch storage for maximum grid index.
+ * @param ndims         Number of dimensions, same as ctx->ndims.
+ * @param attempt_count Set to the attempt index of the added candidate, or max_sample_attempts
+ *                      if no candidate was added.
+ * @return TPH_POISSON_SUCCESS, or a non-zero error code.
+ */
+static TPH_POISSON_FORCE_INLINE int tph_poisson_spawn_batched(tph_poisson_context *ctx,
+  tph_poisson_sampling_internal *internal,
+  const tph_poisson_real *active_sample,
+  const ptrdiff_t active_cell,
+  ptrdiff_t *min_grid_index,
+  ptrdiff_t *max_grid_index,
+  const int32_t ndims,
+  uint32_t *attempt_count)
+{
+  TPH_POISSON_ASSERT(ctx->candidates != NULL);
+  const uint32_t max_attempts = ctx->max_sample_attempts;
+  tph_poisson_real *candidates = ctx->candidates;
+  const tph_poisson_real *candidate = NULL;
+  uint32_t n = 0;
+  uint32_t j = 0;
+  for (uint32_t attempt = 0; attempt < max_attempts; attempt += n) {
+    n = max_attempts - attempt;
+    n = n < ctx->candidate_batch_size ? n : ctx->candidate_batch_size;
+    for (j = 0; j < n; ++j) {
+      tph_poisson_rand_annulus_sample(
+        ctx, active_sample, attempt + j, candidates + (ptrdiff_t)j * ndims, ndims);
+      if (ctx->prng_x4 != NULL) {
+        ctx->candidate_prng_x4_states[j] = *ctx->prng_x4;
+      } else {
+        ctx->candidate_prng_states[j] = ctx->prng_state;
+      }
+    }
+    for (j = 0; j < n; ++j) {
+      ctx->candidate_inside[j] =
+        (uint8_t)tph_poisson_candidate_inside(ctx, candidates + (ptrdiff_t)j * ndims, ndims);
+    }
+    for (j = 0; j < n; ++j) {
+      if (ctx->candidate_inside[j] == 0) { continue; }
+      candidate = candidates + (ptrdiff_t)j * ndims;
+      tph_poisson_grid_index_bounds(ctx, candidate, min_grid_index, max_grid_index, ndims);
+      if (!tph_poisson_existing_sample_within_radius(ctx,
+            &internal->samples,
+            candidate,
+            active_cell,
+            min_grid_index,
+            max_grid_index,
+            ndims)) {
+        /* Rewind to the state the generator would have had after generating this candidate. */
+        if (ctx->prng_x4 != NULL) {
+          *ctx->prng_x4 = ctx->candidate_prng_x4_states[j];
+        } else {
+          ctx->prng_state = ctx->candidate_prng_states[j];
+        }
+        *attempt_count = attempt + j;
+        return tph_poisson_add_sample(ctx, internal, candidate, ndims);
+      }
+    }
+  }
+  *attempt_count = max_attempts;
+  return TPH_POISSON_SUCCESS;
+}
+
+/**
+ * @brief Generates samples until there are no more active samples, or until ctx->attempt_budget
+ * candidates have been tested if it is non-zero. Active samples are only chosen while budget
+ * remains, and then get all their attempts, so the budget may be exceeded by up to
+ * max_sample_attempts - 1. Stopping early leaves the context ready for another run that
+ * continues where this one stopped. Unless there already are active samples, the first sample is
+ * placed randomly within the bounds (given in context). Scratch variables are stored on the stack
+ * for low dimensions, which lets the compiler keep them in registers when ndims is a compile-time
+ * constant (see TPH_POISSON_DEFINE_RUN).
+ * @param ctx      Context.
+ * @param internal Internal data.
+ * @param ndims    Number of dimensions, same as ctx->ndims.
+ * @return TPH_POISSON_SUCCESS, or a non-zero error code.
+ */
+static TPH_POISSON_FORCE_INLINE int tph_poisson_run_impl(tph_poisson_context *ctx,
+  tph_poisson_sampling_internal *internal,
+  const int32_t ndims)
+{
+  TPH_POISSON_ASSERT(ndims == ctx->ndims);
+  tph_poisson_real sample_buf[TPH_POISSON_KERNEL_MAX_NDIMS];
+  ptrdiff_t min_grid_index_buf[TPH_POISSON_KERNEL_MAX_NDIMS];
+  ptrdiff_t max_grid_index_buf[TPH_POISSON_KERNEL_MAX_NDIMS];
+  const bool use_buf = ndims <= TPH_POISSON_KERNEL_MAX_NDIMS;
+  tph_poisson_real *sample = use_buf ? sample_buf : ctx->sample;
+  ptrdiff_t *min_grid_index = use_buf ? min_grid_index_buf : ctx->min_grid_index;
+  ptrdiff_t *max_grid_index = use_buf ? max_grid_index_buf : ctx->max_grid_index;
+
+  /* Add first sample randomly within bounds. No need to check (non-existing) neighbors. The
+   * active samples of a tile are set up before running, see tph_poisson_tile_task. */
+  int ret = TPH_POISSON_SUCCESS;
+  if (tph_poisson_vec_size(&ctx->active_cells) == 0) {
+    tph_poisson_rand_sample(ctx, sample);
+    ret = tph_poisson_add_sample(ctx, internal, sample, ndims);
+    if (ret != TPH_POISSON_SUCCESS) { return ret; }
+  }
+
+  const ptrdiff_t active_cell_size = ctx->active_cell_size;
+  ptrdiff_t active_index_count = tph_poisson_vec_size(&ctx->active_cells) / active_cell_size;
+  ptrdiff_t rand_index = -1;
+  ptrdiff_t active_cell = -1;
+  ptrdiff_t k = -1;
+  const void *cells = NULL;
+  const tph_poisson_real *active_sample = NULL;
+
+  /* Rejection sampled candidates are strictly further away than the radius from the active
+   * sample, so there is no need to check the active sample. Other methods may (rarely) place
+   * candidates at exactly the radius, where rounding could then give a violation. */
+  const bool ignore_active_sample = ctx->candidate_method == TPH_POISSON_CANDIDATES_REJECTION;
+  uint32_t attempt_count = 0;
+  ptrdiff_t budget = ctx->attempt_budget > 0 ? ctx->attempt_budget : PTRDIFF_MAX;
+  while (active_index_count > 0 && budget > 0) {
+    /* Randomly choose an active sample. A sample is considered active until failed attempts
+     * have been made to generate a new sample within its annulus. */
+    rand_index =
+      (ptrdiff_t)(tph_poisson_rand_u64(ctx) % (uint64_t)active_index_count);
+    active_cell = tph_poisson_index_load(ctx->active_cells.begin, rand_index, active_cell_size);
+    k = active_cell;
+    cells = tph_poisson_grid_cells(ctx, &k);
+    TPH_POISSON_ASSERT(cells != NULL);
+    active_sample = ctx->grid_storage == TPH_POISSON_GRID_POINTS
+                      ? (const tph_poisson_real *)cells + k * ndims
+                      : (const tph_poisson_real *)internal->samples.begin
+                          + (tph_poisson_index_load(cells, k, ctx->grid_cell_size) - 1) * ndims;
+    attempt_count = 0;
+    if (ctx->candidates != NULL) {
+      ret = tph_poisson_spawn_batched(ctx,
+        internal,
+        active_sample,
+        ignore_active_sample ? active_cell : -1,
+        min_grid_index,
+        max_grid_index,
+        ndims,
+        &attempt_count);
+      if (ret != TPH_POISSON_SUCCESS) { return ret; }
+    } else {
+      while (attempt_count < ctx->max_sample_attempts) {
+        /* Randomly create a candidate sample inside the active sample's annulus. */
+        tph_poisson_rand_annulus_sample(ctx, active_sample, attempt_count, sample, ndims);
+        /* Check if candidate sample is within bounds. */
+        if (tph_poisson_candidate_inside(ctx, sample, ndims)) {
+          tph_poisson_grid_index_bounds(ctx, sample, min_grid_index, max_grid_index, ndims);
+          if (!tph_poisson_existing_sample_within_radius(ctx,
+                &internal->samples,
+                sample,
+                ignore_active_sample ? active_cell : -1,
+                min_grid_index,
+                max_grid_index,
+                ndims)) {
+            /* No existing samples where found to be too close to the
+             * candidate sample, no further attempts necessary. */
+            ret = tph_poisson_add_sample(ctx, internal, sample, ndims);
+            if (ret != TPH_POISSON_SUCCESS) { return ret; }
+            break;
+          }
+          /* else: The candidate sample is too close to an existing sample. */
+        }
+        /* else: The candidate sample is out-of-bounds. */
+        ++attempt_count;
+      }
+    }
+
+    if (attempt_count == ctx->max_sample_attempts) {
+      /* No valid sample was found on the disk of the active sample after
+       * maximum number of attempts, remove it from the active list. */
+      tph_poisson_vec_erase_swap(
+        &ctx->active_cells, rand_index * active_cell_size, active_cell_size);
+      budget -= (ptrdiff_t)attempt_count;
+    } else {
+      /* The accepted candidate was also tested. */
+      budget -= (ptrdiff_t)attempt_count + 1;
+    }
+    active_index_count = tph_poisson_vec_size(&ctx->active_cells) / active_cell_size;
+  }
+  return TPH_POISSON_SUCCESS;
+}
+
+/* Kernels with a compile-time constant number of dimensions, as well as a generic kernel for
+ * any number of dimensions. */
+#ifdef TPH_POISSON_DEFINE_RUN
+#error "TPH_POISSON_DEFINE_RUN already defined!"
+#endif
+/* clang-format off */
+#define TPH_POISSON_DEFINE_RUN(N)                                                   \
+  static int tph_poisson_run_##N(tph_poisson_context *ctx,                          \
+    tph_poisson_sampling_internal *internal)                                       \
+  {                                                                                 \
+    return tph_poisson_run_impl(ctx, internal, INT32_C(N));                         \
+  }
+/* clang-format on */
+TPH_POISSON_DEFINE_RUN(1)
+TPH_POISSON_DEFINE_RUN(2)
+TPH_POISSON_DEFINE_RUN(3)
+TPH_POISSON_DEFINE_RUN(4)
+#undef TPH_POISSON_DEFINE_RUN
+
+static int tph_poisson_run_n(tph_poisson_context *ctx, tph_poisson_sampling_internal *internal)
+{
+  return tph_poisson_run_impl(ctx, internal, ctx->ndims);
+}
+
+/**
+ * @brief Generates samples, using a fixed-dimension kernel if one is available.
+ * @param ctx      Context.
+ * @param internal Internal data.
+ * @return TPH_POISSON_SUCCESS, or a non-zero error code.
+ */
+static int tph_poisson_run(tph_poisson_context *ctx, tph_poisson_sampling_internal *internal)
+{
+  switch (ctx->ndims) {
+  case 1:
+    return tph_poisson_run_1(ctx, internal);
+  case 2:
+    return tph_poisson_run_2(ctx, internal);
+  case 3:
+    return tph_poisson_run_3(ctx, internal);
+  case 4:
+    return tph_poisson_run_4(ctx, internal);
+  default:
+    return tph_poisson_run_n(ctx, internal);
+  }
+}
+
+/**
+ * @brief Reserves memory for the estimated number of samples (see tph_poisson_estimate_samples)
+ * and some slack, so that estimates that are slightly too low do not cause a reallocation.
+ * Sparse grids may be arbitrarily large, at most one page worth of samples is reserved. If there
+ * are more samples than reserved the buffer grows geometrically.
+ * @param internal Internal data.
+ * @param ctx      Context, initialized with args.
+ * @param args     Arguments.
+ * @return TPH_POISSON_SUCCESS, or a non-zero error code.
+ */
+static int tph_poisson_samples_reserve(tph_poisson_sampling_internal *internal,
+  const tph_poisson_context *ctx,
+  const tph_poisson_args *args)
+{
+  ptrdiff_t n = 1;
+  const int ret = tph_poisson_estimate_samples(args, &n);
+  /* Arguments have been checked by tph_poisson_context_init, which rejects larger grids. */
+  TPH_POISSON_ASSERT(ret == TPH_POISSON_SUCCESS);
+  (void)ret;
+  n += n / 8;
+  if (ctx->grid_pages != NULL && n > (ptrdiff_t)1 << TPH_POISSON_GRID_PAGE_BITS) {
+    n = (ptrdiff_t)1 << TPH_POISSON_GRID_PAGE_BITS;
+  }
+  const ptrdiff_t sample_size = (ptrdiff_t)sizeof(tph_poisson_real) * ctx->ndims;
+  n = n < PTRDIFF_MAX / (2 * sample_size) ? n : PTRDIFF_MAX / (2 * sample_size);
+  return tph_poisson_vec_reserve(&internal->samples,
+    &internal->alloc,
+    n * sample_size,
+    (ptrdiff_t)alignof(tph_poisson_real),
+    TPH_POISSON_ALLOC_SAMPLES);
+}
+
+/**
+ * @brief Moves the samples to a new buffer in the SoA layout (see TPH_POISSON_LAYOUT_SOA) and frees
+ * the old buffer. Dimension arrays are padded with zeros to a whole number of
+ * TPH_POISSON_SOA_ALIGNMENT bytes, so that each array starts at an aligned address. The new
+ * buffer holds no unused capacity beyond the padding.
+ * @param internal   Internal data, with samples in the AoS layout.
+ * @param ndims      Number of dimensions.
+ * @param soa_stride Number of values between dimension arrays.
+ * @return TPH_POISSON_SUCCESS, or a non-zero error code.
+ */
+static int tph_poisson_samples_to_soa(tph_poisson_sampling_internal *internal,
+  const int32_t ndims,
+  ptrdiff_t *soa_stride)
+{
+  const ptrdiff_t sample_size = (ptrdiff_t)sizeof(tph_poisson_real) * ndims;
+  const ptrdiff_t nsamples = tph_poisson_vec_size(&internal->samples) / sample_size;
+  const ptrdiff_t lanes = TPH_POISSON_SOA_ALIGNMENT / (ptrdiff_t)sizeof(tph_poisson_real);
+  const ptrdiff_t stride = nsamples <= PTRDIFF_MAX - lanes ? (nsamples + lanes - 1) / lanes * lanes
+                                                           : PTRDIFF_MAX;
+  *soa_stride = 0;
+  if (nsamples == 0) {
+    return tph_poisson_vec_shrink_to_fit(&internal->samples,
+      &internal->alloc,
+      (ptrdiff_t)alignof(tph_poisson_real),
+      TPH_POISSON_ALLOC_SAMPLES);
+  }
+  if (stride > PTRDIFF_MAX / 2 / sample_size) { return TPH_POISSON_OVERFLOW; }
+  const ptrdiff_t size = stride * sample_size;
+
+  tph_poisson_vec soa;
+  TPH_POISSON_MEMSET(&soa, 0, sizeof(tph_poisson_vec));
+  const int ret = tph_poisson_vec_reserve(
+    &soa, &internal->alloc, size, TPH_POISSON_SOA_ALIGNMENT, TPH_POISSON_ALLOC_SAMPLES);
+  if (ret != TPH_POISSON_SUCCESS) { return ret; }
+
+  /* Samples are read in order, each one is scattered to ndims arrays. */
+  const tph_poisson_real *src = (const tph_poisson_real *)internal->samples.begin;
+  tph_poisson_real *dst = (tph_poisson_real *)soa.begin;
+  for (int32_t i = 0; i < ndims; ++i) {
+    for (ptrdiff_t j = nsamples; j < stride; ++j) { dst[i * stride + j] = 0; }
+  }
+  for (ptrdiff_t j = 0; j < nsamples; ++j) {
+    for (int32_t i = 0; i < ndims; ++i) { dst[i * stride + j] = src[j * ndims + i]; }
+  }
+  soa.end = (void *)((intptr_t)soa.begin + size);
+
+  tph_poisson_vec_free(&internal->samples, &internal->alloc, TPH_POISSON_ALLOC_SAMPLES);
+  internal->samples = soa;
+  *soa_stride = stride;
+  return TPH_POISSON_SUCCESS;
+}
+
+/*
+ * ARENA
+ */
+
+/* Bump allocator over the memory provided to tph_poisson_create_in_arena, stored at the start of
+ * that memory. Memory is never returned to the arena. Buffers align themselves, so allocations
+ * need no alignment. */
+typedef struct tph_poisson_arena_
+{
+  intptr_t ptr; /** Start of unused memory. */
+  intptr_t end;
+} tph_poisson_arena;
+
+static void *tph_poisson_arena_malloc(ptrdiff_t size, void *ctx)
+{
+  tph_poisson_arena *arena = (tph_poisson_arena *)ctx;
+  if (size > arena->end - arena->ptr) { return NULL; }
+  void *ptr = (void *)arena->ptr;
+  arena->ptr += size;
+  return ptr;
+}
+
+static void tph_poisson_arena_free(void *ptr, ptrdiff_t size, void *ctx)
+{
+  (void)ptr;
+  (void)size;
+  (void)ctx;
+}
+
+/**
+ * @brief Computes the sample cap and the arena size for tph_poisson_create_in_arena. The sizes
+ * must match the allocations made there, including the alignment slack of each buffer.
+ * @param args        Arguments.
+ * @param max_samples Requested sample cap, zero for no cap.
+ * @param cap         Number of samples that the sample buffer holds.
+ * @param nbytes      Arena size in bytes.
+ * @return TPH_POISSON_SUCCESS, or a non-zero error code.
+ */
+static int tph_poisson_arena_plan(const tph_poisson_args *args,
+  const ptrdiff_t max_samples,
+  ptrdiff_t *cap,
+  ptrdiff_t *nbytes)
+{
+  if (max_samples < 0) { return TPH_POISSON_INVALID_ARGS; }
+  ptrdiff_t bound = 0;
+  int ret = tph_poisson_max_samples(args, &bound);
+  if (ret != TPH_POISSON_SUCCESS) { return ret; }
+  *cap = (max_samples > 0 && max_samples < bound) ? max_samples : bound;
+
+  /* Context memory size and grid layout, nothing is allocated. */
+  tph_poisson_context ctx;
+  TPH_POISSON_MEMSET(&ctx, 0, sizeof(tph_poisson_context));
+  ret = tph_poisson_context_init(/*alloc=*/NULL, args, &ctx);
+  if (ret != TPH_POISSON_SUCCESS) { return ret; }
+
+  /* Each sample is in the active list at most once, and lands in at most one new grid page. */
+  const ptrdiff_t sample_size = (ptrdiff_t)sizeof(tph_poisson_real) * ctx.ndims;
+  const ptrdiff_t page_size = tph_poisson_grid_page_alloc_size(&ctx);
+  const ptrdiff_t npages = ctx.grid_page_count < *cap ? ctx.grid_page_count : *cap;
+  if (*cap > PTRDIFF_MAX / 4 / (sample_size + (ptrdiff_t)sizeof(ptrdiff_t))
+      || npages > PTRDIFF_MAX / 4 / page_size) {
+    return TPH_POISSON_OVERFLOW;
+  }
+  /* clang-format off */
+  const ptrdiff_t sizes[] = {
+    (ptrdiff_t)(sizeof(tph_poisson_arena) + alignof(tph_poisson_arena)),
+    /* See tph_poisson_alloc_internal. */
+    (ptrdiff_t)(sizeof(tph_poisson_sampling_internal) + alignof(tph_poisson_sampling_internal)),
+    ctx.mem_size,
+    ctx.grid_mem_size > 0 ? ctx.grid_mem_size + (ptrdiff_t)alignof(uint64_t) : 0,
+    *cap * sample_size + (ptrdiff_t)alignof(tph_poisson_real),
+    (*cap + 1) * ctx.active_cell_size,
+    npages * page_size
+  };
+  /* clang-format on */
+  *nbytes = 0;
+  for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); ++i) {
+    if (sizes[i] > PTRDIFF_MAX - *nbytes) { return TPH_POISSON_OVERFLOW; }
+    *nbytes += sizes[i];
+  }
+  return TPH_POISSON_SUCCESS;
+}
+
+/*
+ * PARALLEL SAMPLING
+ */
+
+/* clang-format off */
+typedef struct tph_poisson_tiling_
+{
+  const tph_poisson_context *ctx; /** Shared context, tiles only write to their own grid cells. */
+  const tph_poisson_allocator *alloc;
+  uint64_t seed;
+  ptrdiff_t tile_cells;    /** Number of grid cells along each axis of a tile. */
+  ptrdiff_t halo_cells;    /** Cells around a tile that may hold samples spawning candidates. */
+  ptrdiff_t *tile_count;   /** Number of tiles along each axis. */
+  ptrdiff_t *phase_count;  /** Number of tiles along each axis in the current phase. */
+  ptrdiff_t *phase_offset; /** Parity of tile coordinates along each axis in the current phase. */
+  tph_poisson_vec *tile_samples; /** Samples of each tile, ElemT = tph_poisson_real. */
+  int *tile_ret;                 /** Result of each tile. */
+} tph_poisson_tiling;
+/* clang-format on */
+
+/**
+ * @brief Samples one tile of the current phase, running the same loop as tph_poisson_create on a
+ * copy of the shared context that only accepts candidates in the tile. The active list is seeded
+ * with the existing samples that are close enough to spawn candidates in the tile, which are in
+ * neighbor tiles sampled in earlier phases. If there are no such samples, the tile is seeded with
+ * a random sample instead. Tile samples and the result are stored in the tiling.
+ * @param task_ctx   Tiling.
+ * @param task_index Index of the tile among the tiles of the current phase.
+ */
+static void tph_poisson_tile_task(void *task_ctx, const ptrdiff_t task_index)
+{
+  const tph_poisson_tiling *tiling = (const tph_poisson_tiling *)task_ctx;
+  const tph_poisson_context *ctx = tiling->ctx;
+  const int32_t ndims = ctx->ndims;
+  TPH_POISSON_ASSERT(ctx->grid_storage == TPH_POISSON_GRID_POINTS);
+  TPH_POISSON_ASSERT(ctx->grid_cells != NULL);
+
+  /* Find the tile from its index in the current phase. */
+  ptrdiff_t tile = 0;
+  ptrdiff_t tile_stride = 1;
+  ptrdiff_t rem = task_index;
+  ptrdiff_t ti = 0;
+  int32_t i = 0;
+  for (i = 0; i < ndims; ++i) {
+    ti = 2 * (rem % tiling->phase_count[i]) + tiling->phase_offset[i];
+    rem /= tiling->phase_count[i];
+    TPH_POISSON_ASSERT(ti < tiling->tile_count[i]);
+    tile += ti * tile_stride;
+    tile_stride *= tiling->tile_count[i];
+  }
+
+  /* Scratch arrays of size ndims, and a multi-stream generator state if needed. */
+  const bool prng_x4 = ctx->prng_x4 != NULL;
+  const ptrdiff_t mem_size =
+    (ptrdiff_t)(ndims * 5) * (ptrdiff_t)sizeof(ptrdiff_t) + (ptrdiff_t)alignof(ptrdiff_t)
+    + (prng_x4 ? (ptrdiff_t)sizeof(tph_poisson_xoshiro256p_x4_state)
+                   + (ptrdiff_t)alignof(tph_poisson_xoshiro256p_x4_state)
+               : 0)
+    + (ptrdiff_t)ndims * (ptrdiff_t)sizeof(tph_poisson_real) + (ptrdiff_t)alignof(tph_poisson_real);
+  void *mem = tph_poisson_mem_alloc(
+    tiling->alloc, mem_size, (ptrdiff_t)alignof(ptrdiff_t), TPH_POISSON_ALLOC_OTHER);
+  if (mem == NULL) {
+    tiling->tile_ret[tile] = TPH_POISSON_BAD_ALLOC;
+    return;
+  }
+
+  tph_poisson_context tile_ctx = *ctx;
+  TPH_POISSON_MEMSET(&tile_ctx.active_cells, 0, sizeof(tph_poisson_vec));
+  ptrdiff_t *ptr = (ptrdiff_t *)tph_poisson_align(mem, alignof(ptrdiff_t));
+  tile_ctx.region_min = ptr;
+  tile_ctx.region_max = ptr + ndims;
+  tile_ctx.grid_index = ptr + 2 * ndims;
+  tile_ctx.min_grid_index = ptr + 3 * ndims;
+  tile_ctx.max_grid_index = ptr + 4 * ndims;
+  void *next = ptr + 5 * ndims;
+  if (prng_x4) {
+    tile_ctx.prng_x4 = (tph_poisson_xoshiro256p_x4_state *)tph_poisson_align(
+      next, alignof(tph_poisson_xoshiro256p_x4_state));
+    next = tile_ctx.prng_x4 + 1;
+  }
+  tile_ctx.sample = (tph_poisson_real *)tph_poisson_align(next, alignof(tph_poisson_real));
+
+  /* Grid index range of the tile. */
+  rem = task_index;
+  for (i = 0; i < ndims; ++i) {
+    ti = 2 * (rem % tiling->phase_count[i]) + tiling->phase_offset[i];
+    rem /= tiling->phase_count[i];
+    tile_ctx.region_min[i] = ti * tiling->tile_cells;
+    tile_ctx.region_max[i] = tile_ctx.region_min[i] + tiling->tile_cells;
+    tile_ctx.region_max[i] =
+      tile_ctx.region_max[i] < ctx->grid_size[i] ? tile_ctx.region_max[i] : ctx->grid_size[i];
+  }
+
+  /* Tile t uses the (t + 1)th value of the SplitMix64 sequence starting at the seed. */
+  tph_poisson_splitmix64_state sm_state = { tiling->seed + (uint64_t)tile * 0x9E3779B97f4A7C15 };
+  const uint64_t tile_seed = tph_poisson_splitmix64(&sm_state);
+  tph_poisson_xoshiro256p_init(&tile_ctx.prng_state, tile_seed);
+  if (prng_x4) { tph_poisson_xoshiro256p_x4_init(tile_ctx.prng_x4, tile_seed); }
+
+  tph_poisson_sampling_internal tile_internal;
+  TPH_POISSON_MEMSET(&tile_internal, 0, sizeof(tph_poisson_sampling_internal));
+  tile_internal.alloc = *tiling->alloc;
+
+  /* Seed the active list with the samples in the halo around the tile. The tile itself has not
+   * been sampled yet, so its cells are empty. Halo cells are in neighbor tiles, which are in
+   * other phases, so they are not written while this task runs. */
+  int ret = TPH_POISSON_SUCCESS;
+  ptrdiff_t *halo_min = tile_ctx.min_grid_index;
+  ptrdiff_t *halo_max = tile_ctx.max_grid_index;
+  for (i = 0; i < ndims; ++i) {
+    halo_min[i] = tile_ctx.region_min[i] - tiling->halo_cells;
+    halo_min[i] = halo_min[i] > 0 ? halo_min[i] : 0;
+    halo_max[i] = tile_ctx.region_max[i] + tiling->halo_cells - 1;
+    halo_max[i] = halo_max[i] < ctx->grid_size[i] - 1 ? halo_max[i] : ctx->grid_size[i] - 1;
+  }
+  TPH_POISSON_MEMCPY(
+    tile_ctx.grid_index, halo_min, (size_t)(ndims * (ptrdiff_t)sizeof(ptrdiff_t)));
+  ptrdiff_t k = 0;
+  const tph_poisson_real *cell_point = NULL;
+  do {
+    k = 0;
+    for (i = 0; i < ndims; ++i) {
+      k += tph_poisson_grid_axis_index(ctx, i, tile_ctx.grid_index[i]);
+    }
+    /* Empty cells have NaN coordinates. */
+    cell_point = (const tph_poisson_real *)ctx->grid_cells + k * ndims;
+    if (cell_point[0] <= cell_point[0]) {
+      ret = tph_poisson_active_push(&tile_ctx, &tile_internal.alloc, k);
+      if (ret != TPH_POISSON_SUCCESS) { break; }
+    }
+    for (i = 0; i < ndims; ++i) {
+      if (++tile_ctx.grid_index[i] <= halo_max[i]) { break; }
+      tile_ctx.grid_index[i] = halo_min[i];
+    }
+  } while (i != ndims);
+
+  if (ret == TPH_POISSON_SUCCESS && tph_poisson_vec_size(&tile_ctx.active_cells) == 0) {
+    /* No samples nearby, place a random sample in the tile. Rounding may (rarely) put a sample
+     * drawn in the tile bounds in a neighbor tile, in which case another one is drawn. */
+    tph_poisson_real *sample = tile_ctx.sample;
+    tph_poisson_real lo = 0;
+    tph_poisson_real hi = 0;
+    for (uint32_t attempt = 0; attempt < ctx->max_sample_attempts; ++attempt) {
+      for (i = 0; i < ndims; ++i) {
+        lo = ctx->bounds_min[i] + (tph_poisson_real)tile_ctx.region_min[i] * ctx->grid_dx;
+        hi = ctx->bounds_min[i] + (tph_poisson_real)tile_ctx.region_max[i] * ctx->grid_dx;
+        hi = hi < ctx->bounds_max[i] ? hi : ctx->bounds_max[i];
+        sample[i] = lo + (tph_poisson_real)tph_poisson_rand_double(&tile_ctx) * (hi - lo);
+      }
+      if (tph_poisson_candidate_inside(&tile_ctx, sample, ndims)) {
+        tph_poisson_grid_index_bounds(
+          &tile_ctx, sample, tile_ctx.min_grid_index, tile_ctx.max_grid_index, ndims);
+        if (!tph_poisson_existing_sample_within_radius(&tile_ctx,
+              &tile_internal.samples,
+              sample,
+              -1,
+              tile_ctx.min_grid_index,
+              tile_ctx.max_grid_index,
+              ndims)) {
+          ret = tph_poisson_add_sample(&tile_ctx, &tile_internal, sample, ndims);
+          break;
+        }
+      }
+    }
+  }
+
+  /* An empty active list would make the loop start from a random sample in the bounds. */
+  if (ret == TPH_POISSON_SUCCESS && tph_poisson_vec_size(&tile_ctx.active_cells) > 0) {
+    ret = tph_poisson_run(&tile_ctx, &tile_internal);
+  }
+
+  tiling->tile_samples[tile] = tile_internal.samples;
+  tiling->tile_ret[tile] = ret;
+  tph_poisson_vec_free(&tile_ctx.active_cells, &tile_internal.alloc, TPH_POISSON_ALLOC_ACTIVE);
+  tph_poisson_mem_free(tiling->alloc, mem, mem_size, TPH_POISSON_ALLOC_OTHER);
+}
+
+/**
+ * @brief Samples all tiles, phase by phase, and stores the samples of all tiles, in tile order,
+ * in the sampling. Assumes that the context has a dense grid storing points.
+ * @param ctx        Context.
+ * @param internal   Internal data.
+ * @param executor   Executor, or NULL.
+ * @param seed       Seed.
+ * @param tile_cells Number of grid cells along each axis of a tile.
+ * @param halo_cells Number of grid cells around a tile that may hold samples spawning
+ *                   candidates in it, not larger than tile_cells.
+ * @return TPH_POISSON_SUCCESS, or a non-zero error code.
+ */
+static int tph_poisson_run_tiles(tph_poisson_context *ctx,
+  tph_poisson_sampling_internal *internal,
+  const tph_poisson_executor *executor,
+  const uint64_t seed,
+  const ptrdiff_t tile_cells,
+  const ptrdiff_t halo_cells)
+{
+  const int32_t ndims = ctx->ndims;
+  TPH_POISSON_ASSERT(0 < halo_cells && halo_cells <= tile_cells);
+
+  /* The number of tiles is not larger than the number of grid cells. Axes with a single tile
+   * don't add phases, and there are less than 62 axes with more than one tile since the grid
+   * linear size is less than 2^62. */
+  ptrdiff_t ntiles = 1;
+  int32_t split_axes = 0;
+  for (int32_t i = 0; i < ndims; ++i) {
+    const ptrdiff_t count = (ctx->grid_size[i] + tile_cells - 1) / tile_cells;
+    ntiles *= count;
+    split_axes += (int32_t)(count > 1);
+  }
+  if (ntiles > (PTRDIFF_MAX / 4) / (ptrdiff_t)(sizeof(tph_poisson_vec) + sizeof(int))) {
+    return TPH_POISSON_OVERFLOW;
+  }
+
+  tph_poisson_tiling tiling;
+  tiling.ctx = ctx;
+  tiling.alloc = &internal->alloc;
+  tiling.seed = seed;
+  tiling.tile_cells = tile_cells;
+  tiling.halo_cells = halo_cells;
+
+  /* clang-format off */
+  const ptrdiff_t mem_size = 
+    /* tile_count, phase_count, phase_offset */
+    (ptrdiff_t)(ndims * 3) * (ptrdiff_t)sizeof(ptrdiff_t) + (ptrdiff_t)alignof(ptrdiff_t) +
+    /* tile_samples */
+    ntiles * (ptrdiff_t)sizeof(tph_poisson_vec) + (ptrdiff_t)alignof(tph_poisson_vec) +
+    /* tile_ret */
+    ntiles * (ptrdiff_t)sizeof(int) + (ptrdiff_t)alignof(int);
+  /* clang-format on */
+  void *mem = tph_poisson_mem_alloc(&internal->alloc,
+    mem_size,
+    (ptrdiff_t)alignof(ptrdiff_t),
+    TPH_POISSON_ALLOC_OTHER | TPH_POISSON_ALLOC_ZEROED);
+  if (mem == NULL) { return TPH_POISSON_BAD_ALLOC; }
+  tiling.tile_count = (ptrdiff_t *)tph_poisson_align(mem, alignof(ptrdiff_t));
+  tiling.phase_count = tiling.tile_count + ndims;
+  tiling.phase_offset = tiling.phase_count + ndims;
+  tiling.tile_samples = (tph_poisson_vec *)tph_poisson_align(
+    tiling.phase_offset + ndims, alignof(tph_poisson_vec));
+  tiling.tile_ret = (int *)tph_poisson_align(tiling.tile_samples + ntiles, alignof(int));
+  for (int32_t i = 0; i < ndims; ++i) {
+    tiling.tile_count[i] = (ctx->grid_size[i] + tile_cells - 1) / tile_cells;
+  }
+
+  /* Bit j of the phase is the parity of tile coordinates along the j:th axis with more than one
+   * tile. All phases have at least one tile. */
+  int ret = TPH_POISSON_SUCCESS;
+  const uint64_t nphases = (uint64_t)1 << split_axes;
+  for (uint64_t phase = 0; phase < nphases && ret == TPH_POISSON_SUCCESS; ++phase) {
+    ptrdiff_t ntasks = 1;
+    int32_t j = 0;
+    for (int32_t i = 0; i < ndims; ++i) {
+      tiling.phase_offset[i] = 0;
+      if (tiling.tile_count[i] > 1) { tiling.phase_offset[i] = (ptrdiff_t)((phase >> j++) & 1); }
+      tiling.phase_count[i] = (tiling.tile_count[i] - tiling.phase_offset[i] + 1) / 2;
+      ntasks *= tiling.phase_count[i];
+    }
+    TPH_POISSON_ASSERT(ntasks > 0);
+
+    if (executor != NULL) {
+      executor->run(tph_poisson_tile_task, &tiling, ntasks, executor->ctx);
+    } else {
+      for (ptrdiff_t t = 0; t < ntasks; ++t) { tph_poisson_tile_task(&tiling, t); }
+    }
+
+    /* Report the first error in tile order, regardless of the order tasks ran in. */
+    for (ptrdiff_t t = 0; t < ntiles && ret == TPH_POISSON_SUCCESS; ++t) {
+      ret = tiling.tile_ret[t];
+    }
+  }
+
+  /* Gather tile samples in tile order. */
+  ptrdiff_t size = 0;
+  for (ptrdiff_t t = 0; t < ntiles; ++t) { size += tph_poisson_vec_size(&tiling.tile_samples[t]); }
+  if (ret == TPH_POISSON_SUCCESS && size > 0) {
+    ret = tph_poisson_vec_reserve(&internal->samples,
+      &internal->alloc,
+      size,
+      (ptrdiff_t)alignof(tph_poisson_real),
+      TPH_POISSON_ALLOC_SAMPLES);
+  }
+  for (ptrdiff_t t = 0; t < ntiles; ++t) {
+    size = tph_poisson_vec_size(&tiling.tile_samples[t]);
+    if (ret == TPH_POISSON_SUCCESS && size > 0) {
+      /* Cannot fail, memory has been reserved. */
+      ret = tph_poisson_vec_append(&internal->samples,
+        &internal->alloc,
+        tiling.tile_samples[t].begin,
+        size,
+        (ptrdiff_t)alignof(tph_poisson_real),
+        TPH_POISSON_ALLOC_SAMPLES);
+    }
+    tph_poisson_vec_free(&tiling.tile_samples[t], &internal->alloc, TPH_POISSON_ALLOC_SAMPLES);
+  }
+  tph_poisson_mem_free(&internal->alloc, mem, mem_size, TPH_POISSON_ALLOC_OTHER);
+  return ret;
+}
+
+#ifdef TPH_POISSON_C11_THREADS
+typedef struct tph_poisson_c11_work_
+{
+  tph_poisson_task_fn task;
+  void *task_ctx;
+  ptrdiff_t ntasks;
+  atomic_ptrdiff_t next; /** Index of the next task to run. */
+} tph_poisson_c11_work;
+
+static int tph_poisson_c11_worker(void *arg)
+{
+  tph_poisson_c11_work *work = (tph_poisson_c11_work *)arg;
+  for (ptrdiff_t i = atomic_fetch_add(&work->next, 1); i < work->ntasks;
+       i = atomic_fetch_add(&work->next, 1)) {
+    work->task(work->task_ctx, i);
+  }
+  return 0;
+}
+
+void tph_poisson_c11_threads_run(tph_poisson_task_fn task,
+  void *task_ctx,
+  ptrdiff_t ntasks,
+  void *ctx)
+{
+  tph_poisson_c11_work work;
+  work.task = task;
+  work.task_ctx = task_ctx;
+  work.ntasks = ntasks;
+  atomic_init(&work.next, 0);
+
+  /* Tasks are taken from a shared counter, so all tasks are run even if some threads could not
+   * be created. The calling thread also runs tasks. */
+  thrd_t threads[TPH_POISSON_MAX_THREADS];
+  ptrdiff_t nthreads = ctx != NULL ? (ptrdiff_t)(*(const int32_t *)ctx) : 1;
+  nthreads = nthreads < ntasks ? nthreads : ntasks;
+  nthreads = nthreads < TPH_POISSON_MAX_THREADS ? nthreads : TPH_POISSON_MAX_THREADS;
+  ptrdiff_t spawned = 0;
+  while (spawned + 1 < nthreads
+         && thrd_create(&threads[spawned], tph_poisson_c11_worker, &work) == thrd_success) {
+    ++spawned;
+  }
+  (void)tph_poisson_c11_worker(&work);
+  for (ptrdiff_t i = 0; i < spawned; ++i) { thrd_join(threads[i], NULL); }
+}
+#endif
+
+/**
+ * @brief Creates a sampling, see tph_poisson_create and tph_poisson_create_stream.
+ * @param args     Arguments.
+ * @param stream   Stream, or NULL.
+ * @param alloc    Allocator, or NULL.
+ * @param sampling Sampling to store samples.
+ * @return TPH_POISSON_SUCCESS, or a non-zero error code.
+ */
+static int tph_poisson_create_impl(const tph_poisson_args *args,
+  const tph_poisson_stream *stream,
+  const tph_poisson_allocator *alloc,
+  tph_poisson_sampling *sampling)
+{
+  /* Allocator must provide malloc and free, or the aligned functions, allocator context is
+   * optional (may be null). */
+  if (sampling == NULL) { return TPH_POISSON_INVALID_ARGS; }
+  if (alloc != NULL && !tph_poisson_alloc_valid(alloc)) {
+    return TPH_POISSON_INVALID_ARGS;
+  }
+
+  /* Samples that are not retained cannot be referred to by grid cells, or be transposed. */
+  const bool retain = stream == NULL || stream->retain_samples != 0;
+  const tph_poisson_args *ctx_args = args;
+  tph_poisson_args stream_args;
+  if (!retain && args != NULL) {
+    if (args->output_layout != TPH_POISSON_LAYOUT_AOS) { return TPH_POISSON_INVALID_ARGS; }
+    stream_args = *args;
+    stream_args.grid_storage = TPH_POISSON_GRID_POINTS;
+    ctx_args = &stream_args;
+  }
+
+  /* Allocate internal data. */
+  if (sampling->internal != NULL) { tph_poisson_destroy(sampling); }
+  sampling->internal = tph_poisson_alloc_internal(alloc);
+  if (sampling->internal == NULL) { return TPH_POISSON_BAD_ALLOC; }
+  tph_poisson_sampling_internal *internal = sampling->internal;
+  internal->stream = stream;
+  if (stream != NULL) {
+    internal->stream_chunk_size =
+      stream->chunk_size > 0 ? stream->chunk_size : TPH_POISSON_STREAM_CHUNK_SIZE;
+  }
+
+  /* Initialize context. Validates arguments and allocates buffers. */
+  tph_poisson_context ctx;
+  TPH_POISSON_MEMSET(&ctx, 0, sizeof(tph_poisson_context));
+  int ret = tph_poisson_context_init(&internal->alloc, ctx_args, &ctx);
+  if (ret != TPH_POISSON_SUCCESS) {
+    /* No need to destroy context here. */
+    tph_poisson_destroy(sampling);
+    return ret;
+  }
+
+  /* Without retained samples the buffer holds at most one chunk. */
+  const ptrdiff_t sample_size = (ptrdiff_t)sizeof(tph_poisson_real) * ctx.ndims;
+  if (retain) {
+    ret = tph_poisson_samples_reserve(internal, &ctx, args);
+  } else if (internal->stream_chunk_size > PTRDIFF_MAX / 2 / sample_size) {
+    ret = TPH_POISSON_OVERFLOW;
+  } else {
+    ret = tph_poisson_vec_reserve(&internal->samples,
+      &internal->alloc,
+      internal->stream_chunk_size * sample_size,
+      (ptrdiff_t)alignof(tph_poisson_real),
+      TPH_POISSON_ALLOC_SAMPLES);
+  }
+  if (ret != TPH_POISSON_SUCCESS) {
+    tph_poisson_context_destroy(&ctx, &internal->alloc);
+    tph_poisson_destroy(sampling);
+    return ret;
+  }
+
+  /* Reserve memory for active indices, could use some analysis to find a
+   * better estimate here... */
+  ret = tph_poisson_vec_reserve(&ctx.active_cells,
+    &internal->alloc,
+    100 * ctx.active_cell_size,
+    ctx.active_cell_size,
+    TPH_POISSON_ALLOC_ACTIVE);
+  if (ret != TPH_POISSON_SUCCESS) {
+    tph_poisson_context_destroy(&ctx, &internal->alloc);
+    tph_poisson_destroy(sampling);
+    return ret;
+  }
+
+  ret = tph_poisson_run(&ctx, internal);
+  if (ret != TPH_POISSON_SUCCESS) {
+    tph_poisson_context_destroy(&ctx, &internal->alloc);
+    tph_poisson_destroy(sampling);
+    return ret;
+  }
+
+  /* Pass the last chunk, after which the sample buffer is empty unless samples are retained. */
+  if (stream != NULL) {
+    tph_poisson_stream_flush(internal, ctx.ndims);
+    internal->stream = NULL;
+  }
+
+  /* The transpose to the SoA layout copies the samples to a buffer without unused capacity. */
+  TPH_POISSON_ASSERT(tph_poisson_vec_size(&internal->samples) % sample_size == 0);
+  const ptrdiff_t nsamples =
+    retain ? tph_poisson_vec_size(&internal->samples) / sample_size : internal->stream_count;
+  ptrdiff_t soa_stride = 0;
+  if (args->output_layout == TPH_POISSON_LAYOUT_SOA) {
+    ret = tph_poisson_samples_to_soa(internal, ctx.ndims, &soa_stride);
+  } else {
+    ret = tph_poisson_vec_shrink_to_fit(&internal->samples,
+      &internal->alloc,
+      (ptrdiff_t)alignof(tph_poisson_real),
+      TPH_POISSON_ALLOC_SAMPLES);
+  }
+  if (ret != TPH_POISSON_SUCCESS) {
+    tph_poisson_context_destroy(&ctx, &internal->alloc);
+    tph_poisson_destroy(sampling);
+    return ret;
+  }
+
+  sampling->ndims = ctx.ndims;
+  sampling->nsamples = nsamples;
+  sampling->soa_stride = soa_stride;
+
+  tph_poisson_context_destroy(&ctx, &internal->alloc);
+
+  return TPH_POISSON_SUCCESS;
+}
+
+int tph_poisson_create(const tph_poisson_args *args,
+  const tph_poisson_allocator *alloc,
+  tph_poisson_sampling *sampling)
+{
+  return tph_poisson_create_impl(args, /*stream=*/NULL, alloc, sampling);
+}
+
+int tph_poisson_create_stream(const tph_poisson_args *args,
+  const tph_poisson_stream *stream,
+  const tph_poisson_allocator *alloc,
+  tph_poisson_sampling *sampling)
+{
+  if (stream == NULL || stream->samples == NULL || stream->chunk_size < 0) {
+    return TPH_POISSON_INVALID_ARGS;
+  }
+  return tph_poisson_create_impl(args, stream, alloc, sampling);
+}
+
+int tph_poisson_create_into(const tph_poisson_args *args,
+  const tph_poisson_allocator *alloc,
+  tph_poisson_real *samples,
+  const ptrdiff_t max_samples,
+  ptrdiff_t *nsamples)
+{
+  /* Allocator must provide malloc and free, or the aligned functions, allocator context is
+   * optional (may be null). */
+  if (nsamples == NULL) { return TPH_POISSON_INVALID_ARGS; }
+  *nsamples = 0;
+  if (max_samples < 0 || (samples == NULL && max_samples > 0)) { return TPH_POISSON_INVALID_ARGS; }
+  if (args != NULL && args->output_layout != TPH_POISSON_LAYOUT_AOS) {
+    return TPH_POISSON_INVALID_ARGS;
+  }
+  if (alloc != NULL && !tph_poisson_alloc_valid(alloc)) {
+    return TPH_POISSON_INVALID_ARGS;
+  }
+
+  /* Allocate internal data. Only used for the allocator here. */
+  tph_poisson_sampling_internal *internal = tph_poisson_alloc_internal(alloc);
+  if (internal == NULL) { return TPH_POISSON_BAD_ALLOC; }
+
+  /* Initialize context. Validates arguments and allocates buffers. */
+  tph_poisson_context ctx;
+  TPH_POISSON_MEMSET(&ctx, 0, sizeof(tph_poisson_context));
+  int ret = tph_poisson_context_init(&internal->alloc, args, &ctx);
+  if (ret == TPH_POISSON_SUCCESS) {
+    const ptrdiff_t sample_size = (ptrdiff_t)sizeof(tph_poisson_real) * ctx.ndims;
+    if (max_samples > PTRDIFF_MAX / sample_size) {
+      /* Cannot hold more samples than can be addressed. */
+      ret = TPH_POISSON_INVALID_ARGS;
+    } else {
+      /* The sample vector has a fixed capacity and is never freed, see
+       * tph_poisson_add_sample. */
+      internal->samples.mem = samples;
+      internal->samples.mem_size = max_samples * sample_size;
+      internal->samples.begin = samples;
+      internal->samples.end = samples;
+      internal->samples_capped = true;
+      internal->max_samples = max_samples;
+
+      /* Reserve memory for active indices, see tph_poisson_create. */
+      ret = tph_poisson_vec_reserve(&ctx.active_cells,
+        &internal->alloc,
+        100 * ctx.active_cell_size,
+        ctx.active_cell_size,
+        TPH_POISSON_ALLOC_ACTIVE);
+      if (ret == TPH_POISSON_SUCCESS) { ret = tph_poisson_run(&ctx, internal); }
+      if (ret == TPH_POISSON_SUCCESS || ret == TPH_POISSON_TRUNCATED) {
+        TPH_POISSON_ASSERT(tph_poisson_vec_size(&internal->samples) % sample_size == 0);
+        *nsamples = tph_poisson_vec_size(&internal->samples) / sample_size;
+      }
+    }
+    tph_poisson_context_destroy(&ctx, &internal->alloc);
+  }
+  /* No need to destroy context if initialization failed. */
+
+  const tph_poisson_allocator alloc_copy = internal->alloc;
+  tph_poisson_mem_free(&alloc_copy, internal->mem, internal->mem_size, TPH_POISSON_ALLOC_OTHER);
+  return ret;
+}
+
+int tph_poisson_max_samples(const tph_poisson_args *args, ptrdiff_t *max_samples)
+{
+  if (max_samples == NULL) { return TPH_POISSON_INVALID_ARGS; }
+  *max_samples = 0;
+  const int ret = tph_poisson_args_validate(args);
+  if (ret != TPH_POISSON_SUCCESS) { return ret; }
+
+  /* Same number of cells as tph_poisson_context_init, without padding. Each cell holds at most
+   * one sample. */
+  const int32_t ndims = args->ndims;
+  const tph_poisson_real dx_rcp = (tph_poisson_real)1 / tph_poisson_grid_dx(args->radius, ndims);
+  const tph_poisson_real max_extent = (tph_poisson_real)(PTRDIFF_MAX / 4);
+  tph_poisson_real extent = 0;
+  ptrdiff_t cells = 1;
+  for (int32_t i = 0; i < ndims; ++i) {
+    extent = TPH_POISSON_CEIL((args->bounds_max[i] - args->bounds_min[i]) * dx_rcp);
+    if (!(extent < max_extent)) { return TPH_POISSON_OVERFLOW; }
+    if ((ptrdiff_t)extent > PTRDIFF_MAX / cells) { return TPH_POISSON_OVERFLOW; }
+    cells *= (ptrdiff_t)extent;
+  }
+
+  /* Number of non-overlapping balls of radius r / 2 in the bounds grown by r / 2, computed as
+   * the product over axes of (extent + r) / (r / 2) divided by the volume of the unit ball. The
+   * bound is made slightly larger to account for rounding, the distance between samples is only
+   * checked in tph_poisson_real precision. */
+  const double r = (double)args->radius;
+  double balls = 1.0;
+  for (int32_t i = 0; i < ndims; ++i) {
+    balls *= ((double)args->bounds_max[i] - (double)args->bounds_min[i] + r) / (0.5 * r);
+  }
+  balls = balls / tph_poisson_unit_ball_volume(ndims) * (1.0 + 1e-4) + 1.0;
+  *max_samples = balls < (double)cells ? (ptrdiff_t)balls : cells;
+  return TPH_POISSON_SUCCESS;
+}
+
+int tph_poisson_estimate_samples(const tph_poisson_args *args, ptrdiff_t *nsamples)
+{
+  if (nsamples == NULL) { return TPH_POISSON_INVALID_ARGS; }
+  *nsamples = 0;
+  ptrdiff_t max_samples = 0;
+  const int ret = tph_poisson_max_samples(args, &max_samples);
+  if (ret != TPH_POISSON_SUCCESS) { return ret; }
+
+  /* Volume fraction covered by balls of radius r / 2 centered at the samples when random
+   * sequential addition saturates, in 1 to 8 dimensions (Torquato et al., 2006). The fraction
+   * shrinks by roughly the same factor for each further dimension. */
+  static const double saturation[8] = {
+    0.7476, 0.5470, 0.3841, 0.2600, 0.1707, 0.1092, 0.0686, 0.0423
+  };
+  const int32_t ndims = args->ndims;
+  double fraction = saturation[(ndims < 8 ? ndims : 8) - 1];
+  for (int32_t i = 8; i < ndims; ++i) { fraction *= 0.62; }
+
+  /* With k attempts the fraction reached is lower by a factor 1 - a * k^-b, fitted to
+   * samplings in 2 to 5 dimensions. Fewer attempts are needed to get close to saturation in
+   * low dimensions. One dimension behaves like two. */
+  const double d = ndims > 2 ? (double)(ndims - 2) : 0.0;
+  const double a = 0.44 + 0.2 * d;
+  const double b = 0.4 * TPH_POISSON_DPOW(0.8, d);
+  const double s = 1.0 - a * TPH_POISSON_DPOW((double)args->max_sample_attempts, -b);
+  fraction *= s > 0.1 ? s : 0.1;
+
+  /* Number of balls of radius r / 2 covering the fraction of the bounds grown by r / 4. */
+  const double r = (double)args->radius;
+  double estimate = fraction / tph_poisson_unit_ball_volume(ndims);
+  for (int32_t i = 0; i < ndims; ++i) {
+    estimate *= ((double)args->bounds_max[i] - (double)args->bounds_min[i] + 0.5 * r) / (0.5 * r);
+  }
+  *nsamples = estimate < (double)max_samples ? (ptrdiff_t)estimate + 1 : max_samples;
+  return TPH_POISSON_SUCCESS;
+}
+
+int tph_poisson_query_memory(const tph_poisson_args *args,
+  const ptrdiff_t max_samples,
+  ptrdiff_t *nbytes)
+{
+  if (nbytes == NULL) { return TPH_POISSON_INVALID_ARGS; }
+  *nbytes = 0;
+  ptrdiff_t cap = 0;
+  ptrdiff_t n = 0;
+  const int ret = tph_poisson_arena_plan(args, max_samples, &cap, &n);
+  if (ret != TPH_POISSON_SUCCESS) { return ret; }
+  *nbytes = n;
+  return TPH_POISSON_SUCCESS;
+}
+
+int tph_poisson_create_in_arena(const tph_poisson_args *args,
+  void *arena,
+  const ptrdiff_t arena_size,
+  const ptrdiff_t max_samples,
+  tph_poisson_sampling *sampling)
+{
+  if (sampling == NULL) { return TPH_POISSON_INVALID_ARGS; }
+  if (sampling->internal != NULL) { tph_poisson_destroy(sampling); }
+  if (arena_size < 0 || (arena == NULL && arena_size > 0)) { return TPH_POISSON_INVALID_ARGS; }
+  if (args != NULL && args->output_layout != TPH_POISSON_LAYOUT_AOS) {
+    return TPH_POISSON_INVALID_ARGS;
+  }
+  ptrdiff_t cap = 0;
+  ptrdiff_t nbytes = 0;
+  int ret = tph_poisson_arena_plan(args, max_samples, &cap, &nbytes);
+  if (ret != TPH_POISSON_SUCCESS) { return ret; }
+  if (arena_size < nbytes) { return TPH_POISSON_BAD_ALLOC; }
+
+  /* The allocator state lives in the arena, so that the sampling can refer to it. */
+  tph_poisson_arena *head =
+    (tph_poisson_arena *)tph_poisson_align(arena, alignof(tph_poisson_arena));
+  head->ptr = (intptr_t)(head + 1);
+  head->end = (intptr_t)arena + arena_size;
+  const tph_poisson_allocator alloc = { tph_poisson_arena_malloc,
+    tph_poisson_arena_free,
+    head,
+    /*.realloc=*/NULL,
+    /*.calloc=*/NULL,
+    /*.aligned_malloc=*/NULL,
+    /*.aligned_free=*/NULL };
+
+  /* Allocations below cannot fail, the arena holds all buffers (see tph_poisson_arena_plan). */
+  sampling->internal = tph_poisson_alloc_internal(&alloc);
+  if (sampling->internal == NULL) { return TPH_POISSON_BAD_ALLOC; }
+  tph_poisson_sampling_internal *internal = sampling->internal;
+
+  tph_poisson_context ctx;
+  TPH_POISSON_MEMSET(&ctx, 0, sizeof(tph_poisson_context));
+  ret = tph_poisson_context_init(&internal->alloc, args, &ctx);
+  if (ret != TPH_POISSON_SUCCESS) {
+    tph_poisson_destroy(sampling);
+    return ret;
+  }
+
+  /* Buffers are sized for the sample cap and never grow. The sample buffer is not shrunk after
+   * sampling, that would need another allocation. */
+  const ptrdiff_t sample_size = (ptrdiff_t)sizeof(tph_poisson_real) * ctx.ndims;
+  internal->samples_capped = true;
+  internal->max_samples = cap;
+  ret = tph_poisson_vec_reserve(&internal->samples,
+    &internal->alloc,
+    cap * sample_size,
+    (ptrdiff_t)alignof(tph_poisson_real),
+    TPH_POISSON_ALLOC_SAMPLES);
+  if (ret == TPH_POISSON_SUCCESS) {
+    ret = tph_poisson_vec_reserve(&ctx.active_cells,
+      &internal->alloc,
+      cap * ctx.active_cell_size,
+      ctx.active_cell_size,
+      TPH_POISSON_ALLOC_ACTIVE);
+  }
+  if (ret == TPH_POISSON_SUCCESS) { ret = tph_poisson_run(&ctx, internal); }
+  tph_poisson_context_destroy(&ctx, &internal->alloc);
+  if (ret != TPH_POISSON_SUCCESS && ret != TPH_POISSON_TRUNCATED) {
+    tph_poisson_destroy(sampling);
+    return ret;
+  }
+
+  TPH_POISSON_ASSERT(tph_poisson_vec_size(&internal->samples) % sample_size == 0);
+  sampling->ndims = ctx.ndims;
+  sampling->nsamples = tph_poisson_vec_size(&internal->samples) / sample_size;
+  sampling->soa_stride = 0;
+  return ret;
+}
+
+int tph_poisson_create_parallel(const tph_poisson_args *args,
+  const tph_poisson_executor *executor,
+  const tph_poisson_allocator *alloc,
+  tph_poisson_sampling *sampling)
+{
+  /* Allocator must provide malloc and free, or the aligned functions, allocator context is
+   * optional (may be null). Same for the executor. */
+  if (sampling == NULL || args == NULL) { return TPH_POISSON_INVALID_ARGS; }
+  if (alloc != NULL && !tph_poisson_alloc_valid(alloc)) {
+    return TPH_POISSON_INVALID_ARGS;
+  }
+  if (executor != NULL && executor->run == NULL) { return TPH_POISSON_INVALID_ARGS; }
+
+  /* Allocate internal data. */
+  if (sampling->internal != NULL) { tph_poisson_destroy(sampling); }
+  sampling->internal = tph_poisson_alloc_internal(alloc);
+  if (sampling->internal == NULL) { return TPH_POISSON_BAD_ALLOC; }
+  tph_poisson_sampling_internal *internal = sampling->internal;
+
+  /* Tiles write to a shared grid concurrently. Storing points means that cells do not refer to
+   * tile sample buffers, and a dense grid means that no pages are allocated while sampling. */
+  tph_poisson_args grid_args = *args;
+  grid_args.grid_storage = TPH_POISSON_GRID_POINTS;
+  grid_args.grid_max_dense_size = PTRDIFF_MAX;
+  grid_args.candidate_batch_size = 1;
+
+  /* Initialize context. Validates arguments and allocates buffers. */
+  tph_poisson_context ctx;
+  TPH_POISSON_MEMSET(&ctx, 0, sizeof(tph_poisson_context));
+  int ret = tph_poisson_context_init(&internal->alloc, &grid_args, &ctx);
+  if (ret != TPH_POISSON_SUCCESS) {
+    /* No need to destroy context here. */
+    tph_poisson_destroy(sampling);
+    return ret;
+  }
+  if (ctx.grid_cells == NULL) {
+    /* Too large for a dense grid. */
+    tph_poisson_context_destroy(&ctx, &internal->alloc);
+    tph_poisson_destroy(sampling);
+    return TPH_POISSON_OVERFLOW;
+  }
+
+#ifndef TPH_POISSON_ATOMIC_OR_U64
+  /* Bits of cells in different tiles may share words, which cannot be updated concurrently. */
+  ctx.grid_occupancy = NULL;
+#endif
+
+  /* Tiles must be at least as large as the halo of cells around them that may hold samples
+   * spawning candidates in them, so that the halo only overlaps adjacent tiles. */
+  const tph_poisson_real halo = (tph_poisson_real)ctx.annulus_outer * ctx.radius;
+  const tph_poisson_real tile_size =
+    args->tile_size >= 0 && args->tile_size <= 0 ? 8 * halo : args->tile_size;
+  if (!(tile_size >= halo)) {
+    tph_poisson_context_destroy(&ctx, &internal->alloc);
+    tph_poisson_destroy(sampling);
+    return TPH_POISSON_INVALID_ARGS;
+  }
+  ptrdiff_t max_grid_size = 1;
+  for (int32_t i = 0; i < ctx.ndims; ++i) {
+    max_grid_size = max_grid_size < ctx.grid_size[i] ? ctx.grid_size[i] : max_grid_size;
+  }
+  const tph_poisson_real halo_cells = TPH_POISSON_CEIL(halo * ctx.grid_dx_rcp);
+  const tph_poisson_real tile_cells = TPH_POISSON_CEIL(tile_size * ctx.grid_dx_rcp);
+  ret = tph_poisson_run_tiles(&ctx,
+    internal,
+    executor,
+    args->seed,
+    tile_cells < (tph_poisson_real)max_grid_size ? (ptrdiff_t)tile_cells : max_grid_size,
+    halo_cells < (tph_poisson_real)max_grid_size ? (ptrdiff_t)halo_cells : max_grid_size);
+  if (ret != TPH_POISSON_SUCCESS) {
+    tph_poisson_context_destroy(&ctx, &internal->alloc);
+    tph_poisson_destroy(sampling);
+    return ret;
+  }
+
+  /* Tile samples are gathered into a buffer without unused capacity. */
+  const ptrdiff_t sample_size = (ptrdiff_t)sizeof(tph_poisson_real) * ctx.ndims;
+  TPH_POISSON_ASSERT(tph_poisson_vec_size(&internal->samples) % sample_size == 0);
+  const ptrdiff_t nsamples = tph_poisson_vec_size(&internal->samples) / sample_size;
+  ptrdiff_t soa_stride = 0;
+  if (args->output_layout == TPH_POISSON_LAYOUT_SOA) {
+    ret = tph_poisson_samples_to_soa(internal, ctx.ndims, &soa_stride);
+    if (ret != TPH_POISSON_SUCCESS) {
+      tph_poisson_context_destroy(&ctx, &internal->alloc);
+      tph_poisson_destroy(sampling);
+      return ret;
+    }
+  }
+  sampling->ndims = ctx.ndims;
+  sampling->nsamples = nsamples;
+  sampling->soa_stride = soa_stride;
+
+  tph_poisson_context_destroy(&ctx, &internal->alloc);
+
+  return TPH_POISSON_SUCCESS;
+}
+
+void tph_poisson_destroy(tph_poisson_sampling *sampling)
+{
+  if (sampling != NULL) {
+    tph_poisson_sampling_internal *internal = sampling->internal;
+    if (internal != NULL) {
+      const tph_poisson_allocator alloc = internal->alloc;
+      tph_poisson_vec_free(&internal->samples, &alloc, TPH_POISSON_ALLOC_SAMPLES);
+      tph_poisson_mem_free(&alloc, internal->mem, internal->mem_size, TPH_POISSON_ALLOC_OTHER);
+    }
+    /* Protects from destroy being called more than once causing a double-free error. */
+    TPH_POISSON_MEMSET(sampling, 0, sizeof(tph_poisson_sampling));
+  }
+}
+
+const tph_poisson_real *tph_poisson_get_samples(const tph_poisson_sampling *sampling)
+{
+  /* Make sure that a 'destroyed' sampling does not return any samples. */
+  if (sampling != NULL && sampling->internal != NULL) {
+    return (const tph_poisson_real *)sampling->internal->samples.begin;
+  }
+  return NULL;
+}
+
+/**
+ * @brief Returns the IEEE 754 half precision bits of a number in [0, 1], rounded to nearest.
+ * @param t Number in [0, 1].
+ * @return Half precision bits.
+ */
+static uint16_t tph_poisson_to_half(const double t)
+{
+  TPH_POISSON_ASSERT(0 <= t && t <= 1);
+  /* Subnormals are multiples of 2^-24. */
+  if (t < 0x1.0p-14) { return (uint16_t)(t * 0x1.0p24 + 0.5); }
+  int32_t e = 0;
+  double scale = 1024.0; /* 2^(10 - e) */
+  while (t * scale < 1024.0) {
+    --e;
+    scale *= 2.0;
+  }
+  uint32_t m = (uint32_t)(t * scale + 0.5);
+  if (m == 2048) {
+    /* Rounded up to the next power of two. */
+    m = 1024;
+    ++e;
+  }
+  return (uint16_t)(((uint32_t)(e + 15) << 10) | (m - 1024));
+}
+
+int tph_poisson_quantize(const tph_poisson_sampling *sampling,
+  const tph_poisson_args *args,
+  const int32_t format,
+  const tph_poisson_real tolerance,
+  void *samples,
+  const ptrdiff_t nbytes)
+{
+  if (sampling == NULL || sampling->internal == NULL || samples == NULL) {
+    return TPH_POISSON_INVALID_ARGS;
+  }
+  const int ret = tph_poisson_args_validate(args);
+  if (ret != TPH_POISSON_SUCCESS) { return ret; }
+  const int32_t ndims = sampling->ndims;
+  if (args->ndims != ndims || !(tolerance >= 0)) { return TPH_POISSON_INVALID_ARGS; }
+
+  /* Largest error per coordinate relative to the extent, see TPH_POISSON_QUANTIZE_*. */
+  double rel_error = 0;
+  ptrdiff_t value_size = 0;
+  switch (format) {
+  case TPH_POISSON_QUANTIZE_U16:
+    rel_error = 0.5 / 65535.0;
+    value_size = (ptrdiff_t)sizeof(uint16_t);
+    break;
+  case TPH_POISSON_QUANTIZE_U32:
+    rel_error = 0.5 / 4294967295.0;
+    value_size = (ptrdiff_t)sizeof(uint32_t);
+    break;
+  case TPH_POISSON_QUANTIZE_F16:
+    rel_error = 0x1.0p-12;
+    value_size = (ptrdiff_t)sizeof(uint16_t);
+    break;
+  default:
+    return TPH_POISSON_INVALID_ARGS;
+  }
+  double error_sqr = 0;
+  double extent = 0;
+  for (int32_t i = 0; i < ndims; ++i) {
+    extent = (double)args->bounds_max[i] - (double)args->bounds_min[i];
+    error_sqr += (rel_error * extent) * (rel_error * extent);
+  }
+  if (!(TPH_POISSON_DSQRT(error_sqr) <= (double)tolerance * (double)args->radius)) {
+    return TPH_POISSON_INVALID_ARGS;
+  }
+
+  /* Samples are read in the order they are stored, and written to the same position. */
+  const bool soa = sampling->soa_stride > 0;
+  const ptrdiff_t nvalues = (soa ? sampling->soa_stride : sampling->nsamples) * ndims;
+  if (nbytes / value_size < nvalues) { return TPH_POISSON_INVALID_ARGS; }
+  const tph_poisson_real *src = tph_poisson_get_samples(sampling);
+  uint16_t *dst16 = (uint16_t *)samples;
+  uint32_t *dst32 = (uint32_t *)samples;
+  if (soa) { TPH_POISSON_MEMSET(samples, 0, (size_t)(nvalues * value_size)); }
+  ptrdiff_t k = 0;
+  double t = 0;
+  for (ptrdiff_t j = 0; j < sampling->nsamples; ++j) {
+    for (int32_t i = 0; i < ndims; ++i) {
+      k = soa ? i * sampling->soa_stride + j : j * ndims + i;
+      t = ((double)src[k] - (double)args->bounds_min[i])
+          / ((double)args->bounds_max[i] - (double)args->bounds_min[i]);
+      t = t > 0 ? (t < 1 ? t : 1) : 0;
+      switch (format) {
+      case TPH_POISSON_QUANTIZE_U16:
+        dst16[k] = (uint16_t)(t * 65535.0 + 0.5);
+        break;
+      case TPH_POISSON_QUANTIZE_U32:
+        dst32[k] = (uint32_t)(t * 4294967295.0 + 0.5);
+        break;
+      default:
+        dst16[k] = tph_poisson_to_half(t);
+        break;
+      }
+    }
+  }
+  return TPH_POISSON_SUCCESS;
+}
+
+int tph_poisson_sampler_create(const tph_poisson_args *args,
+  const tph_poisson_allocator *alloc,
+  tph_poisson_sampler *sampler)
+{
+  /* Allocator must provide malloc and free, or the aligned functions, allocator context is
+   * optional (may be null). */
+  if (sampler == NULL) { return TPH_POISSON_INVALID_ARGS; }
+  if (args != NULL && args->output_layout != TPH_POISSON_LAYOUT_AOS) {
+    return TPH_POISSON_INVALID_ARGS;
+  }
+  if (alloc != NULL && !tph_poisson_alloc_valid(alloc)) {
+    return TPH_POISSON_INVALID_ARGS;
+  }
+
+  /* Allocate internal data, see tph_poisson_alloc_internal. */
+  if (sampler->internal != NULL) { tph_poisson_sampler_destroy(sampler); }
+  tph_poisson_allocator internal_alloc;
+  tph_poisson_alloc_copy(alloc, &internal_alloc);
+  const ptrdiff_t alignment = (ptrdiff_t)alignof(tph_poisson_sampler_internal);
+  const ptrdiff_t mem_size = (ptrdiff_t)sizeof(tph_poisson_sampler_internal)
+                             + tph_poisson_alloc_slack(&internal_alloc, alignment);
+  void *mem = tph_poisson_mem_alloc(
+    &internal_alloc, mem_size, alignment, TPH_POISSON_ALLOC_OTHER | TPH_POISSON_ALLOC_ZEROED);
+  if (mem == NULL) { return TPH_POISSON_BAD_ALLOC; }
+  tph_poisson_sampler_internal *internal =
+    (tph_poisson_sampler_internal *)tph_poisson_align(mem, (size_t)alignment);
+  internal->sampling.alloc = internal_alloc;
+  internal->sampling.mem = mem;
+  internal->sampling.mem_size = mem_size;
+  sampler->internal = internal;
+
+  /* Initialize context. Validates arguments and allocates buffers. */
+  int ret = tph_poisson_context_init(&internal->sampling.alloc, args, &internal->ctx);
+  if (ret != TPH_POISSON_SUCCESS) {
+    /* No need to destroy context here. */
+    tph_poisson_mem_free(&internal_alloc, mem, mem_size, TPH_POISSON_ALLOC_OTHER);
+    TPH_POISSON_MEMSET(sampler, 0, sizeof(tph_poisson_sampler));
+    return ret;
+  }
+
+  /* Same as tph_poisson_create, sample memory and the active list are kept between runs. */
+  ret = tph_poisson_samples_reserve(&internal->sampling, &internal->ctx, args);
+  if (ret != TPH_POISSON_SUCCESS) {
+    tph_poisson_sampler_destroy(sampler);
+    return ret;
+  }
+  ret = tph_poisson_vec_reserve(&internal->ctx.active_cells,
+    &internal->sampling.alloc,
+    100 * internal->ctx.active_cell_size,
+    internal->ctx.active_cell_size,
+    TPH_POISSON_ALLOC_ACTIVE);
+  if (ret != TPH_POISSON_SUCCESS) {
+    tph_poisson_sampler_destroy(sampler);
+    return ret;
+  }
+
+  sampler->ndims = internal->ctx.ndims;
+  sampler->nsamples = 0;
+  return TPH_POISSON_SUCCESS;
+}
+
+int tph_poisson_sampler_run(tph_poisson_sampler *sampler, const uint64_t seed)
+{
+  const int ret = tph_poisson_sampler_begin(sampler, seed);
+  if (ret != TPH_POISSON_SUCCESS) { return ret; }
+  int32_t done = 0;
+  return tph_poisson_sampler_step(sampler, /*max_attempts=*/0, &done);
+}
+
+int tph_poisson_sampler_begin(tph_poisson_sampler *sampler, const uint64_t seed)
+{
+  if (sampler == NULL || sampler->internal == NULL) { return TPH_POISSON_INVALID_ARGS; }
+  tph_poisson_sampler_internal *internal = sampler->internal;
+  tph_poisson_context *ctx = &internal->ctx;
+  sampler->nsamples = 0;
+
+  /* Samples from the previous run, even a failed one, are exactly the samples in the grid. Cells
+   * are only written after the sample has been appended, see tph_poisson_add_sample. */
+  tph_poisson_grid_clear(ctx, &internal->sampling.samples);
+  internal->sampling.samples.end = internal->sampling.samples.begin;
+  ctx->active_cells.end = ctx->active_cells.begin;
+  ctx->angular_start = 0;
+  tph_poisson_xoshiro256p_init(&ctx->prng_state, seed);
+  if (ctx->prng_x4 != NULL) { tph_poisson_xoshiro256p_x4_init(ctx->prng_x4, seed); }
+  internal->step_state = TPH_POISSON_STEP_RUNNING;
+  return TPH_POISSON_SUCCESS;
+}
+
+int tph_poisson_sampler_step(tph_poisson_sampler *sampler,
+  const ptrdiff_t max_attempts,
+  int32_t *done)
+{
+  if (done == NULL) { return TPH_POISSON_INVALID_ARGS; }
+  *done = 0;
+  if (sampler == NULL || sampler->internal == NULL || max_attempts < 0) {
+    return TPH_POISSON_INVALID_ARGS;
+  }
+  tph_poisson_sampler_internal *internal = sampler->internal;
+  tph_poisson_context *ctx = &internal->ctx;
+  if (internal->step_state == TPH_POISSON_STEP_DONE) {
+    *done = 1;
+    return TPH_POISSON_SUCCESS;
+  }
+  if (internal->step_state != TPH_POISSON_STEP_RUNNING) { return TPH_POISSON_INVALID_ARGS; }
+
+  /* The active list is only empty before the first step, which places the first sample, and
+   * after the last one. */
+  ctx->attempt_budget = max_attempts;
+  const int ret = tph_poisson_run(ctx, &internal->sampling);
+  ctx->attempt_budget = 0;
+  if (ret != TPH_POISSON_SUCCESS) {
+    internal->step_state = TPH_POISSON_STEP_IDLE;
+    sampler->nsamples = 0;
+    return ret;
+  }
+
+  const ptrdiff_t sample_size = (ptrdiff_t)sizeof(tph_poisson_real) * ctx->ndims;
+  TPH_POISSON_ASSERT(tph_poisson_vec_size(&internal->sampling.samples) % sample_size == 0);
+  sampler->nsamples = tph_poisson_vec_size(&internal->sampling.samples) / sample_size;
+  if (tph_poisson_vec_size(&ctx->active_cells) == 0) {
+    internal->step_state = TPH_POISSON_STEP_DONE;
+    *done = 1;
+  }
+  return TPH_POISSON_SUCCESS;
+}
+
+void tph_poisson_sampler_destroy(tph_poisson_sampler *sampler)
+{
+  if (sampler != NULL) {
+    tph_poisson_sampler_internal *internal = sampler->internal;
+    if (internal != NULL) {
+      tph_poisson_allocator alloc = internal->sampling.alloc;
+      tph_poisson_context_destroy(&internal->ctx, &alloc);
+      tph_poisson_vec_free(&internal->sampling.samples, &alloc, TPH_POISSON_ALLOC_SAMPLES);
+      tph_poisson_mem_free(
+        &alloc, internal->sampling.mem, internal->sampling.mem_size, TPH_POISSON_ALLOC_OTHER);
+    }
+    /* Protects from destroy being called more than once causing a double-free error. */
+    TPH_POISSON_MEMSET(sampler, 0, sizeof(tph_poisson_sampler));
+  }
+}
 
-  return TPH_POISSON_SUCCESS;
+const tph_poisson_real *tph_poisson_sampler_get_samples(const tph_poisson_sampler *sampler)
+{
+  /* Samples of a failed run are not returned. */
+  if (sampler != NULL && sampler->internal != NULL && sampler->nsamples > 0) {
+    return (const tph_poisson_real *)sampler->internal->sampling.samples.begin;
+  }
+  return NULL;
 }
 
 /**
- * @brief Frees all memory allocated by the context.
- * @param ctx Context.
+ * @brief Returns a hash of the seed and the tile coordinates, used to seed the pseudo-random number
+ * generator of the tile, see tph_poisson_tiler_create.
+ * @param seed  Seed.
+ * @param tile  Tile coordinates.
+ * @param ndims Number of dimensions.
+ * @return Hash value.
  */
-static void tph_poisson_context_destroy(tph_poisson_context *ctx, tph_poisson_allocator *alloc)
+static uint64_t tph_poisson_tile_hash(const uint64_t seed, const int64_t *tile, const int32_t ndims)
 {
-  TPH_POISSON_ASSERT(ctx && alloc);
-  tph_poisson_vec_free(&ctx->active_indices, alloc);
-  alloc->free(ctx->mem, ctx->mem_size, alloc->ctx);
+  tph_poisson_splitmix64_state sm_state = { seed };
+  uint64_t h = tph_poisson_splitmix64(&sm_state);
+  for (int32_t i = 0; i < ndims; ++i) {
+    sm_state.s = h ^ (uint64_t)tile[i];
+    h = tph_poisson_splitmix64(&sm_state);
+  }
+  return h;
 }
 
 /**
- * @brief Returns true if p is element-wise inclusively inside b_min and b_max; otherwise false.
- * Assumes that b_min is element-wise less than b_max.
- * @param p     Position to test.
- * @param b_min Minimum bounds.
- * @param b_max Maximum bounds.
- * @param ndims Number of values in p, b_min, and b_max.
- * @return Non-zero if p is element-wise inclusively inside the bounded region; otherwise zero.
+ * @brief Returns true if tile a is ranked higher than tile b, in which case samples of tile b
+ * that are too close to samples of tile a are dropped. Tiles are ranked by a hash of the seed and
+ * their coordinates, ties are broken by comparing coordinates.
+ * @param seed  Seed.
+ * @param a     Tile coordinates.
+ * @param b     Tile coordinates, different from a.
+ * @param ndims Number of dimensions.
+ * @return True if tile a is ranked higher than tile b; otherwise false.
  */
-static bool tph_poisson_inside(const tph_poisson_real *p,
-  const tph_poisson_real *b_min,
-  const tph_poisson_real *b_max,
+static bool tph_poisson_tile_outranks(const uint64_t seed,
+  const int64_t *a,
+  const int64_t *b,
   const int32_t ndims)
 {
-  /* Note returns true if ndims <= 0.  */
-  bool inside = true;
+  tph_poisson_splitmix64_state sm_state_a = { tph_poisson_tile_hash(seed, a, ndims) };
+  tph_poisson_splitmix64_state sm_state_b = { tph_poisson_tile_hash(seed, b, ndims) };
+  const uint64_t rank_a = tph_poisson_splitmix64(&sm_state_a);
+  const uint64_t rank_b = tph_poisson_splitmix64(&sm_state_b);
+  if (rank_a != rank_b) { return rank_a > rank_b; }
   for (int32_t i = 0; i < ndims; ++i) {
-    /* No early exit, always check all dims. */
-    TPH_POISSON_ASSERT(b_min[i] < b_max[i]);
-    inside &= (p[i] >= b_min[i]);
-    inside &= (p[i] <= b_max[i]);
+    if (a[i] != b[i]) { return a[i] > b[i]; }
   }
-  return inside;
+  return false;
 }
 
 /**
- * @brief Add a sample, which is assumed here to fulfill all the Poisson requirements. Updates the
- * necessary internal data structures and the context.
- * @param ctx      Context.
- * @param internal Internal data.
- * @param sample   Sample to add.
- * @return TPH_POISSON_SUCCESS, or a non-zero error code.
+ * @brief Returns the position of the lower corner of a tile along one axis.
+ * @param tile_size Side length of the tiles.
+ * @param t         Tile coordinate.
+ * @return Tile origin.
  */
-static int tph_poisson_add_sample(tph_poisson_context *ctx,
-  tph_poisson_sampling_internal *internal,
-  const tph_poisson_real *sample)
+static TPH_POISSON_INLINE tph_poisson_real tph_poisson_tile_origin(const tph_poisson_real tile_size,
+  const int64_t t)
 {
-  TPH_POISSON_ASSERT(tph_poisson_inside(sample, ctx->bounds_min, ctx->bounds_max, ctx->ndims));
-  TPH_POISSON_ASSERT(
-    tph_poisson_vec_size(&internal->samples) % ((ptrdiff_t)sizeof(tph_poisson_real) * ctx->ndims)
-    == 0);
-  const ptrdiff_t sample_index =
-    tph_poisson_vec_size(&internal->samples) / ((ptrdiff_t)sizeof(tph_poisson_real) * ctx->ndims);
-  if ((uint32_t)sample_index == 0xFFFFFFFF) {
-    /* The sample index cannot be the same as the sentinel value of the grid. */
-    return TPH_POISSON_OVERFLOW;
-  }
+  return (tph_poisson_real)((double)t * (double)tile_size);
+}
 
-  int ret = tph_poisson_vec_append(&internal->samples,
-    &internal->alloc,
-    sample,
-    (ptrdiff_t)sizeof(tph_poisson_real) * ctx->ndims,
-    (ptrdiff_t)alignof(tph_poisson_real));
-  if (ret != TPH_POISSON_SUCCESS) { return ret; }
-  ret = tph_poisson_vec_append(&ctx->active_indices,
-    &internal->alloc,
-    &sample_index,
-    (ptrdiff_t)sizeof(ptrdiff_t),
-    (ptrdiff_t)alignof(ptrdiff_t));
+/**
+ * @brief Samples a tile on its own and appends the samples, offset by the tile origin, to the
+ * provided vectors.
+ * @param internal Tiler internal data.
+ * @param tile     Tile coordinates.
+ * @param ndims    Number of dimensions.
+ * @param samples  Vector that all samples are appended to, or NULL.
+ * @param halo     Vector that samples near the tile border are appended to, or NULL.
+ * @return TPH_POISSON_SUCCESS, or a non-zero error code.
+ */
+static int tph_poisson_tiler_sample(tph_poisson_tiler_internal *internal,
+  const int64_t *tile,
+  const int32_t ndims,
+  tph_poisson_vec *samples,
+  tph_poisson_vec *halo)
+{
+  int ret =
+    tph_poisson_sampler_run(&internal->sampler, tph_poisson_tile_hash(internal->seed, tile, ndims));
   if (ret != TPH_POISSON_SUCCESS) { return ret; }
-
-  /* Compute linear grid index. */
-  TPH_POISSON_ASSERT(ctx->grid_stride[0] == 1);
-  ptrdiff_t xi = (ptrdiff_t)TPH_POISSON_FLOOR((sample[0] - ctx->bounds_min[0]) * ctx->grid_dx_rcp);
-  TPH_POISSON_ASSERT((0 <= xi) & (xi < ctx->grid_size[0]));
-  ptrdiff_t k = xi;
-  for (int32_t i = 1; i < ctx->ndims; ++i) {
-    xi = (ptrdiff_t)TPH_POISSON_FLOOR((sample[i] - ctx->bounds_min[i]) * ctx->grid_dx_rcp);
-    TPH_POISSON_ASSERT((0 <= xi) & (xi < ctx->grid_size[i]));
-    /* Not checking for overflow! */
-    k += xi * ctx->grid_stride[i];
+  for (int32_t i = 0; i < ndims; ++i) {
+    internal->origin[i] = tph_poisson_tile_origin(internal->tile_size, tile[i]);
   }
 
-  /* Record sample index in grid. Each grid cell can hold up to one sample,
-   * and once a cell has been assigned a sample it should not be updated.
-   * It is assumed here that the cell has its sentinel value before being
-   * assigned a sample index. */
-  TPH_POISSON_ASSERT(ctx->grid_cells[k] == 0xFFFFFFFF);
-  ctx->grid_cells[k] = (uint32_t)sample_index;
-  return TPH_POISSON_SUCCESS;
+  const tph_poisson_real *local = tph_poisson_sampler_get_samples(&internal->sampler);
+  const ptrdiff_t sample_size = (ptrdiff_t)sizeof(tph_poisson_real) * ndims;
+  const tph_poisson_real inner_max = internal->tile_size - internal->border;
+  for (ptrdiff_t j = 0; j < internal->sampler.nsamples && ret == TPH_POISSON_SUCCESS; ++j) {
+    const tph_poisson_real *p = local + j * ndims;
+    bool near_border = false;
+    for (int32_t i = 0; i < ndims; ++i) {
+      internal->sample[i] = internal->origin[i] + p[i];
+      near_border = near_border || p[i] < internal->border || p[i] > inner_max;
+    }
+    if (samples != NULL) {
+      ret = tph_poisson_vec_append(samples,
+        &internal->alloc,
+        internal->sample,
+        sample_size,
+        (ptrdiff_t)alignof(tph_poisson_real),
+        TPH_POISSON_ALLOC_SAMPLES);
+    }
+    if (ret == TPH_POISSON_SUCCESS && halo != NULL && near_border) {
+      ret = tph_poisson_vec_append(halo,
+        &internal->alloc,
+        internal->sample,
+        sample_size,
+        (ptrdiff_t)alignof(tph_poisson_real),
+        TPH_POISSON_ALLOC_SAMPLES);
+    }
+  }
+  return ret;
 }
 
 /**
- * @brief Generate a pseudo-random sample position that is guaranteed be at a distance
- * [radius, 2 * radius] from the provided center position.
- * @param ctx    Context.
- * @param center Center position.
- * @param sample Output sample position.
+ * @brief Returns the cached halo of a tile and marks it as the most recently used, or NULL if
+ * the tile is not in the cache.
+ * @param internal Tiler internal data.
+ * @param tile     Tile coordinates.
+ * @param ndims    Number of dimensions.
+ * @return Cache entry, or NULL.
  */
-static void tph_poisson_rand_annulus_sample(tph_poisson_context *ctx,
-  const tph_poisson_real *center,
-  tph_poisson_real *sample)
+static tph_poisson_tile_halo *tph_poisson_tiler_cache_find(tph_poisson_tiler_internal *internal,
+  const int64_t *tile,
+  const int32_t ndims)
 {
-  int32_t i = 0;
-  tph_poisson_real sqr_mag = 0;
-  for (;;) {
-    /* Generate a random component in the range [-2, 2] for each dimension.
-     * Use sample storage to temporarily store components. */
-    sqr_mag = 0;
-    for (i = 0; i < ctx->ndims; ++i) {
-      /* clang-format off */
-      sample[i] = (tph_poisson_real)(-2 + 4 * tph_poisson_to_double(
-          tph_poisson_xoshiro256p_next(&ctx->prng_state)));
-      /* clang-format on */
-      sqr_mag += sample[i] * sample[i];
-    }
-
-    /* The randomized offset is not guaranteed to be within the radial
-     * distance that we need to guarantee. If we found an offset with
-     * magnitude in the range (1, 2] we are done, otherwise generate a new
-     * offset. Continue until a valid offset is found. */
-    if (((int)((tph_poisson_real)1 < sqr_mag) & (int)(sqr_mag <= (tph_poisson_real)4)) == 1) {
-      /* Found a valid offset.
-       * Add the offset scaled by radius to the center coordinate to
-       * produce the final sample. */
-      for (i = 0; i < ctx->ndims; ++i) { sample[i] = center[i] + ctx->radius * sample[i]; }
-      break;
+  for (ptrdiff_t k = 0; k < internal->cache_size; ++k) {
+    tph_poisson_tile_halo *entry = &internal->cache[k];
+    if (entry->last_used == 0) { continue; }
+    int32_t i = 0;
+    while (i < ndims && entry->tile[i] == tile[i]) { ++i; }
+    if (i == ndims) {
+      entry->last_used = ++internal->cache_clock;
+      return entry;
     }
   }
+  return NULL;
 }
 
 /**
- * @brief Computes the grid index range in which the provided sample position needs to check for
- * other samples that are possible closer than the radius (given in context).
- * @param ctx            Context.
- * @param sample         Input sample position.
- * @param min_grid_index Minimum grid index.
- * @param max_grid_index Maximum grid index.
+ * @brief Returns an empty cache entry, evicting the least recently used tile if there are no
+ * empty entries. The entry stays empty until tph_poisson_tiler_cache_insert is called, so that
+ * an entry is never left holding some of the samples of a tile.
+ * @param internal Tiler internal data.
+ * @return Cache entry.
  */
-static void tph_poisson_grid_index_bounds(tph_poisson_context *ctx,
-  const tph_poisson_real *sample,
-  ptrdiff_t *min_grid_index,
-  ptrdiff_t *max_grid_index)
+static tph_poisson_tile_halo *tph_poisson_tiler_cache_evict(tph_poisson_tiler_internal *internal)
 {
-#ifdef TPH_POISSON_GRID_CLAMP
-#error "TPH_POISSON_GRID_CLAMP already defined!"
-#endif
-  /* clang-format off */
-#define TPH_POISSON_GRID_CLAMP(grid_index, grid_size) \
-  if ((grid_index) < 0) {                             \
-    (grid_index) = 0;                                 \
-  } else if ((grid_index) >= (grid_size)) {           \
-    (grid_index) = (grid_size) - 1;                   \
-  }
-  /* clang-format on */
-
-  tph_poisson_real si = 0;
-  for (int32_t i = 0; i < ctx->ndims; ++i) {
-    TPH_POISSON_ASSERT(ctx->grid_size[i] > 0);
-    si = sample[i] - ctx->bounds_min[i];
-    min_grid_index[i] = (ptrdiff_t)TPH_POISSON_FLOOR((si - ctx->radius) * ctx->grid_dx_rcp);
-    max_grid_index[i] = (ptrdiff_t)TPH_POISSON_FLOOR((si + ctx->radius) * ctx->grid_dx_rcp);
-    TPH_POISSON_GRID_CLAMP(min_grid_index[i], ctx->grid_size[i]);
-    TPH_POISSON_GRID_CLAMP(max_grid_index[i], ctx->grid_size[i]);
+  tph_poisson_tile_halo *lru = &internal->cache[0];
+  for (ptrdiff_t k = 1; k < internal->cache_size; ++k) {
+    if (internal->cache[k].last_used < lru->last_used) { lru = &internal->cache[k]; }
   }
-#undef TPH_POISSON_GRID_CLAMP
+  lru->last_used = 0;
+  lru->samples.end = lru->samples.begin;
+  return lru;
 }
 
 /**
- * @brief Returns true if there exists another sample within the radius used to
- * construct the grid; otherwise false.
- * @param ctx                 Context.
- * @param sample              Input sample position.
- * @param active_sample_index Index of the existing sample that 'spawned' the sample tested here.
- * @param min_grid_index      Minimum grid index.
- * @param max_grid_index      Maximum grid index.
+ * @brief Marks an entry returned by tph_poisson_tiler_cache_evict as holding the halo of a tile.
+ * @param internal Tiler internal data.
+ * @param entry    Cache entry, holding the samples near the border of the tile.
+ * @param tile     Tile coordinates.
+ * @param ndims    Number of dimensions.
  */
-static bool tph_poisson_existing_sample_within_radius(tph_poisson_context *ctx,
-  const tph_poisson_vec *samples,
-  const tph_poisson_real *sample,
-  const ptrdiff_t active_sample_index,
-  const ptrdiff_t *min_grid_index,
-  const ptrdiff_t *max_grid_index)
+static void tph_poisson_tiler_cache_insert(tph_poisson_tiler_internal *internal,
+  tph_poisson_tile_halo *entry,
+  const int64_t *tile,
+  const int32_t ndims)
 {
-  const tph_poisson_real r_sqr = ctx->radius * ctx->radius;
-  tph_poisson_real di = 0;
-  tph_poisson_real d_sqr = -1;
-  const tph_poisson_real *cell_sample = NULL;
-  int32_t i = -1;
-  ptrdiff_t k = -1;
-  bool test_cell = false;
-  const int32_t ndims = ctx->ndims;
-  TPH_POISSON_MEMCPY(
-    ctx->grid_index, min_grid_index, (size_t)(ndims * (ptrdiff_t)sizeof(ptrdiff_t)));
-  do {
-    /* Compute linear grid index. */
-    TPH_POISSON_ASSERT((0 <= ctx->grid_index[0]) & (ctx->grid_index[0] < ctx->grid_size[0]));
-    k = ctx->grid_index[0];
-    for (i = 1; i < ndims; ++i) {
-      /* Not checking for overflow! */
-      TPH_POISSON_ASSERT((0 <= ctx->grid_index[i]) & (ctx->grid_index[i] < ctx->grid_size[i]));
-      k += ctx->grid_index[i] * ctx->grid_stride[i];
-    }
-
-    test_cell = (ctx->grid_cells[k] != 0xFFFFFFFF);
-    test_cell &= (ctx->grid_cells[k] != (uint32_t)active_sample_index);
-    if (test_cell) {
-      /* Compute (squared) distance to the existing sample and then check if the existing sample is
-       * closer than (squared) radius to the provided sample. */
-      cell_sample =
-        (const tph_poisson_real *)samples->begin + (ptrdiff_t)ctx->grid_cells[k] * ndims;
-      di = sample[0] - cell_sample[0];
-      d_sqr = di * di;
-      for (i = 1; i < ndims; ++i) {
-        di = sample[i] - cell_sample[i];
-        d_sqr += di * di;
-      }
-      if (d_sqr < r_sqr) { return true; }
-    }
-
-    /* Iterate over grid index range. Enumerate every grid index between min_grid_index and
-     * max_grid_index (inclusive) exactly once. Assumes that min_index is element-wise less than or
-     * equal to max_index. */
-    for (i = 0; i < ndims; ++i) {
-      TPH_POISSON_ASSERT(min_grid_index[i] <= max_grid_index[i]);
-      ctx->grid_index[i]++;
-      if (ctx->grid_index[i] <= max_grid_index[i]) { break; }
-      ctx->grid_index[i] = min_grid_index[i];
-    }
-    /* If the above loop ran to completion, without triggering the break, the grid_index has been
-     * set to its original value (min_grid_index). Since this was the starting value for grid_index
-     * we exit the outer loop when this happens. */
-  } while (i != ndims);
-
-  /* No existing sample was found to be closer to the provided sample than the radius. */
-  return false;
+  TPH_POISSON_MEMCPY(entry->tile, tile, (size_t)ndims * sizeof(int64_t));
+  entry->last_used = ++internal->cache_clock;
 }
 
 /**
- * @brief Generate a random sample within the given bounds (in context).
- * @param ctx    Context.
- * @param sample Output sample.
+ * @brief Returns the halo of a tile, from the cache if possible, otherwise the tile is sampled and
+ * its halo is added to the cache.
+ * @param internal Tiler internal data.
+ * @param tile     Tile coordinates.
+ * @param ndims    Number of dimensions.
+ * @param halo     Set to the cache entry holding the halo.
+ * @return TPH_POISSON_SUCCESS, or a non-zero error code.
  */
-static void tph_poisson_rand_sample(tph_poisson_context *ctx, tph_poisson_real *sample)
+static int tph_poisson_tiler_halo(tph_poisson_tiler_internal *internal,
+  const int64_t *tile,
+  const int32_t ndims,
+  tph_poisson_tile_halo **halo)
 {
-  int32_t i = 0;
-  for (; i < ctx->ndims; ++i) {
-    TPH_POISSON_ASSERT(ctx->bounds_max[i] > ctx->bounds_min[i]);
-    sample[i] =
-      ctx->bounds_min[i]
-      + (tph_poisson_real)(tph_poisson_to_double(tph_poisson_xoshiro256p_next(&ctx->prng_state)))
-          * (ctx->bounds_max[i] - ctx->bounds_min[i]);
-    /* Clamp to avoid numerical issues. */
-    /* clang-format off */
-    sample[i] = sample[i] < ctx->bounds_min[i] ? ctx->bounds_min[i] 
-      : (ctx->bounds_max[i] < sample[i] ? ctx->bounds_max[i] : sample[i]);
-    /* clang-format on */
-  }
+  *halo = tph_poisson_tiler_cache_find(internal, tile, ndims);
+  if (*halo != NULL) { return TPH_POISSON_SUCCESS; }
+  tph_poisson_tile_halo *entry = tph_poisson_tiler_cache_evict(internal);
+  const int ret = tph_poisson_tiler_sample(internal, tile, ndims, NULL, &entry->samples);
+  if (ret != TPH_POISSON_SUCCESS) { return ret; }
+  tph_poisson_tiler_cache_insert(internal, entry, tile, ndims);
+  *halo = entry;
+  return TPH_POISSON_SUCCESS;
 }
 
-int tph_poisson_create(const tph_poisson_args *args,
+int tph_poisson_tiler_create(const tph_poisson_args *args,
+  const ptrdiff_t cache_size,
   const tph_poisson_allocator *alloc,
-  tph_poisson_sampling *sampling)
+  tph_poisson_tiler *tiler)
 {
-  /* Allocator must provide all functions, allocator context is optional (may be null). */
-  if (sampling == NULL) { return TPH_POISSON_INVALID_ARGS; }
-  if (alloc != NULL && ((int)(alloc->malloc == NULL) | (int)(alloc->free == NULL)) == 1) {
+  if (tiler == NULL || args == NULL || cache_size < 0) { return TPH_POISSON_INVALID_ARGS; }
+  if (!(args->radius > 0) || args->ndims <= 0 || args->output_layout != TPH_POISSON_LAYOUT_AOS) {
     return TPH_POISSON_INVALID_ARGS;
   }
-
-  /* Allocate internal data. */
-  if (sampling->internal != NULL) { tph_poisson_destroy(sampling); }
-  sampling->internal = tph_poisson_alloc_internal(alloc);
-  if (sampling->internal == NULL) { return TPH_POISSON_BAD_ALLOC; }
-  tph_poisson_sampling_internal *internal = sampling->internal;
-
-  /* Initialize context. Validates arguments and allocates buffers. */
-  tph_poisson_context ctx;
-  TPH_POISSON_MEMSET(&ctx, 0, sizeof(tph_poisson_context));
-  int ret = tph_poisson_context_init(&internal->alloc, args, &ctx);
-  if (ret != TPH_POISSON_SUCCESS) {
-    /* No need to destroy context here. */
-    tph_poisson_destroy(sampling);
-    return ret;
+  if (alloc != NULL && !tph_poisson_alloc_valid(alloc)) { return TPH_POISSON_INVALID_ARGS; }
+
+  /* Same tile size as tph_poisson_create_parallel. Since tiles are larger than the radius, only
+   * samples of adjacent tiles may be too close to each other. */
+  const tph_poisson_real halo = (tph_poisson_real)tph_poisson_annulus_outer(args) * args->radius;
+  const tph_poisson_real tile_size =
+    args->tile_size >= 0 && args->tile_size <= 0 ? 8 * halo : args->tile_size;
+  if (!(tile_size >= halo)) { return TPH_POISSON_INVALID_ARGS; }
+
+  /* Internal data, followed by the cache entries, their tile coordinates and scratch arrays. */
+  const int32_t ndims = args->ndims;
+  const ptrdiff_t nentries = cache_size > 0 ? cache_size : TPH_POISSON_TILE_CACHE_SIZE;
+  const ptrdiff_t entry_size =
+    (ptrdiff_t)sizeof(tph_poisson_tile_halo) + ndims * (ptrdiff_t)sizeof(int64_t);
+  if (nentries > (PTRDIFF_MAX / 2) / entry_size) { return TPH_POISSON_BAD_ALLOC; }
+  if (tiler->internal != NULL) { tph_poisson_tiler_destroy(tiler); }
+  tph_poisson_allocator internal_alloc;
+  tph_poisson_alloc_copy(alloc, &internal_alloc);
+  const ptrdiff_t alignment = (ptrdiff_t)alignof(tph_poisson_tiler_internal);
+  const ptrdiff_t mem_size =
+    (ptrdiff_t)sizeof(tph_poisson_tiler_internal) + nentries * entry_size
+    + ndims * (ptrdiff_t)(sizeof(int64_t) + 2 * sizeof(tph_poisson_real))
+    + tph_poisson_alloc_slack(&internal_alloc, alignment);
+  void *mem = tph_poisson_mem_alloc(
+    &internal_alloc, mem_size, alignment, TPH_POISSON_ALLOC_OTHER | TPH_POISSON_ALLOC_ZEROED);
+  if (mem == NULL) { return TPH_POISSON_BAD_ALLOC; }
+  tph_poisson_tiler_internal *internal =
+    (tph_poisson_tiler_internal *)tph_poisson_align(mem, (size_t)alignment);
+  internal->alloc = internal_alloc;
+  internal->mem = mem;
+  internal->mem_size = mem_size;
+  internal->cache = (tph_poisson_tile_halo *)(internal + 1);
+  internal->cache_size = nentries;
+  int64_t *cache_tiles = (int64_t *)(internal->cache + nentries);
+  for (ptrdiff_t k = 0; k < nentries; ++k) { internal->cache[k].tile = cache_tiles + k * ndims; }
+  internal->neighbor = cache_tiles + nentries * ndims;
+  internal->origin = (tph_poisson_real *)(internal->neighbor + ndims);
+  internal->sample = internal->origin + ndims;
+  internal->seed = args->seed;
+  internal->radius = args->radius;
+  internal->tile_size = tile_size;
+  internal->border = args->radius + args->radius / 64;
+  tiler->internal = internal;
+
+  /* All tiles are sampled with the same bounds, relative to the tile origin. The scratch arrays
+   * hold the bounds until the sampler has been created. */
+  tph_poisson_args tile_args = *args;
+  for (int32_t i = 0; i < ndims; ++i) {
+    internal->origin[i] = 0;
+    internal->sample[i] = tile_size;
   }
-
-  /* Heuristically reserve some memory for samples to avoid reallocations while
-   * growing the buffer. Estimate that 25% of the grid cells will end up
-   * containing a sample, which is a fairly conservative guess. Prefering not
-   * to over-allocate up front here, at the cost of having to reallocate later. */
-  ret = tph_poisson_vec_reserve(&internal->samples,
-    &internal->alloc,
-    (ctx.grid_linear_size / 4) * ((ptrdiff_t)sizeof(tph_poisson_real) * ctx.ndims),
-    (ptrdiff_t)alignof(tph_poisson_real));
+  tile_args.bounds_min = internal->origin;
+  tile_args.bounds_max = internal->sample;
+  const int ret = tph_poisson_sampler_create(&tile_args, &internal->alloc, &internal->sampler);
   if (ret != TPH_POISSON_SUCCESS) {
-    tph_poisson_context_destroy(&ctx, &internal->alloc);
-    tph_poisson_destroy(sampling);
+    tph_poisson_tiler_destroy(tiler);
     return ret;
   }
 
-  /* Reserve memory for active indices, could use some analysis to find a
-   * better estimate here... */
-  ret = tph_poisson_vec_reserve(&ctx.active_indices,
-    &internal->alloc,
-    100 * (ptrdiff_t)sizeof(ptrdiff_t),
-    (ptrdiff_t)alignof(ptrdiff_t));
-  if (ret != TPH_POISSON_SUCCESS) {
-    tph_poisson_context_destroy(&ctx, &internal->alloc);
-    tph_poisson_destroy(sampling);
-    return ret;
+  tiler->ndims = ndims;
+  tiler->nsamples = 0;
+  tiler->tile_size = tile_size;
+  return TPH_POISSON_SUCCESS;
+}
+
+int tph_poisson_tiler_run(tph_poisson_tiler *tiler, const int64_t *tile)
+{
+  if (tiler == NULL || tiler->internal == NULL || tile == NULL) { return TPH_POISSON_INVALID_ARGS; }
+  tph_poisson_tiler_internal *internal = tiler->internal;
+  const int32_t ndims = tiler->ndims;
+  tiler->nsamples = 0;
+  for (int32_t i = 0; i < ndims; ++i) {
+    /* Adjacent tiles must have valid coordinates. */
+    if (tile[i] == INT64_MIN || tile[i] == INT64_MAX) { return TPH_POISSON_INVALID_ARGS; }
   }
 
-  /* Add first sample randomly within bounds. No need to check (non-existing) neighbors. */
-  tph_poisson_rand_sample(&ctx, ctx.sample);
-  ret = tph_poisson_add_sample(&ctx, internal, ctx.sample);
-  TPH_POISSON_ASSERT(ret == TPH_POISSON_SUCCESS);
-  (void)ret;
+  /* Sample the tile on its own. Its halo is cached as well, adjacent tiles are likely to be
+   * sampled soon. */
+  internal->samples.end = internal->samples.begin;
+  tph_poisson_tile_halo *entry = tph_poisson_tiler_cache_find(internal, tile, ndims);
+  entry = entry == NULL ? tph_poisson_tiler_cache_evict(internal) : NULL;
+  int ret = tph_poisson_tiler_sample(
+    internal, tile, ndims, &internal->samples, entry != NULL ? &entry->samples : NULL);
+  if (ret != TPH_POISSON_SUCCESS) { return ret; }
+  if (entry != NULL) { tph_poisson_tiler_cache_insert(internal, entry, tile, ndims); }
 
-  TPH_POISSON_ASSERT(tph_poisson_vec_size(&ctx.active_indices) / (ptrdiff_t)sizeof(ptrdiff_t) == 1);
-  ptrdiff_t active_index_count = 1;
-  ptrdiff_t rand_index = -1;
-  ptrdiff_t active_sample_index = -1;
-  const tph_poisson_real *active_sample = NULL;
-  uint32_t attempt_count = 0;
-  while (active_index_count > 0) {
-    /* Randomly choose an active sample. A sample is considered active until failed attempts
-     * have been made to generate a new sample within its annulus. */
-    rand_index =
-      (ptrdiff_t)(tph_poisson_xoshiro256p_next(&ctx.prng_state) % (uint64_t)active_index_count);
-    active_sample_index = *((const ptrdiff_t *)ctx.active_indices.begin + rand_index);
-    active_sample =
-      (const tph_poisson_real *)internal->samples.begin + active_sample_index * ctx.ndims;
-    attempt_count = 0;
-    while (attempt_count < ctx.max_sample_attempts) {
-      /* Randomly create a candidate sample inside the active sample's annulus. */
-      tph_poisson_rand_annulus_sample(&ctx, active_sample, ctx.sample);
-      /* Check if candidate sample is within bounds. */
-      if (tph_poisson_inside(ctx.sample, ctx.bounds_min, ctx.bounds_max, ctx.ndims)) {
-        tph_poisson_grid_index_bounds(&ctx, ctx.sample, ctx.min_grid_index, ctx.max_grid_index);
-        if (!tph_poisson_existing_sample_within_radius(&ctx,
-              &internal->samples,
-              ctx.sample,
-              active_sample_index,
-              ctx.min_grid_index,
-              ctx.max_grid_index)) {
-          /* No existing samples where found to be too close to the
-           * candidate sample, no further attempts necessary. */
-          ret = tph_poisson_add_sample(&ctx, internal, ctx.sample);
-          if (ret != TPH_POISSON_SUCCESS) {
-            tph_poisson_context_destroy(&ctx, &internal->alloc);
-            tph_poisson_destroy(sampling);
-            return ret;
+  const ptrdiff_t sample_size = (ptrdiff_t)sizeof(tph_poisson_real) * ndims;
+  TPH_POISSON_ASSERT(tph_poisson_vec_size(&internal->samples) % sample_size == 0);
+  const ptrdiff_t nsamples = tph_poisson_vec_size(&internal->samples) / sample_size;
+  if (nsamples == 0) { return TPH_POISSON_SUCCESS; }
+  internal->dropped.end = internal->dropped.begin;
+  ret = tph_poisson_vec_reserve(
+    &internal->dropped, &internal->alloc, nsamples, /*alignment=*/1, TPH_POISSON_ALLOC_OTHER);
+  if (ret != TPH_POISSON_SUCCESS) { return ret; }
+  uint8_t *dropped = (uint8_t *)internal->dropped.begin;
+  TPH_POISSON_MEMSET(dropped, 0, (size_t)nsamples);
+
+  /* Drop samples that are too close to the samples of higher ranked adjacent tiles, before those
+   * tiles drop any of their own samples. The rule is the same for both tiles sharing a seam, so a
+   * sample is kept regardless of which of them is sampled first. Adjacent tiles have coordinates
+   * in [tile - 1, tile + 1] along each axis. */
+  const tph_poisson_real *samples = (const tph_poisson_real *)internal->samples.begin;
+  const double r2 = (double)internal->radius * (double)internal->radius;
+  int64_t *neighbor = internal->neighbor;
+  for (int32_t i = 0; i < ndims; ++i) { neighbor[i] = tile[i] - 1; }
+  bool more = true;
+  while (more) {
+    bool adjacent = false;
+    for (int32_t i = 0; i < ndims; ++i) { adjacent = adjacent || neighbor[i] != tile[i]; }
+    if (adjacent && tph_poisson_tile_outranks(internal->seed, neighbor, tile, ndims)) {
+      tph_poisson_tile_halo *halo = NULL;
+      ret = tph_poisson_tiler_halo(internal, neighbor, ndims, &halo);
+      if (ret != TPH_POISSON_SUCCESS) { return ret; }
+      const tph_poisson_real *halo_samples = (const tph_poisson_real *)halo->samples.begin;
+      const ptrdiff_t halo_nsamples = tph_poisson_vec_size(&halo->samples) / sample_size;
+      for (ptrdiff_t j = 0; j < nsamples; ++j) {
+        if (dropped[j] != 0) { continue; }
+        const tph_poisson_real *p = samples + j * ndims;
+
+        /* Only samples near the border shared with the adjacent tile can be too close. */
+        bool near_border = true;
+        for (int32_t i = 0; i < ndims; ++i) {
+          const tph_poisson_real t = p[i] - tph_poisson_tile_origin(internal->tile_size, tile[i]);
+          if (neighbor[i] < tile[i]) { near_border = near_border && t < internal->border; }
+          if (neighbor[i] > tile[i]) {
+            near_border = near_border && t > internal->tile_size - internal->border;
+          }
+        }
+        for (ptrdiff_t k = 0; near_border && k < halo_nsamples; ++k) {
+          const tph_poisson_real *q = halo_samples + k * ndims;
+          double d2 = 0;
+          for (int32_t i = 0; i < ndims; ++i) {
+            const double d = (double)p[i] - (double)q[i];
+            d2 += d * d;
+          }
+          if (!(d2 > r2)) {
+            dropped[j] = 1;
+            break;
           }
-          break;
         }
-        /* else: The candidate sample is too close to an existing sample. */
       }
-      /* else: The candidate sample is out-of-bounds. */
-      ++attempt_count;
     }
 
-    if (attempt_count == args->max_sample_attempts) {
-      /* No valid sample was found on the disk of the active sample after
-       * maximum number of attempts, remove it from the active list. */
-      tph_poisson_vec_erase_swap(&ctx.active_indices,
-        rand_index * (ptrdiff_t)sizeof(ptrdiff_t),
-        (ptrdiff_t)sizeof(ptrdiff_t));
+    /* Next adjacent tile. */
+    more = false;
+    for (int32_t i = 0; i < ndims; ++i) {
+      if (++neighbor[i] <= tile[i] + 1) {
+        more = true;
+        break;
+      }
+      neighbor[i] = tile[i] - 1;
     }
-    active_index_count = tph_poisson_vec_size(&ctx.active_indices) / (ptrdiff_t)sizeof(ptrdiff_t);
   }
 
-  ret = tph_poisson_vec_shrink_to_fit(
-    &internal->samples, &internal->alloc, (ptrdiff_t)alignof(tph_poisson_real));
-  if (ret != TPH_POISSON_SUCCESS) {
-    tph_poisson_context_destroy(&ctx, &internal->alloc);
-    tph_poisson_destroy(sampling);
-    return ret;
+  /* Remove dropped samples, keeping the order of the others. */
+  tph_poisson_real *dst = (tph_poisson_real *)internal->samples.begin;
+  ptrdiff_t n = 0;
+  for (ptrdiff_t j = 0; j < nsamples; ++j) {
+    if (dropped[j] != 0) { continue; }
+    if (n != j) { TPH_POISSON_MEMCPY(dst + n * ndims, dst + j * ndims, (size_t)sample_size); }
+    ++n;
   }
-
-  const ptrdiff_t sample_size = (ptrdiff_t)sizeof(tph_poisson_real) * ctx.ndims;
-  TPH_POISSON_ASSERT(tph_poisson_vec_size(&internal->samples) % sample_size == 0);
-  sampling->ndims = ctx.ndims;
-  sampling->nsamples = tph_poisson_vec_size(&internal->samples) / sample_size;
-
-  tph_poisson_context_destroy(&ctx, &internal->alloc);
-
+  internal->samples.end = (void *)((intptr_t)internal->samples.begin + n * sample_size);
+  tiler->nsamples = n;
   return TPH_POISSON_SUCCESS;
 }
 
-void tph_poisson_destroy(tph_poisson_sampling *sampling)
+void tph_poisson_tiler_destroy(tph_poisson_tiler *tiler)
 {
-  if (sampling != NULL) {
-    tph_poisson_sampling_internal *internal = sampling->internal;
+  if (tiler != NULL) {
+    tph_poisson_tiler_internal *internal = tiler->internal;
     if (internal != NULL) {
-      tph_poisson_vec_free(&internal->samples, &internal->alloc);
-      tph_poisson_free_fn free_fn = internal->alloc.free;
-      void *alloc_ctx = internal->alloc.ctx;
-      free_fn(internal->mem, internal->mem_size, alloc_ctx);
+      tph_poisson_allocator alloc = internal->alloc;
+      tph_poisson_sampler_destroy(&internal->sampler);
+      tph_poisson_vec_free(&internal->samples, &alloc, TPH_POISSON_ALLOC_SAMPLES);
+      tph_poisson_vec_free(&internal->dropped, &alloc, TPH_POISSON_ALLOC_OTHER);
+      for (ptrdiff_t k = 0; k < internal->cache_size; ++k) {
+        tph_poisson_vec_free(&internal->cache[k].samples, &alloc, TPH_POISSON_ALLOC_SAMPLES);
+      }
+      tph_poisson_mem_free(&alloc, internal->mem, internal->mem_size, TPH_POISSON_ALLOC_OTHER);
     }
     /* Protects from destroy being called more than once causing a double-free error. */
-    TPH_POISSON_MEMSET(sampling, 0, sizeof(tph_poisson_sampling));
+    TPH_POISSON_MEMSET(tiler, 0, sizeof(tph_poisson_tiler));
   }
 }
 
-const tph_poisson_real *tph_poisson_get_samples(const tph_poisson_sampling *sampling)
+const tph_poisson_real *tph_poisson_tiler_get_samples(const tph_poisson_tiler *tiler)
 {
-  /* Make sure that a 'destroyed' sampling does not return any samples. */
-  if (sampling != NULL && sampling->internal != NULL) {
-    return (const tph_poisson_real *)sampling->internal->samples.begin;
+  if (tiler != NULL && tiler->internal != NULL && tiler->nsamples > 0) {
+    return (const tph_poisson_real *)tiler->internal->samples.begin;
   }
   return NULL;
 }
 
 /* Clean up internal macros. */
 #undef TPH_POISSON_INLINE
+#undef TPH_POISSON_FORCE_INLINE
 #undef TPH_POISSON_ASSERT
 #undef TPH_POISSON_MEMCPY
 #undef TPH_POISSON_MEMSET
+#undef TPH_POISSON_MEMMOVE
+#undef TPH_POISSON_STENCIL_MAX_SIZE
+#undef TPH_POISSON_GRID_MAX_DENSE_SIZE
+#undef TPH_POISSON_CANDIDATE_BATCH_SIZE
+#undef TPH_POISSON_STREAM_CHUNK_SIZE
+#undef TPH_POISSON_TILE_CACHE_SIZE
+#undef TPH_POISSON_STEP_IDLE
+#undef TPH_POISSON_STEP_RUNNING
+#undef TPH_POISSON_STEP_DONE
+#undef TPH_POISSON_GRID_PAGE_BITS
+#undef TPH_POISSON_SOA_ALIGNMENT
+#undef TPH_POISSON_MAX_THREADS
+#undef TPH_POISSON_ATOMIC_LOAD_U64
+#undef TPH_POISSON_ATOMIC_OR_U64
+#undef TPH_POISSON_KERNEL_MAX_NDIMS
+#undef TPH_POISSON_PRNG_LANES
+#undef TPH_POISSON_SIMD_AVX
+#undef TPH_POISSON_SIMD_SSE2
+#undef TPH_POISSON_SIMD_NEON
+#undef TPH_POISSON_SIMD_BYTES
+#undef TPH_POISSON_SIMD_LANES
+#undef TPH_POISSON_SIMD_MAX_LANES
+#undef TPH_POISSON_REAL_IS_FLOAT
+#undef TPH_POISSON_REAL_IS_DOUBLE
+#undef TPH_POISSON_TWO_PI
+#undef TPH_POISSON_DSQRT
+#undef TPH_POISSON_DCOS
+#undef TPH_POISSON_DSIN
+#undef TPH_POISSON_DLOG
+#undef TPH_POISSON_DPOW
 #undef TPH_POISSON_MALLOC
 #undef TPH_POISSON_FREE
+#undef TPH_POISSON_REALLOC
+#undef TPH_POISSON_CALLOC
 
 #endif /* TPH_POISSON_IMPLEMENTATION */
 
@@ -1194,6 +5336,8 @@ ABOUT:
 
 HISTORY:
 
+    0.5.0    2026-10-16 - Optional realloc, calloc and aligned allocator functions, allocators
+                          must be zero-initialized.
     0.4.0    2024-11-13 - C interface and implementation, new build system.
     v0.3     2020-06-30 - C++ interface and implementation.
 
@@ -1240,10 +5384,48 @@ USAGE:
                            const tph_poisson_allocator *alloc,
                            tph_poisson_sampling *sampling);
 
+    int tph_poisson_create_into(const tph_poisson_args *args,
+                                const tph_poisson_allocator *alloc,
+                                tph_poisson_real *samples,
+                                ptrdiff_t max_samples,
+                                ptrdiff_t *nsamples);
+
+    int tph_poisson_max_samples(const tph_poisson_args *args, ptrdiff_t *max_samples);
+
+    int tph_poisson_estimate_samples(const tph_poisson_args *args, ptrdiff_t *nsamples);
+
+    int tph_poisson_query_memory(const tph_poisson_args *args,
+                                 ptrdiff_t max_samples,
+                                 ptrdiff_t *nbytes);
+
+    int tph_poisson_create_in_arena(const tph_poisson_args *args,
+                                    void *arena,
+                                    ptrdiff_t arena_size,
+                                    ptrdiff_t max_samples,
+                                    tph_poisson_sampling *sampling);
+
+    int tph_poisson_create_parallel(const tph_poisson_args *args,
+                                    const tph_poisson_executor *executor,
+                                    const tph_poisson_allocator *alloc,
+                                    tph_poisson_sampling *sampling);
+
     void tph_poisson_destroy(tph_poisson_sampling *sampling);
 
     const tph_poisson_real *tph_poisson_get_samples(const tph_poisson_sampling *sampling);
 
+    Many samplings with the same arguments and different seeds are created more efficiently
+    using a sampler, which keeps its memory between runs:
+
+    int tph_poisson_sampler_create(const tph_poisson_args *args,
+                                   const tph_poisson_allocator *alloc,
+                                   tph_poisson_sampler *sampler);
+
+    int tph_poisson_sampler_run(tph_poisson_sampler *sampler, uint64_t seed);
+
+    void tph_poisson_sampler_destroy(tph_poisson_sampler *sampler);
+
+    const tph_poisson_real *tph_poisson_sampler_get_samples(const tph_poisson_sampler *sampler);
+
     Example usage:
 
     #include <assert.h>
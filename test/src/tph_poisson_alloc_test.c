@@ -1,3 +1,4 @@
+#include <stdbool.h> /* bool */
 #include <stdint.h> /* UINT64_C, etc */
 #include <stdio.h> /* printf */
 #include <stdlib.h> /* malloc, free, EXIT_SUCCESS */
@@ -12,6 +13,8 @@ typedef struct bad_alloc_ctx_
 {
   int num_mallocs;
   int max_mallocs;
+  int num_reallocs;
+  int num_callocs;
 } bad_alloc_ctx;
 
 static void *bad_alloc_malloc(ptrdiff_t size, void *ctx)
@@ -31,7 +34,41 @@ static void bad_alloc_free(void *ptr, ptrdiff_t size, void *ctx)
   free(ptr);
 }
 
-static void test_bad_alloc(void)
+/* Reallocations count towards the same limit as allocations. */
+static void *bad_alloc_realloc(void *ptr, ptrdiff_t size, ptrdiff_t new_size, void *ctx)
+{
+  (void)size;
+  bad_alloc_ctx *a_ctx = (bad_alloc_ctx *)ctx;
+  if (a_ctx->num_mallocs >= a_ctx->max_mallocs) { return NULL; }
+  void *new_ptr = realloc(ptr, (size_t)new_size);
+  ++a_ctx->num_mallocs;
+  ++a_ctx->num_reallocs;
+  return new_ptr;
+}
+
+/* Zeroed allocations count towards the same limit as allocations. */
+static void *bad_alloc_calloc(ptrdiff_t size, void *ctx)
+{
+  bad_alloc_ctx *a_ctx = (bad_alloc_ctx *)ctx;
+  if ((size == 0) | (a_ctx->num_mallocs >= a_ctx->max_mallocs)) { return NULL; }
+  void *ptr = calloc(1, (size_t)size);
+  ++a_ctx->num_mallocs;
+  ++a_ctx->num_callocs;
+  return ptr;
+}
+
+static int create(const tph_poisson_args *args,
+  const tph_poisson_allocator *alloc,
+  const bool parallel,
+  tph_poisson_sampling *sampling)
+{
+  return parallel ? tph_poisson_create_parallel(args, /*executor=*/NULL, alloc, sampling)
+                  : tph_poisson_create(args, alloc, sampling);
+}
+
+static void test_bad_alloc(const ptrdiff_t grid_max_dense_size,
+  const bool parallel,
+  const bool optional_fns)
 {
   /* The idea here is to use a custom allocator that fails (i.e. malloc returns null)
    * after a controllable number of allocations. This way it becomes possible
@@ -53,14 +90,16 @@ static void test_bad_alloc(void)
     .radius = (tph_poisson_real)1,
     .ndims = INT32_C(2),
     .max_sample_attempts = UINT32_C(30),
-    .seed = UINT64_C(1981) };
+    .seed = UINT64_C(1981),
+    .grid_max_dense_size = grid_max_dense_size,
+    .tile_size = (tph_poisson_real)4 };
 
   /* Initialize empty sampling. */
   tph_poisson_sampling sampling;
   memset(&sampling, 0, sizeof(tph_poisson_sampling));
 
   /* Verify arguments using default allocator. Reset sampling. */
-  REQUIRE(tph_poisson_create(&args, /*alloc=*/NULL, &sampling) == TPH_POISSON_SUCCESS);
+  REQUIRE(create(&args, /*alloc=*/NULL, parallel, &sampling) == TPH_POISSON_SUCCESS);
   tph_poisson_destroy(&sampling);
 
   int ret = TPH_POISSON_BAD_ALLOC;
@@ -69,20 +108,158 @@ static void test_bad_alloc(void)
     /* Use a custom allocator that will fail after 'i' allocations. Note that
      * when 'i' == 0 the first allocation fails. */
     bad_alloc_ctx alloc_ctx = { .num_mallocs = 0, .max_mallocs = i };
+    tph_poisson_allocator alloc = { .malloc = bad_alloc_malloc,
+      .free = bad_alloc_free,
+      .ctx = &alloc_ctx,
+      .realloc = optional_fns ? bad_alloc_realloc : NULL,
+      .calloc = optional_fns ? bad_alloc_calloc : NULL };
+
+    /* Try to populate sampling with points. */
+    ret = create(&args, &alloc, parallel, &sampling);
+    REQUIRE(ret == TPH_POISSON_BAD_ALLOC || ret == TPH_POISSON_SUCCESS);
+    REQUIRE(ret != TPH_POISSON_SUCCESS || !optional_fns
+            || (alloc_ctx.num_reallocs > 0 && alloc_ctx.num_callocs > 0));
+    ++i;
+  }
+
+  /* Free memory associated with sampling. */
+  tph_poisson_destroy(&sampling);
+}
+
+static void test_sampler_bad_alloc(const ptrdiff_t grid_max_dense_size)
+{
+  /* Same idea as test_bad_alloc. Additionally, a sampler whose run failed must give the
+   * expected samples when run again once allocations succeed. */
+
+  /* Configure arguments. */
+  const tph_poisson_real bounds_min[2] = { (tph_poisson_real)-10, (tph_poisson_real)-10 };
+  const tph_poisson_real bounds_max[2] = { (tph_poisson_real)10, (tph_poisson_real)10 };
+  const tph_poisson_args args = { .bounds_min = bounds_min,
+    .bounds_max = bounds_max,
+    .radius = (tph_poisson_real)1,
+    .ndims = INT32_C(2),
+    .max_sample_attempts = UINT32_C(30),
+    .seed = UINT64_C(1981),
+    .grid_max_dense_size = grid_max_dense_size };
+
+  /* Expected samples, using default allocator. */
+  tph_poisson_sampling sampling;
+  memset(&sampling, 0, sizeof(tph_poisson_sampling));
+  REQUIRE(tph_poisson_create(&args, /*alloc=*/NULL, &sampling) == TPH_POISSON_SUCCESS);
+  const size_t samples_size =
+    (size_t)(sampling.nsamples * sampling.ndims) * sizeof(tph_poisson_real);
+
+  /* Initialize empty sampler. */
+  tph_poisson_sampler sampler;
+  memset(&sampler, 0, sizeof(tph_poisson_sampler));
+
+  int ret = TPH_POISSON_BAD_ALLOC;
+  int i = 0;
+  while (ret != TPH_POISSON_SUCCESS) {
+    /* Use a custom allocator that will fail after 'i' allocations. */
+    bad_alloc_ctx alloc_ctx = { .num_mallocs = 0, .max_mallocs = i };
     tph_poisson_allocator alloc = {
       .malloc = bad_alloc_malloc, .free = bad_alloc_free, .ctx = &alloc_ctx
     };
+    ++i;
 
-    /* Try to populate sampling with points. */
-    ret = tph_poisson_create(&args, &alloc, &sampling);
+    ret = tph_poisson_sampler_create(&args, &alloc, &sampler);
     REQUIRE(ret == TPH_POISSON_BAD_ALLOC || ret == TPH_POISSON_SUCCESS);
-    ++i;
+    if (ret != TPH_POISSON_SUCCESS) {
+      REQUIRE(sampler.internal == NULL);
+      continue;
+    }
+
+    ret = tph_poisson_sampler_run(&sampler, args.seed);
+    REQUIRE(ret == TPH_POISSON_BAD_ALLOC || ret == TPH_POISSON_SUCCESS);
+    if (ret != TPH_POISSON_SUCCESS) {
+      REQUIRE(sampler.nsamples == 0);
+      REQUIRE(tph_poisson_sampler_get_samples(&sampler) == NULL);
+
+      /* Run again, now without failing allocations. */
+      alloc_ctx.max_mallocs = INT32_MAX;
+      REQUIRE(tph_poisson_sampler_run(&sampler, args.seed) == TPH_POISSON_SUCCESS);
+    }
+    REQUIRE(sampler.nsamples == sampling.nsamples);
+    REQUIRE(memcmp(tph_poisson_sampler_get_samples(&sampler),
+              tph_poisson_get_samples(&sampling),
+              samples_size)
+            == 0);
+    tph_poisson_sampler_destroy(&sampler);
   }
 
   /* Free memory associated with sampling. */
   tph_poisson_destroy(&sampling);
 }
 
+static void test_tiler_bad_alloc(void)
+{
+  /* Same idea as test_sampler_bad_alloc. A tiler whose run failed must not keep a partially
+   * sampled tile in its cache, and must give the expected tiles once allocations succeed. */
+
+  /* Configure arguments. Bounds are not used by tilers. */
+  const tph_poisson_args args = { .radius = (tph_poisson_real)1,
+    .ndims = INT32_C(2),
+    .max_sample_attempts = UINT32_C(30),
+    .seed = UINT64_C(1981),
+    .tile_size = (tph_poisson_real)5 };
+  const int64_t tiles[4][2] = { { 0, 0 }, { 1, 0 }, { 0, 1 }, { 1, 1 } };
+
+  /* Expected samples of the last tile, using default allocator. */
+  tph_poisson_tiler tiler;
+  memset(&tiler, 0, sizeof(tph_poisson_tiler));
+  REQUIRE(tph_poisson_tiler_create(&args, /*cache_size=*/0, /*alloc=*/NULL, &tiler)
+          == TPH_POISSON_SUCCESS);
+  for (int t = 0; t < 4; ++t) {
+    REQUIRE(tph_poisson_tiler_run(&tiler, tiles[t]) == TPH_POISSON_SUCCESS);
+  }
+  const ptrdiff_t nsamples = tiler.nsamples;
+  const size_t samples_size = (size_t)(nsamples * tiler.ndims) * sizeof(tph_poisson_real);
+  tph_poisson_real *samples = (tph_poisson_real *)malloc(samples_size);
+  REQUIRE(samples != NULL);
+  memcpy(samples, tph_poisson_tiler_get_samples(&tiler), samples_size);
+  tph_poisson_tiler_destroy(&tiler);
+
+  int ret = TPH_POISSON_BAD_ALLOC;
+  int i = 0;
+  while (ret != TPH_POISSON_SUCCESS) {
+    /* Use a custom allocator that will fail after 'i' allocations. */
+    bad_alloc_ctx alloc_ctx = { .num_mallocs = 0, .max_mallocs = i };
+    tph_poisson_allocator alloc = {
+      .malloc = bad_alloc_malloc, .free = bad_alloc_free, .ctx = &alloc_ctx
+    };
+    ++i;
+
+    ret = tph_poisson_tiler_create(&args, /*cache_size=*/2, &alloc, &tiler);
+    REQUIRE(ret == TPH_POISSON_BAD_ALLOC || ret == TPH_POISSON_SUCCESS);
+    if (ret != TPH_POISSON_SUCCESS) {
+      REQUIRE(tiler.internal == NULL);
+      continue;
+    }
+
+    bool failed = false;
+    for (int t = 0; t < 4; ++t) {
+      ret = tph_poisson_tiler_run(&tiler, tiles[t]);
+      REQUIRE(ret == TPH_POISSON_BAD_ALLOC || ret == TPH_POISSON_SUCCESS);
+      if (ret != TPH_POISSON_SUCCESS) {
+        failed = true;
+        REQUIRE(tiler.nsamples == 0);
+        REQUIRE(tph_poisson_tiler_get_samples(&tiler) == NULL);
+
+        /* Continue, now without failing allocations. */
+        alloc_ctx.max_mallocs = INT32_MAX;
+        REQUIRE(tph_poisson_tiler_run(&tiler, tiles[t]) == TPH_POISSON_SUCCESS);
+      }
+    }
+    REQUIRE(tiler.nsamples == nsamples);
+    REQUIRE(memcmp(tph_poisson_tiler_get_samples(&tiler), samples, samples_size) == 0);
+    tph_poisson_tiler_destroy(&tiler);
+    ret = failed ? TPH_POISSON_BAD_ALLOC : TPH_POISSON_SUCCESS;
+  }
+
+  free(samples);
+}
+
 typedef struct destroyed_alloc_ctx_
 {
   int num_mallocs;
@@ -125,7 +302,7 @@ static void test_destroyed_alloc(void)
 
   /* Set up a simple allocator that just counts number of allocations/deallocations. */
   destroyed_alloc_ctx alloc_ctx = { .num_mallocs = 0, .num_frees = 0 };
-  tph_poisson_allocator *alloc = (tph_poisson_allocator *)malloc(sizeof(tph_poisson_allocator));
+  tph_poisson_allocator *alloc = (tph_poisson_allocator *)calloc(1, sizeof(tph_poisson_allocator));
   alloc->malloc = destroyed_alloc_malloc;
   alloc->free = destroyed_alloc_free;
   alloc->ctx = &alloc_ctx;
@@ -153,13 +330,138 @@ static void test_destroyed_alloc(void)
   REQUIRE(alloc_ctx.num_frees > 0);
 }
 
+typedef struct aligned_alloc_block_
+{
+  void *ptr;
+  ptrdiff_t size;
+  int32_t purpose;
+} aligned_alloc_block;
+
+typedef struct aligned_alloc_ctx_
+{
+  aligned_alloc_block blocks[64]; /* Live allocations. */
+  int num_blocks;
+  int num_mallocs[4]; /* Per purpose. */
+} aligned_alloc_ctx;
+
+static void *aligned_alloc_malloc(ptrdiff_t size, ptrdiff_t alignment, int32_t purpose, void *ctx)
+{
+  aligned_alloc_ctx *a_ctx = (aligned_alloc_ctx *)ctx;
+  const int32_t p = purpose & ~TPH_POISSON_ALLOC_ZEROED;
+  REQUIRE(size > 0);
+  REQUIRE(alignment > 0 && (alignment & (alignment - 1)) == 0);
+  REQUIRE(p >= TPH_POISSON_ALLOC_OTHER && p <= TPH_POISSON_ALLOC_ACTIVE);
+  REQUIRE(a_ctx->num_blocks < 64);
+
+  /* Use stricter alignment than requested for large buffers, like huge pages would. */
+  const size_t a = p == TPH_POISSON_ALLOC_OTHER ? (size_t)alignment : (size_t)64;
+  void *ptr = aligned_alloc(a, ((size_t)size + a - 1) & ~(a - 1));
+  if (ptr == NULL) { return NULL; }
+  /* Memory that need not be zeroed is filled with garbage. */
+  memset(ptr, (purpose & TPH_POISSON_ALLOC_ZEROED) != 0 ? 0 : 0xA5, (size_t)size);
+  a_ctx->blocks[a_ctx->num_blocks++] = (aligned_alloc_block){ ptr, size, p };
+  ++a_ctx->num_mallocs[p];
+  return ptr;
+}
+
+static void aligned_alloc_free(void *ptr, ptrdiff_t size, int32_t purpose, void *ctx)
+{
+  aligned_alloc_ctx *a_ctx = (aligned_alloc_ctx *)ctx;
+  REQUIRE((purpose & TPH_POISSON_ALLOC_ZEROED) == 0);
+  int i = 0;
+  while (i < a_ctx->num_blocks && a_ctx->blocks[i].ptr != ptr) { ++i; }
+  REQUIRE(i < a_ctx->num_blocks);
+  REQUIRE(a_ctx->blocks[i].size == size);
+  REQUIRE(a_ctx->blocks[i].purpose == purpose);
+  a_ctx->blocks[i] = a_ctx->blocks[--a_ctx->num_blocks];
+  free(ptr);
+}
+
+static void test_aligned_alloc(const ptrdiff_t grid_max_dense_size, const bool parallel)
+{
+  /* Only aligned functions are provided. Samplings must be the same as with the default
+   * allocator, every allocation must be freed with its size and purpose, and the grid, samples
+   * and active list must be allocated separately. */
+  const tph_poisson_real bounds_min[2] = { (tph_poisson_real)-10, (tph_poisson_real)-10 };
+  const tph_poisson_real bounds_max[2] = { (tph_poisson_real)10, (tph_poisson_real)10 };
+  const tph_poisson_args args = { .bounds_min = bounds_min,
+    .bounds_max = bounds_max,
+    .radius = (tph_poisson_real)1,
+    .ndims = INT32_C(2),
+    .max_sample_attempts = UINT32_C(30),
+    .seed = UINT64_C(1981),
+    .grid_max_dense_size = grid_max_dense_size,
+    .tile_size = (tph_poisson_real)4 };
+
+  tph_poisson_sampling expected;
+  memset(&expected, 0, sizeof(tph_poisson_sampling));
+  REQUIRE(create(&args, /*alloc=*/NULL, parallel, &expected) == TPH_POISSON_SUCCESS);
+
+  aligned_alloc_ctx alloc_ctx;
+  memset(&alloc_ctx, 0, sizeof(aligned_alloc_ctx));
+  const tph_poisson_allocator alloc = { .ctx = &alloc_ctx,
+    .aligned_malloc = aligned_alloc_malloc,
+    .aligned_free = aligned_alloc_free };
+  tph_poisson_sampling sampling;
+  memset(&sampling, 0, sizeof(tph_poisson_sampling));
+  REQUIRE(create(&args, &alloc, parallel, &sampling) == TPH_POISSON_SUCCESS);
+  REQUIRE(sampling.nsamples == expected.nsamples);
+  REQUIRE(memcmp(tph_poisson_get_samples(&sampling),
+            tph_poisson_get_samples(&expected),
+            (size_t)(sampling.nsamples * sampling.ndims) * sizeof(tph_poisson_real))
+          == 0);
+  REQUIRE(((uintptr_t)tph_poisson_get_samples(&sampling) & 63) == 0);
+  for (int32_t p = TPH_POISSON_ALLOC_OTHER; p <= TPH_POISSON_ALLOC_ACTIVE; ++p) {
+    REQUIRE(alloc_ctx.num_mallocs[p] > 0);
+  }
+  tph_poisson_destroy(&sampling);
+  REQUIRE(alloc_ctx.num_blocks == 0);
+
+  /* Aligned functions must be provided together. */
+  const tph_poisson_allocator half_alloc = { .ctx = &alloc_ctx,
+    .aligned_malloc = aligned_alloc_malloc };
+  REQUIRE(create(&args, &half_alloc, parallel, &sampling) == TPH_POISSON_INVALID_ARGS);
+
+  tph_poisson_destroy(&expected);
+}
+
 int main(int argc, char *argv[])
 {
   (void)argc;
   (void)argv;
 
   printf("test_bad_alloc...\n");
-  test_bad_alloc();
+  test_bad_alloc(/*grid_max_dense_size=*/0, /*parallel=*/false, /*optional_fns=*/false);
+
+  /* Sparse grid, pages are allocated while sampling. */
+  printf("test_bad_alloc (sparse)...\n");
+  test_bad_alloc(/*grid_max_dense_size=*/1, /*parallel=*/false, /*optional_fns=*/false);
+
+  /* Tiles allocate scratch memory and samples while sampling. */
+  printf("test_bad_alloc (parallel)...\n");
+  test_bad_alloc(/*grid_max_dense_size=*/0, /*parallel=*/true, /*optional_fns=*/false);
+
+  /* Buffers are resized in place and the grid is zeroed by the allocator, which may also fail. */
+  printf("test_bad_alloc (realloc, calloc)...\n");
+  test_bad_alloc(/*grid_max_dense_size=*/1, /*parallel=*/false, /*optional_fns=*/true);
+
+  printf("test_sampler_bad_alloc...\n");
+  test_sampler_bad_alloc(/*grid_max_dense_size=*/0);
+
+  printf("test_sampler_bad_alloc (sparse)...\n");
+  test_sampler_bad_alloc(/*grid_max_dense_size=*/1);
+
+  printf("test_tiler_bad_alloc...\n");
+  test_tiler_bad_alloc();
+
+  printf("test_aligned_alloc...\n");
+  test_aligned_alloc(/*grid_max_dense_size=*/0, /*parallel=*/false);
+
+  printf("test_aligned_alloc (sparse)...\n");
+  test_aligned_alloc(/*grid_max_dense_size=*/1, /*parallel=*/false);
+
+  printf("test_aligned_alloc (parallel)...\n");
+  test_aligned_alloc(/*grid_max_dense_size=*/0, /*parallel=*/true);
 
   printf("test_destroyed_alloc...\n");
   test_destroyed_alloc();
@@ -1,5 +1,6 @@
 #include <algorithm>// std::all_of
 #include <array>
+#include <atomic>
 #include <cinttypes>// PRIXPTR
 #include <cmath>
 #include <cstdint>// int32_t, etc
@@ -35,6 +36,94 @@ static auto make_unique_poisson() -> unique_poisson_ptr
   });
 }
 
+// Brute-force verification that all samples are within bounds and that no two samples are
+// closer than the radius. Intended for small samplings.
+static auto ValidSampling(const tph_poisson_args &args, const tph_poisson_sampling &sampling)
+  -> bool
+{
+  const tph_poisson_real *samples = tph_poisson_get_samples(&sampling);
+  if (samples == nullptr || sampling.ndims != args.ndims) { return false; }
+  const int32_t ndims = sampling.ndims;
+  const Real r_sqr = args.radius * args.radius;
+  for (ptrdiff_t j = 0; j < sampling.nsamples; ++j) {
+    const Real *sj = &samples[j * ndims];
+    for (int32_t m = 0; m < ndims; ++m) {
+      if (!(args.bounds_min[m] <= sj[m] && sj[m] <= args.bounds_max[m])) { return false; }
+    }
+    for (ptrdiff_t k = 0; k < j; ++k) {
+      const Real *sk = &samples[k * ndims];
+      Real dist_sqr = 0;
+      for (int32_t m = 0; m < ndims; ++m) { dist_sqr += (sj[m] - sk[m]) * (sj[m] - sk[m]); }
+      if (!(dist_sqr > r_sqr)) { return false; }
+    }
+  }
+  return true;
+}
+
+// Owns the bounds that the arguments point to, see make_args. Can be neither copied nor moved, so
+// that the pointers stay valid. Tests may change bound values but must not resize the bounds.
+struct TestArgs
+{
+  TestArgs(const int32_t ndims, const Real bounds_lo, const Real bounds_hi)
+    : bounds_min(static_cast<size_t>(ndims), bounds_lo),
+      bounds_max(static_cast<size_t>(ndims), bounds_hi)
+  {
+    args.ndims = ndims;
+    args.bounds_min = bounds_min.data();
+    args.bounds_max = bounds_max.data();
+    args.radius = 1;
+    args.seed = UINT64_C(1981);
+    args.max_sample_attempts = UINT32_C(30);
+  }
+  TestArgs(const TestArgs &) = delete;
+  TestArgs(TestArgs &&) = delete;
+  auto operator=(const TestArgs &) -> TestArgs & = delete;
+  auto operator=(TestArgs &&) -> TestArgs & = delete;
+  ~TestArgs() = default;
+
+  std::vector<Real> bounds_min;
+  std::vector<Real> bounds_max;
+  tph_poisson_args args = {};
+};
+
+// Arguments used by most tests: bounds [-extent, extent] along each axis, unit radius, a fixed
+// seed and 30 sample attempts. Tests set further arguments as needed.
+static auto make_args(const int32_t ndims, const Real extent) -> TestArgs
+{
+  return TestArgs(ndims, -extent, extent);
+}
+
+// Same as above, but with bounds [bounds_lo, bounds_hi] along each axis.
+static auto make_args(const int32_t ndims, const Real bounds_lo, const Real bounds_hi) -> TestArgs
+{
+  return TestArgs(ndims, bounds_lo, bounds_hi);
+}
+
+// Returns true if two samplings have bitwise identical samples.
+static auto SameSamples(const tph_poisson_sampling &a, const tph_poisson_sampling &b) -> bool
+{
+  if (a.ndims != b.ndims || a.nsamples != b.nsamples) { return false; }
+  if (a.nsamples == 0) { return true; }
+  return std::memcmp(tph_poisson_get_samples(&a),
+           tph_poisson_get_samples(&b),
+           static_cast<size_t>(a.nsamples * a.ndims) * sizeof(Real))
+         == 0;
+}
+
+// Returns true if the first nsamples samples of a sampling are bitwise identical to the given
+// samples.
+static auto SamePrefix(const tph_poisson_sampling &expected,
+  const tph_poisson_real *samples,
+  const ptrdiff_t nsamples) -> bool
+{
+  if (nsamples < 0 || nsamples > expected.nsamples) { return false; }
+  if (nsamples == 0) { return true; }
+  return std::memcmp(tph_poisson_get_samples(&expected),
+           samples,
+           static_cast<size_t>(nsamples * expected.ndims) * sizeof(Real))
+         == 0;
+}
+
 // Brute-force (with some tricks) verification that the distance between each possible
 // sample pair meets the Poisson requirement, i.e. is greater than some radius.
 static void TestRadius()
@@ -100,9 +189,11 @@ static void TestRadius()
   };
 
   constexpr tph_poisson_allocator *alloc = nullptr;
-  REQUIRE(valid_radius(/*bounds_min=*/{ -100, -100 }, /*bounds_max=*/{ 100, 100 }, alloc));
+  REQUIRE(valid_radius(/*bounds_min=*/{ -100 }, /*bounds_max=*/{ 100 }, alloc));
+  REQUIRE(valid_radius({ -100, -100 }, { 100, 100 }, alloc));
   REQUIRE(valid_radius({ -20, -20, -20 }, { 20, 20, 20 }, alloc));
   REQUIRE(valid_radius({ -10, -10, -10, -10 }, { 10, 10, 10, 10 }, alloc));
+  REQUIRE(valid_radius({ -4, -4, -4, -4, -4 }, { 4, 4, 4, 4, 4 }, alloc));
 }
 
 // Verify that all samples are within the specified bounds.
@@ -139,9 +230,11 @@ static void TestBounds()
   };
 
   constexpr tph_poisson_allocator *alloc = nullptr;
-  REQUIRE(valid_bounds(/*bounds_min=*/{ -100, -100 }, /*bounds_max=*/{ 100, 100 }, alloc));
+  REQUIRE(valid_bounds(/*bounds_min=*/{ -100 }, /*bounds_max=*/{ 100 }, alloc));
+  REQUIRE(valid_bounds({ -100, -100 }, { 100, 100 }, alloc));
   REQUIRE(valid_bounds({ -20, -20, -20 }, { 20, 20, 20 }, alloc));
   REQUIRE(valid_bounds({ -10, -10, -10, -10 }, { 10, 10, 10, 10 }, alloc));
+  REQUIRE(valid_bounds({ -4, -4, -4, -4, -4 }, { 4, 4, 4, 4, 4 }, alloc));
 }
 
 // Verify that we get a denser sampling, i.e. more samples,
@@ -223,6 +316,991 @@ static void TestVaryingSeed()
   }());
 }
 
+// Verify that all candidate methods produce valid samplings, and that the non-default methods
+// give different samplings than the default method for the same seed.
+static void TestCandidateMethods()
+{
+  constexpr tph_poisson_allocator *alloc = nullptr;
+  const auto create = [](const int32_t ndims,
+                        const int32_t method,
+                        const Real extent,
+                        const Real annulus_outer_factor = 0) {
+    TestArgs test_args = make_args(ndims, extent);
+    tph_poisson_args &args = test_args.args;
+    args.candidate_method = method;
+    args.annulus_outer_factor = annulus_outer_factor;
+    unique_poisson_ptr sampling = make_unique_poisson();
+    REQUIRE(TPH_POISSON_SUCCESS == tph_poisson_create(&args, alloc, sampling.get()));
+    REQUIRE(sampling->nsamples > 0);
+    REQUIRE(ValidSampling(args, *sampling));
+    return sampling;
+  };
+
+  const unique_poisson_ptr rejection_2d = create(2, TPH_POISSON_CANDIDATES_REJECTION, 10);
+  const unique_poisson_ptr polar_2d = create(2, TPH_POISSON_CANDIDATES_POLAR, 10);
+  const unique_poisson_ptr gaussian_2d = create(2, TPH_POISSON_CANDIDATES_GAUSSIAN, 10);
+  REQUIRE(!SameSamples(*rejection_2d, *polar_2d));
+  REQUIRE(!SameSamples(*rejection_2d, *gaussian_2d));
+
+  // Deterministic angles pack samples more densely than random candidates.
+  const unique_poisson_ptr angular_2d = create(2, TPH_POISSON_CANDIDATES_ANGULAR, 10);
+  REQUIRE(angular_2d->nsamples > rejection_2d->nsamples);
+
+  // A narrower annulus also gives denser samplings.
+  const unique_poisson_ptr narrow_2d =
+    create(2, TPH_POISSON_CANDIDATES_REJECTION, 10, static_cast<Real>(1.1));
+  REQUIRE(narrow_2d->nsamples > rejection_2d->nsamples);
+  create(2, TPH_POISSON_CANDIDATES_POLAR, 10, static_cast<Real>(1.1));
+  create(3, TPH_POISSON_CANDIDATES_GAUSSIAN, 5, static_cast<Real>(1.1));
+  create(2, TPH_POISSON_CANDIDATES_ANGULAR, 10, static_cast<Real>(1.5));
+
+  create(3, TPH_POISSON_CANDIDATES_POLAR, 5);
+  create(1, TPH_POISSON_CANDIDATES_GAUSSIAN, 50);
+  create(3, TPH_POISSON_CANDIDATES_GAUSSIAN, 5);
+  create(5, TPH_POISSON_CANDIDATES_GAUSSIAN, 3);
+}
+
+// Verify that grid storage modes, grid orders and sparse grids give identical samplings.
+static void TestGridLayout()
+{
+  constexpr tph_poisson_allocator *alloc = nullptr;
+  const auto create = [](const int32_t ndims,
+                        const int32_t method,
+                        const int32_t grid_storage,
+                        const int32_t grid_order,
+                        const Real extent,
+                        const ptrdiff_t grid_max_dense_size) {
+    TestArgs test_args = make_args(ndims, extent);
+    tph_poisson_args &args = test_args.args;
+    // Different extent along each axis, so that tiled grids need padding.
+    for (int32_t i = 0; i < ndims; ++i) {
+      test_args.bounds_max[static_cast<size_t>(i)] = extent * (1 + static_cast<Real>(i) / 8);
+    }
+    args.candidate_method = method;
+    args.grid_storage = grid_storage;
+    args.grid_order = grid_order;
+    args.grid_max_dense_size = grid_max_dense_size;
+    unique_poisson_ptr sampling = make_unique_poisson();
+    REQUIRE(TPH_POISSON_SUCCESS == tph_poisson_create(&args, alloc, sampling.get()));
+    REQUIRE(sampling->nsamples > 0);
+    return sampling;
+  };
+
+  const auto require_same = [&](const int32_t ndims,
+                              const int32_t method,
+                              const int32_t grid_storage,
+                              const int32_t grid_order,
+                              const Real extent,
+                              const ptrdiff_t grid_max_dense_size = 0) {
+    const unique_poisson_ptr expected = create(
+      ndims, method, TPH_POISSON_GRID_INDICES, TPH_POISSON_GRID_ORDER_ROW_MAJOR, extent, 0);
+    const unique_poisson_ptr actual =
+      create(ndims, method, grid_storage, grid_order, extent, grid_max_dense_size);
+    REQUIRE(SameSamples(*expected, *actual));
+  };
+
+  constexpr int32_t kRowMajor = TPH_POISSON_GRID_ORDER_ROW_MAJOR;
+  constexpr int32_t kTiled = TPH_POISSON_GRID_ORDER_TILED;
+  require_same(1, TPH_POISSON_CANDIDATES_REJECTION, TPH_POISSON_GRID_POINTS, kRowMajor, 100);
+  require_same(2, TPH_POISSON_CANDIDATES_REJECTION, TPH_POISSON_GRID_POINTS, kRowMajor, 20);
+  require_same(2, TPH_POISSON_CANDIDATES_ANGULAR, TPH_POISSON_GRID_POINTS, kRowMajor, 20);
+  require_same(3, TPH_POISSON_CANDIDATES_POLAR, TPH_POISSON_GRID_POINTS, kRowMajor, 8);
+  require_same(5, TPH_POISSON_CANDIDATES_GAUSSIAN, TPH_POISSON_GRID_POINTS, kRowMajor, 2);
+  require_same(2, TPH_POISSON_CANDIDATES_REJECTION, TPH_POISSON_GRID_INDICES, kTiled, 20);
+  require_same(2, TPH_POISSON_CANDIDATES_REJECTION, TPH_POISSON_GRID_POINTS, kTiled, 20);
+  require_same(3, TPH_POISSON_CANDIDATES_REJECTION, TPH_POISSON_GRID_INDICES, kTiled, 8);
+  require_same(3, TPH_POISSON_CANDIDATES_POLAR, TPH_POISSON_GRID_POINTS, kTiled, 8);
+
+  // Small samplings store 16-bit sample indices in the grid, larger ones need 32 bits.
+  require_same(2, TPH_POISSON_CANDIDATES_REJECTION, TPH_POISSON_GRID_POINTS, kRowMajor, 250);
+
+  // Sparse grids, a maximum dense size of one byte forces every grid to be sparse. Extents are
+  // chosen so that grids span several pages.
+  constexpr ptrdiff_t kSparse = 1;
+  constexpr int32_t kRejection = TPH_POISSON_CANDIDATES_REJECTION;
+  require_same(1, kRejection, TPH_POISSON_GRID_INDICES, kRowMajor, 5000, kSparse);
+  require_same(2, kRejection, TPH_POISSON_GRID_INDICES, kRowMajor, 40, kSparse);
+  require_same(2, kRejection, TPH_POISSON_GRID_POINTS, kTiled, 40, kSparse);
+  require_same(3, kRejection, TPH_POISSON_GRID_POINTS, kRowMajor, 12, kSparse);
+  require_same(3, kRejection, TPH_POISSON_GRID_INDICES, kTiled, 12, kSparse);
+}
+
+// Verify that bounds requiring more grid cells than can be indexed are reported.
+static void TestGridOverflow()
+{
+  constexpr tph_poisson_allocator *alloc = nullptr;
+  unique_poisson_ptr sampling = make_unique_poisson();
+
+  const auto create = [&](const int32_t ndims, const Real extent, const Real radius) {
+    TestArgs test_args = make_args(ndims, extent);
+    tph_poisson_args &args = test_args.args;
+    args.radius = radius;
+    return tph_poisson_create(&args, alloc, sampling.get());
+  };
+
+  // Number of cells along a single axis overflows.
+  REQUIRE(TPH_POISSON_OVERFLOW == create(1, std::numeric_limits<Real>::max() / 4, 1));
+
+  // Number of cells along each axis is fine, but their product overflows.
+  REQUIRE(TPH_POISSON_OVERFLOW == create(4, static_cast<Real>(1e6), static_cast<Real>(1e-3)));
+
+  // Infinite bounds.
+  REQUIRE(TPH_POISSON_OVERFLOW == create(2, std::numeric_limits<Real>::infinity(), 1));
+  REQUIRE(tph_poisson_get_samples(sampling.get()) == nullptr);
+}
+
+// Verify that generating candidates in batches gives the same samplings as generating them one
+// at a time.
+static void TestCandidateBatch()
+{
+  constexpr tph_poisson_allocator *alloc = nullptr;
+  const auto create = [](const int32_t ndims,
+                        const int32_t method,
+                        const Real extent,
+                        const uint32_t candidate_batch_size) {
+    TestArgs test_args = make_args(ndims, extent);
+    tph_poisson_args &args = test_args.args;
+    args.candidate_method = method;
+    args.candidate_batch_size = candidate_batch_size;
+    unique_poisson_ptr sampling = make_unique_poisson();
+    REQUIRE(TPH_POISSON_SUCCESS == tph_poisson_create(&args, alloc, sampling.get()));
+    REQUIRE(sampling->nsamples > 0);
+    return sampling;
+  };
+
+  const auto require_same = [&](const int32_t ndims, const int32_t method, const Real extent) {
+    const unique_poisson_ptr expected = create(ndims, method, extent, 1);
+    // Batch sizes that divide the number of attempts, that don't, and that are clamped.
+    for (const uint32_t candidate_batch_size : { 2U, 7U, 30U, 1000U }) {
+      const unique_poisson_ptr actual = create(ndims, method, extent, candidate_batch_size);
+      REQUIRE(SameSamples(*expected, *actual));
+    }
+  };
+
+  require_same(1, TPH_POISSON_CANDIDATES_REJECTION, 100);
+  require_same(2, TPH_POISSON_CANDIDATES_REJECTION, 20);
+  require_same(2, TPH_POISSON_CANDIDATES_POLAR, 20);
+  require_same(2, TPH_POISSON_CANDIDATES_ANGULAR, 20);
+  require_same(3, TPH_POISSON_CANDIDATES_GAUSSIAN, 8);
+  require_same(5, TPH_POISSON_CANDIDATES_REJECTION, 2);
+}
+
+// Verify that the multi-stream generator gives valid and reproducible samplings, which differ from
+// those of the default generator.
+static void TestPrng()
+{
+  constexpr tph_poisson_allocator *alloc = nullptr;
+  const auto create = [](const int32_t ndims,
+                        const int32_t method,
+                        const Real extent,
+                        const int32_t prng,
+                        const uint32_t candidate_batch_size = 0) {
+    TestArgs test_args = make_args(ndims, extent);
+    tph_poisson_args &args = test_args.args;
+    args.candidate_method = method;
+    args.candidate_batch_size = candidate_batch_size;
+    args.prng = prng;
+    unique_poisson_ptr sampling = make_unique_poisson();
+    REQUIRE(TPH_POISSON_SUCCESS == tph_poisson_create(&args, alloc, sampling.get()));
+    REQUIRE(sampling->nsamples > 0);
+    REQUIRE(ValidSampling(args, *sampling));
+    return sampling;
+  };
+
+  constexpr int32_t kX4 = TPH_POISSON_PRNG_XOSHIRO256P_X4;
+  const auto require_x4 = [&](const int32_t ndims, const int32_t method, const Real extent) {
+    const unique_poisson_ptr x4 = create(ndims, method, extent, kX4);
+    REQUIRE(SameSamples(*x4, *create(ndims, method, extent, kX4)));
+    REQUIRE(SameSamples(*x4, *create(ndims, method, extent, kX4, 7)));
+    REQUIRE(!SameSamples(*x4, *create(ndims, method, extent, TPH_POISSON_PRNG_XOSHIRO256P)));
+  };
+
+  require_x4(1, TPH_POISSON_CANDIDATES_REJECTION, 100);
+  require_x4(2, TPH_POISSON_CANDIDATES_REJECTION, 20);
+  require_x4(2, TPH_POISSON_CANDIDATES_ANGULAR, 20);
+  require_x4(3, TPH_POISSON_CANDIDATES_POLAR, 8);
+  require_x4(4, TPH_POISSON_CANDIDATES_GAUSSIAN, 4);
+  require_x4(5, TPH_POISSON_CANDIDATES_REJECTION, 2);
+}
+
+// Verify that parallel sampling gives valid samplings that don't depend on the executor, i.e. on
+// the number of threads or the order in which tasks run.
+static void TestParallel()
+{
+  constexpr tph_poisson_allocator *alloc = nullptr;
+  // Runs tasks in reverse order on the calling thread.
+  tph_poisson_executor reverse = {};
+  reverse.run = [](tph_poisson_task_fn task, void *task_ctx, ptrdiff_t ntasks, void * /*ctx*/) {
+    for (ptrdiff_t i = ntasks - 1; i >= 0; --i) { task(task_ctx, i); }
+  };
+
+  // Runs tasks on a number of threads, taking tasks from a shared counter.
+  tph_poisson_executor threads = {};
+  threads.run = [](tph_poisson_task_fn task, void *task_ctx, ptrdiff_t ntasks, void *ctx) {
+    std::atomic<ptrdiff_t> next{ 0 };
+    std::vector<std::thread> workers;
+    for (int32_t t = 0; t < *static_cast<const int32_t *>(ctx); ++t) {
+      workers.emplace_back([&]() {
+        for (ptrdiff_t i = next++; i < ntasks; i = next++) { task(task_ctx, i); }
+      });
+    }
+    for (auto &&w : workers) { w.join(); }
+  };
+
+  const auto require_same = [&](const int32_t ndims, const Real extent, const Real tile_size) {
+    TestArgs test_args = make_args(ndims, extent);
+    tph_poisson_args &args = test_args.args;
+    args.tile_size = tile_size;
+    unique_poisson_ptr expected = make_unique_poisson();
+    REQUIRE(TPH_POISSON_SUCCESS
+            == tph_poisson_create_parallel(&args, /*executor=*/nullptr, alloc, expected.get()));
+    REQUIRE(expected->nsamples > 0);
+    REQUIRE(ValidSampling(args, *expected));
+
+    const auto require_executor = [&](const tph_poisson_executor &executor) {
+      unique_poisson_ptr actual = make_unique_poisson();
+      REQUIRE(TPH_POISSON_SUCCESS
+              == tph_poisson_create_parallel(&args, &executor, alloc, actual.get()));
+      REQUIRE(SameSamples(*expected, *actual));
+    };
+    require_executor(reverse);
+    for (int32_t nthreads : { 1, 2, 4, 7 }) {
+      threads.ctx = &nthreads;
+      require_executor(threads);
+    }
+  };
+
+  // Default tile size, a single tile along some axes, and the smallest valid tile size.
+  require_same(1, 200, 0);
+  require_same(2, 30, 0);
+  require_same(2, 30, 2);
+  require_same(3, 8, 3);
+  require_same(4, 3, 2);
+
+  // Tile size must be at least the outer annulus radius. Executors must have a run function.
+  TestArgs test_args = make_args(2, 10);
+  tph_poisson_args &args = test_args.args;
+  unique_poisson_ptr sampling = make_unique_poisson();
+  for (const Real tile_size :
+    { static_cast<Real>(1.9), Real{ -1 }, std::numeric_limits<Real>::quiet_NaN() }) {
+    args.tile_size = tile_size;
+    REQUIRE(TPH_POISSON_INVALID_ARGS
+            == tph_poisson_create_parallel(&args, /*executor=*/nullptr, alloc, sampling.get()));
+  }
+  args.annulus_outer_factor = 3;
+  args.tile_size = static_cast<Real>(2.5);
+  REQUIRE(TPH_POISSON_INVALID_ARGS
+          == tph_poisson_create_parallel(&args, /*executor=*/nullptr, alloc, sampling.get()));
+  args.tile_size = 3;
+  REQUIRE(TPH_POISSON_SUCCESS
+          == tph_poisson_create_parallel(&args, /*executor=*/nullptr, alloc, sampling.get()));
+  REQUIRE(ValidSampling(args, *sampling));
+  // The default tile size follows the wider annulus.
+  args.tile_size = 0;
+  REQUIRE(TPH_POISSON_SUCCESS
+          == tph_poisson_create_parallel(&args, /*executor=*/nullptr, alloc, sampling.get()));
+  REQUIRE(ValidSampling(args, *sampling));
+  const tph_poisson_executor no_run = {};
+  REQUIRE(TPH_POISSON_INVALID_ARGS
+          == tph_poisson_create_parallel(&args, &no_run, alloc, sampling.get()));
+}
+
+// Verify that running a sampler gives the same samplings as creating them one at a time, for any
+// sequence of seeds, i.e. that the grid is properly reset between runs.
+static void TestSampler()
+{
+  constexpr tph_poisson_allocator *alloc = nullptr;
+  struct SamplerArgs
+  {
+    int32_t ndims;
+    Real extent;
+    uint32_t max_sample_attempts;
+    int32_t grid_storage;
+    int32_t grid_order;
+    ptrdiff_t grid_max_dense_size;
+    int32_t prng;
+  };
+
+  const auto require_same = [&](const SamplerArgs &sa) {
+    TestArgs test_args = make_args(sa.ndims, sa.extent);
+    tph_poisson_args &args = test_args.args;
+    args.max_sample_attempts = sa.max_sample_attempts;
+    args.grid_storage = sa.grid_storage;
+    args.grid_order = sa.grid_order;
+    args.grid_max_dense_size = sa.grid_max_dense_size;
+    args.prng = sa.prng;
+
+    tph_poisson_sampler sampler = {};
+    REQUIRE(TPH_POISSON_SUCCESS == tph_poisson_sampler_create(&args, alloc, &sampler));
+    REQUIRE(sampler.ndims == sa.ndims);
+    REQUIRE(sampler.nsamples == 0);
+    REQUIRE(tph_poisson_sampler_get_samples(&sampler) == nullptr);
+
+    // Repeated seeds make sure that a run does not depend on the previous one.
+    for (const uint64_t seed : { UINT64_C(1981), UINT64_C(0), UINT64_C(1981), UINT64_C(42) }) {
+      args.seed = seed;
+      unique_poisson_ptr expected = make_unique_poisson();
+      REQUIRE(TPH_POISSON_SUCCESS == tph_poisson_create(&args, alloc, expected.get()));
+      REQUIRE(TPH_POISSON_SUCCESS == tph_poisson_sampler_run(&sampler, seed));
+      REQUIRE(expected->nsamples == sampler.nsamples);
+      REQUIRE(SamePrefix(*expected, tph_poisson_sampler_get_samples(&sampler), sampler.nsamples));
+    }
+
+    tph_poisson_sampler_destroy(&sampler);
+    REQUIRE(sampler.internal == nullptr);
+    REQUIRE(tph_poisson_sampler_get_samples(&sampler) == nullptr);
+  };
+
+  constexpr int32_t kIndices = TPH_POISSON_GRID_INDICES;
+  constexpr int32_t kPoints = TPH_POISSON_GRID_POINTS;
+  constexpr int32_t kRowMajor = TPH_POISSON_GRID_ORDER_ROW_MAJOR;
+  constexpr int32_t kTiled = TPH_POISSON_GRID_ORDER_TILED;
+  constexpr int32_t kX4 = TPH_POISSON_PRNG_XOSHIRO256P_X4;
+  // Grids with many samples are reset entirely, grids with few samples cell by cell.
+  require_same({ 1, 100, 30, kIndices, kRowMajor, 0, 0 });
+  require_same({ 2, 20, 30, kIndices, kRowMajor, 0, 0 });
+  require_same({ 2, 20, 1, kPoints, kRowMajor, 0, 0 });
+  require_same({ 3, 8, 30, kPoints, kTiled, 0, kX4 });
+  require_same({ 4, 3, 30, kIndices, kRowMajor, 0, 0 });
+  require_same({ 5, 2, 30, kPoints, kRowMajor, 0, 0 });
+  // Sparse grids keep their pages between runs.
+  require_same({ 2, 40, 30, kIndices, kRowMajor, 1, 0 });
+  require_same({ 3, 12, 30, kPoints, kTiled, 1, 0 });
+
+  // Invalid arguments and uninitialized samplers.
+  tph_poisson_sampler sampler = {};
+  tph_poisson_args args = {};
+  REQUIRE(TPH_POISSON_INVALID_ARGS == tph_poisson_sampler_create(&args, alloc, &sampler));
+  REQUIRE(sampler.internal == nullptr);
+  REQUIRE(TPH_POISSON_INVALID_ARGS == tph_poisson_sampler_run(&sampler, 0));
+  REQUIRE(TPH_POISSON_INVALID_ARGS == tph_poisson_sampler_run(nullptr, 0));
+  REQUIRE(TPH_POISSON_INVALID_ARGS == tph_poisson_sampler_create(&args, alloc, nullptr));
+  REQUIRE(tph_poisson_sampler_get_samples(nullptr) == nullptr);
+  tph_poisson_sampler_destroy(nullptr);
+}
+
+// Verify that writing samples to a caller buffer gives the same samples as tph_poisson_create,
+// that small buffers are truncated and that the upper bound for the number of samples holds.
+static void TestCreateInto()
+{
+  constexpr tph_poisson_allocator *alloc = nullptr;
+  const auto require_same = [&](const int32_t ndims, const Real extent, const int32_t method) {
+    TestArgs test_args = make_args(ndims, extent);
+    tph_poisson_args &args = test_args.args;
+    args.candidate_method = method;
+    unique_poisson_ptr expected = make_unique_poisson();
+    REQUIRE(TPH_POISSON_SUCCESS == tph_poisson_create(&args, alloc, expected.get()));
+
+    ptrdiff_t max_samples = 0;
+    REQUIRE(TPH_POISSON_SUCCESS == tph_poisson_max_samples(&args, &max_samples));
+    REQUIRE(max_samples >= expected->nsamples);
+
+    // Buffer sized using the upper bound.
+    std::vector<Real> samples(static_cast<size_t>(max_samples * ndims));
+    ptrdiff_t nsamples = -1;
+    REQUIRE(TPH_POISSON_SUCCESS
+            == tph_poisson_create_into(&args, alloc, samples.data(), max_samples, &nsamples));
+    REQUIRE(nsamples == expected->nsamples);
+    REQUIRE(SamePrefix(*expected, samples.data(), nsamples));
+
+    // Buffer that fits exactly, and buffers that are too small hold the first samples.
+    for (const ptrdiff_t n : { expected->nsamples, expected->nsamples - 1, ptrdiff_t{ 1 } }) {
+      std::vector<Real> small(static_cast<size_t>(n * ndims));
+      REQUIRE((n == expected->nsamples ? TPH_POISSON_SUCCESS : TPH_POISSON_TRUNCATED)
+              == tph_poisson_create_into(&args, alloc, small.data(), n, &nsamples));
+      REQUIRE(nsamples == n);
+      REQUIRE(SamePrefix(*expected, small.data(), n));
+    }
+    REQUIRE(TPH_POISSON_TRUNCATED
+            == tph_poisson_create_into(&args, alloc, /*samples=*/nullptr, 0, &nsamples));
+    REQUIRE(nsamples == 0);
+  };
+
+  require_same(1, 100, TPH_POISSON_CANDIDATES_REJECTION);
+  require_same(2, 20, TPH_POISSON_CANDIDATES_REJECTION);
+  require_same(2, 20, TPH_POISSON_CANDIDATES_ANGULAR);
+  require_same(3, 8, TPH_POISSON_CANDIDATES_POLAR);
+  require_same(4, 3, TPH_POISSON_CANDIDATES_GAUSSIAN);
+  require_same(5, 2, TPH_POISSON_CANDIDATES_REJECTION);
+
+  // Bounds smaller than a grid cell hold a single sample.
+  TestArgs test_args = make_args(2, 0, static_cast<Real>(0.1));
+  tph_poisson_args &args = test_args.args;
+  ptrdiff_t max_samples = 0;
+  REQUIRE(TPH_POISSON_SUCCESS == tph_poisson_max_samples(&args, &max_samples));
+  REQUIRE(max_samples == 1);
+
+  // Invalid arguments.
+  std::array<Real, 2> sample = {};
+  ptrdiff_t nsamples = -1;
+  REQUIRE(TPH_POISSON_INVALID_ARGS
+          == tph_poisson_create_into(&args, alloc, sample.data(), 1, /*nsamples=*/nullptr));
+  REQUIRE(TPH_POISSON_INVALID_ARGS
+          == tph_poisson_create_into(&args, alloc, sample.data(), -1, &nsamples));
+  REQUIRE(nsamples == 0);
+  REQUIRE(TPH_POISSON_INVALID_ARGS
+          == tph_poisson_create_into(&args, alloc, /*samples=*/nullptr, 1, &nsamples));
+  REQUIRE(TPH_POISSON_INVALID_ARGS == tph_poisson_max_samples(&args, /*max_samples=*/nullptr));
+  args.radius = 0;
+  REQUIRE(TPH_POISSON_INVALID_ARGS
+          == tph_poisson_create_into(&args, alloc, sample.data(), 1, &nsamples));
+  REQUIRE(TPH_POISSON_INVALID_ARGS == tph_poisson_max_samples(&args, &max_samples));
+  REQUIRE(max_samples == 0);
+}
+
+// Verify that sample count estimates are close to the actual number of samples.
+static void TestEstimateSamples()
+{
+  constexpr tph_poisson_allocator *alloc = nullptr;
+  const auto require_close = [&](const int32_t ndims, const Real extent, const uint32_t attempts) {
+    TestArgs test_args = make_args(ndims, extent);
+    tph_poisson_args &args = test_args.args;
+    args.max_sample_attempts = attempts;
+    args.candidate_method = ndims > 3 ? TPH_POISSON_CANDIDATES_GAUSSIAN : 0;
+    unique_poisson_ptr sampling = make_unique_poisson();
+    REQUIRE(TPH_POISSON_SUCCESS == tph_poisson_create(&args, alloc, sampling.get()));
+
+    ptrdiff_t estimate = 0;
+    ptrdiff_t max_samples = 0;
+    REQUIRE(TPH_POISSON_SUCCESS == tph_poisson_estimate_samples(&args, &estimate));
+    REQUIRE(TPH_POISSON_SUCCESS == tph_poisson_max_samples(&args, &max_samples));
+    REQUIRE(estimate <= max_samples);
+    const double ratio = static_cast<double>(estimate) / static_cast<double>(sampling->nsamples);
+    REQUIRE(0.8 < ratio && ratio < 1.25);
+  };
+
+  require_close(1, 1000, 30);
+  require_close(2, 50, 10);
+  require_close(2, 50, 30);
+  require_close(2, 50, 100);
+  require_close(3, 12, 30);
+  require_close(4, 5, 30);
+  require_close(5, 3, 30);
+
+  // Bounds smaller than a grid cell, the estimate is never zero.
+  TestArgs test_args = make_args(2, 0, static_cast<Real>(0.1));
+  tph_poisson_args &args = test_args.args;
+  ptrdiff_t estimate = 0;
+  REQUIRE(TPH_POISSON_SUCCESS == tph_poisson_estimate_samples(&args, &estimate));
+  REQUIRE(estimate == 1);
+  unique_poisson_ptr sampling = make_unique_poisson();
+  REQUIRE(TPH_POISSON_SUCCESS == tph_poisson_create(&args, alloc, sampling.get()));
+  REQUIRE(sampling->nsamples == 1);
+
+  // Invalid arguments.
+  REQUIRE(TPH_POISSON_INVALID_ARGS == tph_poisson_estimate_samples(&args, /*nsamples=*/nullptr));
+  args.max_sample_attempts = 0;
+  REQUIRE(TPH_POISSON_INVALID_ARGS == tph_poisson_estimate_samples(&args, &estimate));
+  REQUIRE(estimate == 0);
+}
+
+// Verify that sampling in an arena sized by tph_poisson_query_memory gives the same samples as
+// tph_poisson_create, and that the sample cap truncates the sampling.
+static void TestCreateInArena()
+{
+  constexpr tph_poisson_allocator *alloc = nullptr;
+  const auto require_same = [&](const int32_t ndims,
+                              const Real extent,
+                              const int32_t method,
+                              const ptrdiff_t grid_max_dense_size,
+                              const int32_t grid_storage) {
+    TestArgs test_args = make_args(ndims, extent);
+    tph_poisson_args &args = test_args.args;
+    args.candidate_method = method;
+    args.grid_max_dense_size = grid_max_dense_size;
+    args.grid_storage = grid_storage;
+    unique_poisson_ptr expected = make_unique_poisson();
+    REQUIRE(TPH_POISSON_SUCCESS == tph_poisson_create(&args, alloc, expected.get()));
+
+    // Misaligned arena that fits exactly.
+    ptrdiff_t nbytes = 0;
+    REQUIRE(TPH_POISSON_SUCCESS == tph_poisson_query_memory(&args, /*max_samples=*/0, &nbytes));
+    std::vector<uint8_t> arena(static_cast<size_t>(nbytes + 1));
+    unique_poisson_ptr sampling = make_unique_poisson();
+    REQUIRE(TPH_POISSON_SUCCESS
+            == tph_poisson_create_in_arena(&args, arena.data() + 1, nbytes, 0, sampling.get()));
+    REQUIRE(sampling->nsamples == expected->nsamples);
+    REQUIRE(SameSamples(*expected, *sampling));
+    REQUIRE(TPH_POISSON_BAD_ALLOC
+            == tph_poisson_create_in_arena(&args, arena.data(), nbytes - 1, 0, sampling.get()));
+    REQUIRE(sampling->internal == nullptr);
+
+    // Capped samplings hold the first samples, and need less memory.
+    for (const ptrdiff_t n : { expected->nsamples, expected->nsamples - 1, ptrdiff_t{ 1 } }) {
+      ptrdiff_t capped_nbytes = 0;
+      REQUIRE(TPH_POISSON_SUCCESS == tph_poisson_query_memory(&args, n, &capped_nbytes));
+      REQUIRE(capped_nbytes <= nbytes);
+      REQUIRE((n == expected->nsamples ? TPH_POISSON_SUCCESS : TPH_POISSON_TRUNCATED)
+              == tph_poisson_create_in_arena(
+                &args, arena.data(), capped_nbytes, n, sampling.get()));
+      REQUIRE(sampling->nsamples == n);
+      REQUIRE(SamePrefix(*expected, tph_poisson_get_samples(sampling.get()), n));
+    }
+  };
+
+  require_same(1, 100, TPH_POISSON_CANDIDATES_REJECTION, 0, TPH_POISSON_GRID_INDICES);
+  require_same(2, 20, TPH_POISSON_CANDIDATES_REJECTION, 0, TPH_POISSON_GRID_INDICES);
+  require_same(2, 20, TPH_POISSON_CANDIDATES_ANGULAR, 0, TPH_POISSON_GRID_POINTS);
+  require_same(2, 20, TPH_POISSON_CANDIDATES_REJECTION, 1, TPH_POISSON_GRID_INDICES);
+  require_same(3, 8, TPH_POISSON_CANDIDATES_POLAR, 1, TPH_POISSON_GRID_POINTS);
+  require_same(5, 2, TPH_POISSON_CANDIDATES_GAUSSIAN, 0, TPH_POISSON_GRID_INDICES);
+
+  // Invalid arguments.
+  TestArgs test_args = make_args(2, 0, 10);
+  tph_poisson_args &args = test_args.args;
+  ptrdiff_t nbytes = -1;
+  REQUIRE(TPH_POISSON_INVALID_ARGS == tph_poisson_query_memory(&args, 0, /*nbytes=*/nullptr));
+  REQUIRE(TPH_POISSON_INVALID_ARGS == tph_poisson_query_memory(&args, -1, &nbytes));
+  REQUIRE(nbytes == 0);
+  REQUIRE(TPH_POISSON_SUCCESS == tph_poisson_query_memory(&args, 0, &nbytes));
+  std::vector<uint8_t> arena(static_cast<size_t>(nbytes));
+  unique_poisson_ptr sampling = make_unique_poisson();
+  REQUIRE(TPH_POISSON_INVALID_ARGS
+          == tph_poisson_create_in_arena(&args, arena.data(), nbytes, 0, /*sampling=*/nullptr));
+  REQUIRE(TPH_POISSON_INVALID_ARGS
+          == tph_poisson_create_in_arena(&args, arena.data(), -1, 0, sampling.get()));
+  REQUIRE(TPH_POISSON_INVALID_ARGS
+          == tph_poisson_create_in_arena(&args, /*arena=*/nullptr, nbytes, 0, sampling.get()));
+  REQUIRE(TPH_POISSON_INVALID_ARGS
+          == tph_poisson_create_in_arena(&args, arena.data(), nbytes, -1, sampling.get()));
+  args.radius = 0;
+  REQUIRE(TPH_POISSON_INVALID_ARGS == tph_poisson_query_memory(&args, 0, &nbytes));
+  REQUIRE(TPH_POISSON_INVALID_ARGS
+          == tph_poisson_create_in_arena(&args, arena.data(), nbytes, 0, sampling.get()));
+}
+
+// Verify that the SoA layout holds the same samples as the default layout, in aligned and padded
+// dimension arrays, and that it is rejected where it is not supported.
+static void TestOutputLayout()
+{
+  constexpr tph_poisson_allocator *alloc = nullptr;
+  const auto require_transposed = [&](const int32_t ndims, const Real extent, const bool parallel) {
+    TestArgs test_args = make_args(ndims, extent);
+    tph_poisson_args &args = test_args.args;
+    args.candidate_method = ndims > 3 ? TPH_POISSON_CANDIDATES_GAUSSIAN : 0;
+    const auto create = [&](tph_poisson_sampling *sampling) {
+      return parallel ? tph_poisson_create_parallel(&args, /*executor=*/nullptr, alloc, sampling)
+                      : tph_poisson_create(&args, alloc, sampling);
+    };
+    unique_poisson_ptr aos = make_unique_poisson();
+    REQUIRE(TPH_POISSON_SUCCESS == create(aos.get()));
+    REQUIRE(aos->soa_stride == 0);
+
+    args.output_layout = TPH_POISSON_LAYOUT_SOA;
+    unique_poisson_ptr soa = make_unique_poisson();
+    REQUIRE(TPH_POISSON_SUCCESS == create(soa.get()));
+    REQUIRE(soa->nsamples == aos->nsamples);
+    REQUIRE(soa->ndims == ndims);
+    REQUIRE(soa->soa_stride >= soa->nsamples);
+    REQUIRE((soa->soa_stride * static_cast<ptrdiff_t>(sizeof(Real))) % 64 == 0);
+    const Real *aos_samples = tph_poisson_get_samples(aos.get());
+    const Real *soa_samples = tph_poisson_get_samples(soa.get());
+    REQUIRE(reinterpret_cast<uintptr_t>(soa_samples) % 64 == 0);
+    constexpr Real zero = 0;
+    for (int32_t i = 0; i < ndims; ++i) {
+      const Real *dim = soa_samples + i * soa->soa_stride;
+      for (ptrdiff_t j = 0; j < soa->nsamples; ++j) {
+        REQUIRE(std::memcmp(&dim[j], &aos_samples[j * ndims + i], sizeof(Real)) == 0);
+      }
+      // Padding, if any, is zeroed.
+      for (ptrdiff_t j = soa->nsamples; j < soa->soa_stride; ++j) {
+        REQUIRE(std::memcmp(&dim[j], &zero, sizeof(Real)) == 0);
+      }
+    }
+  };
+
+  require_transposed(1, 100, /*parallel=*/false);
+  require_transposed(2, 20, /*parallel=*/false);
+  require_transposed(3, 8, /*parallel=*/false);
+  require_transposed(5, 2, /*parallel=*/false);
+  require_transposed(2, 30, /*parallel=*/true);
+  require_transposed(3, 8, /*parallel=*/true);
+
+  // Invalid layout, and functions that only support the default layout.
+  TestArgs test_args = make_args(2, 0, 10);
+  tph_poisson_args &args = test_args.args;
+  unique_poisson_ptr sampling = make_unique_poisson();
+  for (const int32_t layout : { -1, 2, 1000 }) {
+    args.output_layout = layout;
+    REQUIRE(TPH_POISSON_INVALID_ARGS == tph_poisson_create(&args, alloc, sampling.get()));
+    REQUIRE(TPH_POISSON_INVALID_ARGS
+            == tph_poisson_create_parallel(&args, /*executor=*/nullptr, alloc, sampling.get()));
+  }
+  args.output_layout = TPH_POISSON_LAYOUT_SOA;
+  std::vector<Real> samples(1000);
+  ptrdiff_t nsamples = -1;
+  REQUIRE(TPH_POISSON_INVALID_ARGS
+          == tph_poisson_create_into(&args, alloc, samples.data(), 500, &nsamples));
+  REQUIRE(nsamples == 0);
+  std::vector<uint8_t> arena(1 << 16);
+  REQUIRE(TPH_POISSON_INVALID_ARGS
+          == tph_poisson_create_in_arena(
+            &args, arena.data(), static_cast<ptrdiff_t>(arena.size()), 0, sampling.get()));
+  tph_poisson_sampler sampler = {};
+  REQUIRE(TPH_POISSON_INVALID_ARGS == tph_poisson_sampler_create(&args, alloc, &sampler));
+  REQUIRE(sampler.internal == nullptr);
+}
+
+// Verify that quantized samples decode to within the documented error of the samples, in both
+// layouts, and that formats too coarse for the tolerance are rejected.
+static void TestQuantize()
+{
+  constexpr tph_poisson_allocator *alloc = nullptr;
+  const auto decode_half = [](const uint16_t h) {
+    const int e = (h >> 10) & 31;
+    const int m = h & 1023;
+    return e == 0 ? std::ldexp(static_cast<double>(m), -24)
+                  : std::ldexp(static_cast<double>(1024 + m), e - 25);
+  };
+
+  const auto require_close = [&](const int32_t ndims, const int32_t layout, const int32_t format) {
+    TestArgs test_args = make_args(ndims, -10, 30);
+    tph_poisson_args &args = test_args.args;
+    args.output_layout = layout;
+    unique_poisson_ptr sampling = make_unique_poisson();
+    REQUIRE(TPH_POISSON_SUCCESS == tph_poisson_create(&args, alloc, sampling.get()));
+    const Real *samples = tph_poisson_get_samples(sampling.get());
+    const ptrdiff_t nvalues =
+      (layout == TPH_POISSON_LAYOUT_SOA ? sampling->soa_stride : sampling->nsamples) * ndims;
+    std::vector<uint32_t> buf(static_cast<size_t>(nvalues));
+    const ptrdiff_t value_size = format == TPH_POISSON_QUANTIZE_U32 ? 4 : 2;
+    const Real tolerance = static_cast<Real>(0.1);
+    REQUIRE(TPH_POISSON_INVALID_ARGS
+            == tph_poisson_quantize(
+              sampling.get(), &args, format, tolerance, buf.data(), nvalues * value_size - 1));
+    REQUIRE(TPH_POISSON_SUCCESS
+            == tph_poisson_quantize(
+              sampling.get(), &args, format, tolerance, buf.data(), nvalues * value_size));
+
+    const double extent = 40;
+    const double max_error = format == TPH_POISSON_QUANTIZE_U16   ? extent / 131070
+                             : format == TPH_POISSON_QUANTIZE_U32 ? extent / 8589934590.0
+                                                                  : extent / 4096;
+    const auto *q16 = reinterpret_cast<const uint16_t *>(buf.data());
+    const auto *q32 = buf.data();
+    for (ptrdiff_t k = 0; k < nvalues; ++k) {
+      const double t = format == TPH_POISSON_QUANTIZE_U16   ? q16[k] / 65535.0
+                       : format == TPH_POISSON_QUANTIZE_U32 ? q32[k] / 4294967295.0
+                                                            : decode_half(q16[k]);
+      const bool padding =
+        layout == TPH_POISSON_LAYOUT_SOA && k % sampling->soa_stride >= sampling->nsamples;
+      if (padding) {
+        REQUIRE((format == TPH_POISSON_QUANTIZE_U32 ? q32[k] : q16[k]) == 0);
+      } else {
+        // Samples are exact in double, the bound only holds up to rounding of t.
+        REQUIRE(std::abs(-10 + t * extent - static_cast<double>(samples[k]))
+                <= max_error * (1 + 1e-9));
+      }
+    }
+  };
+
+  for (const int32_t format :
+    { TPH_POISSON_QUANTIZE_U16, TPH_POISSON_QUANTIZE_U32, TPH_POISSON_QUANTIZE_F16 }) {
+    require_close(2, TPH_POISSON_LAYOUT_AOS, format);
+    require_close(3, TPH_POISSON_LAYOUT_AOS, format);
+    require_close(2, TPH_POISSON_LAYOUT_SOA, format);
+  }
+
+  // Tolerance is relative to the radius, the error is the norm of per-coordinate errors.
+  TestArgs test_args = make_args(2, 0, 4096);
+  tph_poisson_args &args = test_args.args;
+  args.radius = 8;
+  unique_poisson_ptr sampling = make_unique_poisson();
+  REQUIRE(TPH_POISSON_SUCCESS == tph_poisson_create(&args, alloc, sampling.get()));
+  std::vector<uint32_t> buf(static_cast<size_t>(sampling->nsamples * 2));
+  const ptrdiff_t nbytes = static_cast<ptrdiff_t>(buf.size() * sizeof(uint32_t));
+  void *dst = buf.data();
+  // F16 error is sqrt(2) * 4096 / 4096, i.e. about 0.18 * radius.
+  REQUIRE(TPH_POISSON_INVALID_ARGS
+          == tph_poisson_quantize(
+            sampling.get(), &args, TPH_POISSON_QUANTIZE_F16, static_cast<Real>(0.17), dst, nbytes));
+  REQUIRE(TPH_POISSON_SUCCESS
+          == tph_poisson_quantize(
+            sampling.get(), &args, TPH_POISSON_QUANTIZE_F16, static_cast<Real>(0.18), dst, nbytes));
+  REQUIRE(TPH_POISSON_SUCCESS
+          == tph_poisson_quantize(
+            sampling.get(), &args, TPH_POISSON_QUANTIZE_U16, static_cast<Real>(0.01), dst, nbytes));
+
+  // Invalid arguments.
+  const Real tol = 1;
+  REQUIRE(TPH_POISSON_INVALID_ARGS
+          == tph_poisson_quantize(sampling.get(), &args, -1, tol, dst, nbytes));
+  REQUIRE(TPH_POISSON_INVALID_ARGS
+          == tph_poisson_quantize(sampling.get(), &args, 3, tol, dst, nbytes));
+  REQUIRE(TPH_POISSON_INVALID_ARGS
+          == tph_poisson_quantize(sampling.get(), &args, 0, Real{ -1 }, dst, nbytes));
+  REQUIRE(TPH_POISSON_INVALID_ARGS
+          == tph_poisson_quantize(
+            sampling.get(), &args, 0, std::numeric_limits<Real>::quiet_NaN(), dst, nbytes));
+  REQUIRE(TPH_POISSON_INVALID_ARGS
+          == tph_poisson_quantize(sampling.get(), &args, 0, tol, /*samples=*/nullptr, nbytes));
+  REQUIRE(TPH_POISSON_INVALID_ARGS
+          == tph_poisson_quantize(/*sampling=*/nullptr, &args, 0, tol, dst, nbytes));
+  REQUIRE(TPH_POISSON_INVALID_ARGS
+          == tph_poisson_quantize(sampling.get(), /*args=*/nullptr, 0, tol, dst, nbytes));
+  args.ndims = 1;
+  REQUIRE(TPH_POISSON_INVALID_ARGS
+          == tph_poisson_quantize(sampling.get(), &args, 0, tol, dst, nbytes));
+  tph_poisson_destroy(sampling.get());
+  args.ndims = 2;
+  REQUIRE(TPH_POISSON_INVALID_ARGS
+          == tph_poisson_quantize(sampling.get(), &args, 0, tol, dst, nbytes));
+}
+
+// Verify that streamed samples are the same as those given by tph_poisson_create, in chunks of the
+// requested size, whether or not samples are retained.
+static void TestCreateStream()
+{
+  constexpr tph_poisson_allocator *alloc = nullptr;
+  struct Chunks
+  {
+    std::vector<Real> samples;
+    std::vector<ptrdiff_t> sizes;
+  };
+  const tph_poisson_stream_fn append = [](const Real *samples, ptrdiff_t nsamples, void *ctx) {
+    auto *chunks = static_cast<Chunks *>(ctx);
+    const ptrdiff_t ndims = 2;
+    chunks->samples.insert(chunks->samples.end(), samples, samples + nsamples * ndims);
+    chunks->sizes.push_back(nsamples);
+  };
+
+  TestArgs test_args = make_args(2, 20);
+  tph_poisson_args &args = test_args.args;
+  unique_poisson_ptr expected = make_unique_poisson();
+  REQUIRE(TPH_POISSON_SUCCESS == tph_poisson_create(&args, alloc, expected.get()));
+  const ptrdiff_t nvalues = expected->nsamples * args.ndims;
+
+  for (const int32_t grid_storage : { TPH_POISSON_GRID_INDICES, TPH_POISSON_GRID_POINTS }) {
+    for (const ptrdiff_t chunk_size : { ptrdiff_t{ 0 }, ptrdiff_t{ 1 }, ptrdiff_t{ 7 } }) {
+      for (const int32_t retain : { 0, 1 }) {
+        args.grid_storage = grid_storage;
+        Chunks chunks;
+        tph_poisson_stream stream = {};
+        stream.samples = append;
+        stream.ctx = &chunks;
+        stream.chunk_size = chunk_size;
+        stream.retain_samples = retain;
+        unique_poisson_ptr sampling = make_unique_poisson();
+        REQUIRE(TPH_POISSON_SUCCESS
+                == tph_poisson_create_stream(&args, &stream, alloc, sampling.get()));
+        REQUIRE(sampling->nsamples == expected->nsamples);
+        REQUIRE(static_cast<ptrdiff_t>(chunks.samples.size()) == nvalues);
+        REQUIRE(SamePrefix(*expected, chunks.samples.data(), expected->nsamples));
+        const ptrdiff_t n = chunk_size > 0 ? chunk_size : 1024;
+        for (size_t i = 0; i < chunks.sizes.size(); ++i) {
+          REQUIRE(chunks.sizes[i] == n || (i + 1 == chunks.sizes.size() && chunks.sizes[i] < n));
+        }
+        if (retain != 0) {
+          REQUIRE(SameSamples(*expected, *sampling));
+        } else {
+          REQUIRE(tph_poisson_get_samples(sampling.get()) == nullptr);
+        }
+      }
+    }
+  }
+
+  // Invalid arguments.
+  Chunks chunks;
+  tph_poisson_stream stream = {};
+  stream.ctx = &chunks;
+  unique_poisson_ptr sampling = make_unique_poisson();
+  REQUIRE(TPH_POISSON_INVALID_ARGS
+          == tph_poisson_create_stream(&args, /*stream=*/nullptr, alloc, sampling.get()));
+  REQUIRE(TPH_POISSON_INVALID_ARGS
+          == tph_poisson_create_stream(&args, &stream, alloc, sampling.get()));
+  stream.samples = append;
+  stream.chunk_size = -1;
+  REQUIRE(TPH_POISSON_INVALID_ARGS
+          == tph_poisson_create_stream(&args, &stream, alloc, sampling.get()));
+  stream.chunk_size = 0;
+  args.output_layout = TPH_POISSON_LAYOUT_SOA;
+  REQUIRE(TPH_POISSON_INVALID_ARGS
+          == tph_poisson_create_stream(&args, &stream, alloc, sampling.get()));
+  stream.retain_samples = 1;
+  REQUIRE(TPH_POISSON_SUCCESS == tph_poisson_create_stream(&args, &stream, alloc, sampling.get()));
+  REQUIRE(sampling->soa_stride >= sampling->nsamples);
+  REQUIRE(chunks.samples.size() == static_cast<size_t>(nvalues));
+  args.radius = 0;
+  REQUIRE(TPH_POISSON_INVALID_ARGS
+          == tph_poisson_create_stream(&args, &stream, alloc, sampling.get()));
+  REQUIRE(chunks.samples.size() == static_cast<size_t>(nvalues));
+}
+
+// Verify that stepping a sampler with a limited number of attempts per step gives the same
+// samples as tph_poisson_create, that each step only appends samples, and that steps are
+// rejected unless a sampling has been begun.
+static void TestSamplerStep()
+{
+  constexpr tph_poisson_allocator *alloc = nullptr;
+  const auto require_same = [&](const int32_t ndims, const Real extent, const int32_t method) {
+    TestArgs test_args = make_args(ndims, extent);
+    tph_poisson_args &args = test_args.args;
+    args.candidate_method = method;
+    unique_poisson_ptr expected = make_unique_poisson();
+    REQUIRE(TPH_POISSON_SUCCESS == tph_poisson_create(&args, alloc, expected.get()));
+
+    tph_poisson_sampler sampler = {};
+    REQUIRE(TPH_POISSON_SUCCESS == tph_poisson_sampler_create(&args, alloc, &sampler));
+    int32_t done = -1;
+    REQUIRE(TPH_POISSON_INVALID_ARGS == tph_poisson_sampler_step(&sampler, 1, &done));
+
+    for (const ptrdiff_t max_attempts : { ptrdiff_t{ 1 }, ptrdiff_t{ 7 }, ptrdiff_t{ 100 } }) {
+      REQUIRE(TPH_POISSON_SUCCESS == tph_poisson_sampler_begin(&sampler, args.seed));
+      REQUIRE(sampler.nsamples == 0);
+      REQUIRE(TPH_POISSON_INVALID_ARGS == tph_poisson_sampler_step(&sampler, -1, &done));
+      REQUIRE(TPH_POISSON_INVALID_ARGS == tph_poisson_sampler_step(&sampler, 1, nullptr));
+      ptrdiff_t nsteps = 0;
+      ptrdiff_t prev_nsamples = 0;
+      done = 0;
+      while (done == 0) {
+        REQUIRE(TPH_POISSON_SUCCESS == tph_poisson_sampler_step(&sampler, max_attempts, &done));
+        ++nsteps;
+        // Samples so far are a prefix of the final samples.
+        REQUIRE(sampler.nsamples >= prev_nsamples);
+        REQUIRE(SamePrefix(*expected, tph_poisson_sampler_get_samples(&sampler), sampler.nsamples));
+        prev_nsamples = sampler.nsamples;
+      }
+      REQUIRE(sampler.nsamples == expected->nsamples);
+      REQUIRE(nsteps > 1);
+
+      // Further steps do nothing.
+      done = 0;
+      REQUIRE(TPH_POISSON_SUCCESS == tph_poisson_sampler_step(&sampler, max_attempts, &done));
+      REQUIRE(done != 0);
+      REQUIRE(sampler.nsamples == expected->nsamples);
+    }
+
+    tph_poisson_sampler_destroy(&sampler);
+  };
+
+  require_same(1, 100, TPH_POISSON_CANDIDATES_REJECTION);
+  require_same(2, 20, TPH_POISSON_CANDIDATES_REJECTION);
+  require_same(2, 20, TPH_POISSON_CANDIDATES_ANGULAR);
+  require_same(3, 6, TPH_POISSON_CANDIDATES_REJECTION);
+
+  int32_t done = 0;
+  tph_poisson_sampler sampler = {};
+  REQUIRE(TPH_POISSON_INVALID_ARGS == tph_poisson_sampler_begin(&sampler, 0));
+  REQUIRE(TPH_POISSON_INVALID_ARGS == tph_poisson_sampler_begin(nullptr, 0));
+  REQUIRE(TPH_POISSON_INVALID_ARGS == tph_poisson_sampler_step(&sampler, 0, &done));
+  REQUIRE(TPH_POISSON_INVALID_ARGS == tph_poisson_sampler_step(nullptr, 0, &done));
+}
+
+// Verify that the samples of a tile do not depend on which tiles were sampled before it or on the
+// cache size, that samples stay inside their tile and that no two samples of adjacent tiles are
+// closer than the radius.
+static void TestTiler()
+{
+  constexpr tph_poisson_allocator *alloc = nullptr;
+  const auto require_seamless = [&](const int32_t ndims, const int64_t tiles_per_axis) {
+    tph_poisson_args args = {};
+    args.ndims = ndims;
+    args.radius = 1;
+    args.seed = UINT64_C(1981);
+    args.max_sample_attempts = UINT32_C(30);
+    args.tile_size = 5;
+
+    // All tiles in [-1, tiles_per_axis - 1) along each axis, in row-major order.
+    std::vector<std::vector<int64_t>> tiles;
+    std::vector<int64_t> tile(static_cast<size_t>(ndims), -1);
+    for (;;) {
+      tiles.push_back(tile);
+      int32_t i = 0;
+      while (i < ndims && ++tile[static_cast<size_t>(i)] == tiles_per_axis - 1) {
+        tile[static_cast<size_t>(i++)] = -1;
+      }
+      if (i == ndims) { break; }
+    }
+
+    // Sample tiles in order with a cache that only holds one tile, and in reverse order with the
+    // default cache size.
+    const auto sample_tiles = [&](const ptrdiff_t cache_size, const bool reverse) {
+      tph_poisson_tiler tiler = {};
+      REQUIRE(TPH_POISSON_SUCCESS == tph_poisson_tiler_create(&args, cache_size, alloc, &tiler));
+      REQUIRE(tiler.ndims == ndims);
+      REQUIRE(!(tiler.tile_size < args.tile_size) && !(tiler.tile_size > args.tile_size));
+      std::vector<std::vector<Real>> samples(tiles.size());
+      for (size_t n = 0; n < tiles.size(); ++n) {
+        const size_t t = reverse ? tiles.size() - 1 - n : n;
+        REQUIRE(TPH_POISSON_SUCCESS == tph_poisson_tiler_run(&tiler, tiles[t].data()));
+        REQUIRE(tiler.nsamples > 0);
+        const tph_poisson_real *p = tph_poisson_tiler_get_samples(&tiler);
+        samples[t].assign(p, p + tiler.nsamples * ndims);
+      }
+      tph_poisson_tiler_destroy(&tiler);
+      REQUIRE(tiler.internal == nullptr);
+      return samples;
+    };
+    const std::vector<std::vector<Real>> expected = sample_tiles(1, false);
+    REQUIRE(expected == sample_tiles(0, true));
+
+    // Samples are inside their tile, no two samples are closer than the radius.
+    std::vector<Real> all;
+    for (size_t t = 0; t < tiles.size(); ++t) {
+      for (size_t j = 0; j < expected[t].size(); ++j) {
+        const auto i = static_cast<size_t>(static_cast<int32_t>(j) % ndims);
+        REQUIRE(expected[t][j] >= static_cast<Real>(tiles[t][i]) * args.tile_size);
+        REQUIRE(expected[t][j] <= static_cast<Real>(tiles[t][i] + 1) * args.tile_size);
+      }
+      all.insert(all.end(), expected[t].begin(), expected[t].end());
+    }
+    const double r_sqr = static_cast<double>(args.radius) * static_cast<double>(args.radius);
+    const size_t nsamples = all.size() / static_cast<size_t>(ndims);
+    for (size_t j = 0; j < nsamples; ++j) {
+      for (size_t k = 0; k < j; ++k) {
+        double dist_sqr = 0;
+        for (size_t m = 0; m < static_cast<size_t>(ndims); ++m) {
+          const double d = static_cast<double>(all[j * static_cast<size_t>(ndims) + m])
+                           - static_cast<double>(all[k * static_cast<size_t>(ndims) + m]);
+          dist_sqr += d * d;
+        }
+        REQUIRE(dist_sqr > r_sqr);
+      }
+    }
+
+    // Another seed gives other samples.
+    args.seed = UINT64_C(42);
+    REQUIRE(expected != sample_tiles(0, false));
+  };
+
+  require_seamless(1, 5);
+  require_seamless(2, 3);
+  require_seamless(3, 2);
+
+  // Invalid arguments and uninitialized tilers.
+  tph_poisson_tiler tiler = {};
+  tph_poisson_args args = {};
+  args.ndims = 2;
+  args.radius = 1;
+  args.max_sample_attempts = UINT32_C(30);
+  REQUIRE(TPH_POISSON_INVALID_ARGS == tph_poisson_tiler_create(&args, -1, alloc, &tiler));
+  args.tile_size = static_cast<Real>(1.5); // Less than the outer annulus radius.
+  REQUIRE(TPH_POISSON_INVALID_ARGS == tph_poisson_tiler_create(&args, 0, alloc, &tiler));
+  args.tile_size = 0;
+  args.output_layout = TPH_POISSON_LAYOUT_SOA;
+  REQUIRE(TPH_POISSON_INVALID_ARGS == tph_poisson_tiler_create(&args, 0, alloc, &tiler));
+  args.output_layout = TPH_POISSON_LAYOUT_AOS;
+  REQUIRE(TPH_POISSON_INVALID_ARGS == tph_poisson_tiler_create(nullptr, 0, alloc, &tiler));
+  REQUIRE(TPH_POISSON_INVALID_ARGS == tph_poisson_tiler_create(&args, 0, alloc, nullptr));
+  REQUIRE(tiler.internal == nullptr);
+  const std::array<int64_t, 2> tile = { 0, 0 };
+  REQUIRE(TPH_POISSON_INVALID_ARGS == tph_poisson_tiler_run(&tiler, tile.data()));
+  REQUIRE(TPH_POISSON_INVALID_ARGS == tph_poisson_tiler_run(nullptr, tile.data()));
+  REQUIRE(tph_poisson_tiler_get_samples(&tiler) == nullptr);
+
+  REQUIRE(TPH_POISSON_SUCCESS == tph_poisson_tiler_create(&args, 0, alloc, &tiler));
+  const Real default_tile_size = 8 * 2 * args.radius;
+  REQUIRE(!(tiler.tile_size < default_tile_size) && !(tiler.tile_size > default_tile_size));
+  REQUIRE(TPH_POISSON_INVALID_ARGS == tph_poisson_tiler_run(&tiler, nullptr));
+  const std::array<int64_t, 2> edge_tile = { 0, std::numeric_limits<int64_t>::max() };
+  REQUIRE(TPH_POISSON_INVALID_ARGS == tph_poisson_tiler_run(&tiler, edge_tile.data()));
+  REQUIRE(TPH_POISSON_SUCCESS == tph_poisson_tiler_run(&tiler, tile.data()));
+  REQUIRE(tph_poisson_tiler_get_samples(&tiler) != nullptr);
+  tph_poisson_tiler_destroy(&tiler);
+  tph_poisson_tiler_destroy(&tiler);
+  tph_poisson_tiler_destroy(nullptr);
+}
+
 static void TestInvalidArgs()
 {
 // Work-around for MSVC compiler not being able to handle constexpr
@@ -324,6 +1402,91 @@ static void TestInvalidArgs()
     REQUIRE_F(TPH_POISSON_INVALID_ARGS == tph_poisson_create(&args, alloc, sampling.get()), func);
   }();
 
+  // Invalid candidate method.
+  [&] {
+    tph_poisson_args args = valid_args;
+    args.candidate_method = -1;
+    REQUIRE_F(TPH_POISSON_INVALID_ARGS == tph_poisson_create(&args, alloc, sampling.get()), func);
+
+    args.candidate_method = 1000;
+    REQUIRE_F(TPH_POISSON_INVALID_ARGS == tph_poisson_create(&args, alloc, sampling.get()), func);
+
+    // Polar candidates require 2 or 3 dimensions.
+    constexpr std::array<Real, 4> bounds_min_4d{ -10, -10, -10, -10 };
+    constexpr std::array<Real, 4> bounds_max_4d{ 10, 10, 10, 10 };
+    args.ndims = 4;
+    args.bounds_min = bounds_min_4d.data();
+    args.bounds_max = bounds_max_4d.data();
+    args.candidate_method = TPH_POISSON_CANDIDATES_POLAR;
+    REQUIRE_F(TPH_POISSON_INVALID_ARGS == tph_poisson_create(&args, alloc, sampling.get()), func);
+
+    // Angular candidates require 2 dimensions.
+    args.candidate_method = TPH_POISSON_CANDIDATES_ANGULAR;
+    REQUIRE_F(TPH_POISSON_INVALID_ARGS == tph_poisson_create(&args, alloc, sampling.get()), func);
+  }();
+
+  // Invalid annulus outer factor (zero is valid and selects the default).
+  [&] {
+    tph_poisson_args args = valid_args;
+    args.annulus_outer_factor = 1;
+    REQUIRE_F(TPH_POISSON_INVALID_ARGS == tph_poisson_create(&args, alloc, sampling.get()), func);
+
+    args.annulus_outer_factor = static_cast<Real>(0.5);
+    REQUIRE_F(TPH_POISSON_INVALID_ARGS == tph_poisson_create(&args, alloc, sampling.get()), func);
+
+    args.annulus_outer_factor = -2;
+    REQUIRE_F(TPH_POISSON_INVALID_ARGS == tph_poisson_create(&args, alloc, sampling.get()), func);
+
+    args.annulus_outer_factor = std::numeric_limits<Real>::quiet_NaN();
+    REQUIRE_F(TPH_POISSON_INVALID_ARGS == tph_poisson_create(&args, alloc, sampling.get()), func);
+  }();
+
+  // Invalid grid storage.
+  [&] {
+    tph_poisson_args args = valid_args;
+    args.grid_storage = -1;
+    REQUIRE_F(TPH_POISSON_INVALID_ARGS == tph_poisson_create(&args, alloc, sampling.get()), func);
+
+    args.grid_storage = 1000;
+    REQUIRE_F(TPH_POISSON_INVALID_ARGS == tph_poisson_create(&args, alloc, sampling.get()), func);
+  }();
+
+  // Invalid grid maximum dense size.
+  [&] {
+    tph_poisson_args args = valid_args;
+    args.grid_max_dense_size = -1;
+    REQUIRE_F(TPH_POISSON_INVALID_ARGS == tph_poisson_create(&args, alloc, sampling.get()), func);
+  }();
+
+  // Invalid grid order.
+  [&] {
+    tph_poisson_args args = valid_args;
+    args.grid_order = -1;
+    REQUIRE_F(TPH_POISSON_INVALID_ARGS == tph_poisson_create(&args, alloc, sampling.get()), func);
+
+    args.grid_order = 1000;
+    REQUIRE_F(TPH_POISSON_INVALID_ARGS == tph_poisson_create(&args, alloc, sampling.get()), func);
+
+    // Tiled grid order requires 2 or 3 dimensions.
+    constexpr std::array<Real, 4> bounds_min_4d{ -10, -10, -10, -10 };
+    constexpr std::array<Real, 4> bounds_max_4d{ 10, 10, 10, 10 };
+    args.ndims = 4;
+    args.bounds_min = bounds_min_4d.data();
+    args.bounds_max = bounds_max_4d.data();
+    args.grid_order = TPH_POISSON_GRID_ORDER_TILED;
+    REQUIRE_F(TPH_POISSON_INVALID_ARGS == tph_poisson_create(&args, alloc, sampling.get()), func);
+  }();
+
+  // Invalid pseudo-random number generator.
+  [&] {
+    tph_poisson_args args = valid_args;
+    args.prng = -1;
+    REQUIRE_F(TPH_POISSON_INVALID_ARGS == tph_poisson_create(&args, alloc, sampling.get()), func);
+
+    args.prng = 1000;
+    REQUIRE_F(TPH_POISSON_INVALID_ARGS == tph_poisson_create(&args, alloc, sampling.get()), func);
+  }();
+
   // bounds_min >= bounds_max
   [&] {
     tph_poisson_args args = valid_args;
@@ -469,6 +1632,51 @@ int main(int /*argc*/, char * /*argv*/[])
   std::printf("TestVaryingSeed...\n");
   TestVaryingSeed();
 
+  std::printf("TestCandidateMethods...\n");
+  TestCandidateMethods();
+
+  std::printf("TestGridLayout...\n");
+  TestGridLayout();
+
+  std::printf("TestGridOverflow...\n");
+  TestGridOverflow();
+
+  std::printf("TestCandidateBatch...\n");
+  TestCandidateBatch();
+
+  std::printf("TestPrng...\n");
+  TestPrng();
+
+  std::printf("TestParallel...\n");
+  TestParallel();
+
+  std::printf("TestSampler...\n");
+  TestSampler();
+
+  std::printf("TestCreateInto...\n");
+  TestCreateInto();
+
+  std::printf("TestEstimateSamples...\n");
+  TestEstimateSamples();
+
+  std::printf("TestCreateInArena...\n");
+  TestCreateInArena();
+
+  std::printf("TestOutputLayout...\n");
+  TestOutputLayout();
+
+  std::printf("TestQuantize...\n");
+  TestQuantize();
+
+  std::printf("TestCreateStream...\n");
+  TestCreateStream();
+
+  std::printf("TestSamplerStep...\n");
+  TestSamplerStep();
+
+  std::printf("TestTiler...\n");
+  TestTiler();
+
   std::printf("TestDestroy...\n");
   TestDestroy();
 
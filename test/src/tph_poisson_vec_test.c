@@ -12,6 +12,7 @@ typedef struct vec_test_alloc_ctx_
 {
   ptrdiff_t align_offset; /** [bytes] */
   int fail; /** When non-zero vec_test_malloc returns NULL. */
+  int realloc_calls;
 } vec_test_alloc_ctx;
 
 static void *vec_test_malloc(ptrdiff_t size, void *ctx)
@@ -32,6 +33,24 @@ static void vec_test_free(void *ptr, ptrdiff_t size, void *ctx)
   free((void *)((intptr_t)ptr - a_ctx->align_offset));
 }
 
+/* Moves the buffer to a new allocation with a different misalignment, so that elements must be
+ * moved to the aligned position afterwards. Assumes that there is a single live allocation. */
+static void *vec_test_realloc(void *ptr, ptrdiff_t size, ptrdiff_t new_size, void *ctx)
+{
+  vec_test_alloc_ctx *a_ctx = (vec_test_alloc_ctx *)ctx;
+  assert(ptr != NULL && new_size > 0);
+  if (a_ctx->fail != 0) { return NULL; }
+  const ptrdiff_t new_align_offset = (a_ctx->align_offset + 1) % (ptrdiff_t)sizeof(float);
+  void *new_ptr = malloc((size_t)(new_size + new_align_offset));
+  if (new_ptr == NULL) { return NULL; }
+  new_ptr = (void *)((intptr_t)new_ptr + new_align_offset);
+  memcpy(new_ptr, ptr, (size_t)(size < new_size ? size : new_size));
+  free((void *)((intptr_t)ptr - a_ctx->align_offset));
+  a_ctx->align_offset = new_align_offset;
+  ++a_ctx->realloc_calls;
+  return new_ptr;
+}
+
 #define VEC_TEST_SIZEOF(_X_) (ptrdiff_t)sizeof(_X_)
 #define VEC_TEST_ALIGNOF(_X_) (ptrdiff_t)alignof(_X_)
 
@@ -126,15 +145,18 @@ static void test_reserve(void)
       tph_poisson_vec vec;
       memset(&vec, 0, sizeof(tph_poisson_vec));
 
-      REQUIRE(tph_poisson_vec_reserve(
-                &vec, &alloc, /*new_cap=*/VEC_TEST_SIZEOF(values), VEC_TEST_ALIGNOF(float))
+      REQUIRE(tph_poisson_vec_reserve(&vec,
+                &alloc,
+                /*new_cap=*/VEC_TEST_SIZEOF(values),
+                VEC_TEST_ALIGNOF(float),
+                TPH_POISSON_ALLOC_OTHER)
               == TPH_POISSON_SUCCESS);
 
       REQUIRE(valid_invariants(&vec, VEC_TEST_ALIGNOF(float)));
       REQUIRE(tph_poisson_vec_size(&vec) == 0);
       REQUIRE(tph_poisson_vec_capacity(&vec) == VEC_TEST_SIZEOF(values) + extra_cap);
 
-      tph_poisson_vec_free(&vec, &alloc);
+      tph_poisson_vec_free(&vec, &alloc, TPH_POISSON_ALLOC_OTHER);
     }
 
     {
@@ -142,8 +164,11 @@ static void test_reserve(void)
       tph_poisson_vec vec;
       memset(&vec, 0, sizeof(tph_poisson_vec));
 
-      REQUIRE(tph_poisson_vec_reserve(
-                &vec, &alloc, /*new_cap=*/VEC_TEST_SIZEOF(float), VEC_TEST_ALIGNOF(float))
+      REQUIRE(tph_poisson_vec_reserve(&vec,
+                &alloc,
+                /*new_cap=*/VEC_TEST_SIZEOF(float),
+                VEC_TEST_ALIGNOF(float),
+                TPH_POISSON_ALLOC_OTHER)
               == TPH_POISSON_SUCCESS);
       uint8_t vec0[sizeof(tph_poisson_vec)];
       memcpy(vec0, &vec, sizeof(tph_poisson_vec));
@@ -151,13 +176,14 @@ static void test_reserve(void)
       REQUIRE(tph_poisson_vec_reserve(&vec,
                 &alloc,
                 /*new_cap=*/VEC_TEST_SIZEOF(float) / 2,
-                VEC_TEST_ALIGNOF(float))
+                VEC_TEST_ALIGNOF(float),
+                TPH_POISSON_ALLOC_OTHER)
               == TPH_POISSON_SUCCESS);
 
       REQUIRE(memcmp(vec0, &vec, sizeof(tph_poisson_vec)) == 0);
       REQUIRE(valid_invariants(&vec, VEC_TEST_ALIGNOF(float)));
 
-      tph_poisson_vec_free(&vec, &alloc);
+      tph_poisson_vec_free(&vec, &alloc, TPH_POISSON_ALLOC_OTHER);
     }
 
     {
@@ -166,14 +192,19 @@ static void test_reserve(void)
       tph_poisson_vec vec;
       memset(&vec, 0, sizeof(tph_poisson_vec));
 
-      REQUIRE(tph_poisson_vec_append(
-                &vec, &alloc, values, VEC_TEST_SIZEOF(values), VEC_TEST_ALIGNOF(float))
+      REQUIRE(tph_poisson_vec_append(&vec,
+                &alloc,
+                values,
+                VEC_TEST_SIZEOF(values),
+                VEC_TEST_ALIGNOF(float),
+                TPH_POISSON_ALLOC_OTHER)
               == TPH_POISSON_SUCCESS);
 
       REQUIRE(tph_poisson_vec_reserve(&vec,
                 &alloc,
                 /*new_cap=*/VEC_TEST_SIZEOF(values) + 3 * VEC_TEST_SIZEOF(values),
-                VEC_TEST_ALIGNOF(float))
+                VEC_TEST_ALIGNOF(float),
+                TPH_POISSON_ALLOC_OTHER)
               == TPH_POISSON_SUCCESS);
 
       REQUIRE(valid_invariants(&vec, VEC_TEST_ALIGNOF(float)));
@@ -181,7 +212,7 @@ static void test_reserve(void)
               == VEC_TEST_SIZEOF(values) + 3 * VEC_TEST_SIZEOF(values) + extra_cap);
       REQUIRE(memcmp((const void *)vec.begin, (const void *)values, VEC_TEST_SIZEOF(values)) == 0);
 
-      tph_poisson_vec_free(&vec, &alloc);
+      tph_poisson_vec_free(&vec, &alloc, TPH_POISSON_ALLOC_OTHER);
     }
 
     {
@@ -189,8 +220,12 @@ static void test_reserve(void)
       tph_poisson_vec vec;
       memset(&vec, 0, sizeof(tph_poisson_vec));
 
-      tph_poisson_vec_append(
-        &vec, &alloc, values, VEC_TEST_SIZEOF(values), VEC_TEST_ALIGNOF(float));
+      tph_poisson_vec_append(&vec,
+        &alloc,
+        values,
+        VEC_TEST_SIZEOF(values),
+        VEC_TEST_ALIGNOF(float),
+        TPH_POISSON_ALLOC_OTHER);
       tph_poisson_vec_erase_swap(&vec, 0, VEC_TEST_SIZEOF(values));
       REQUIRE(valid_invariants(&vec, VEC_TEST_ALIGNOF(float)));
       REQUIRE(tph_poisson_vec_size(&vec) == 0);
@@ -199,11 +234,12 @@ static void test_reserve(void)
       REQUIRE(tph_poisson_vec_reserve(&vec,
                 &alloc,
                 /*new_cap=*/2 * VEC_TEST_SIZEOF(values),
-                VEC_TEST_ALIGNOF(float))
+                VEC_TEST_ALIGNOF(float),
+                TPH_POISSON_ALLOC_OTHER)
               == TPH_POISSON_SUCCESS);
 
       REQUIRE(valid_invariants(&vec, VEC_TEST_ALIGNOF(float)));
-      tph_poisson_vec_free(&vec, &alloc);
+      tph_poisson_vec_free(&vec, &alloc, TPH_POISSON_ALLOC_OTHER);
     }
 
     {
@@ -215,7 +251,8 @@ static void test_reserve(void)
       REQUIRE(tph_poisson_vec_reserve(&vec,
                 &alloc,
                 /*new_cap=*/VEC_TEST_SIZEOF(float),
-                VEC_TEST_ALIGNOF(float))
+                VEC_TEST_ALIGNOF(float),
+                TPH_POISSON_ALLOC_OTHER)
               == TPH_POISSON_BAD_ALLOC);
       alloc_ctx.fail = 0;
 
@@ -241,15 +278,19 @@ static void test_append(void)
       tph_poisson_vec vec;
       memset(&vec, 0, sizeof(tph_poisson_vec));
 
-      REQUIRE(tph_poisson_vec_append(
-                &vec, &alloc, values, VEC_TEST_SIZEOF(values), VEC_TEST_ALIGNOF(float))
+      REQUIRE(tph_poisson_vec_append(&vec,
+                &alloc,
+                values,
+                VEC_TEST_SIZEOF(values),
+                VEC_TEST_ALIGNOF(float),
+                TPH_POISSON_ALLOC_OTHER)
               == TPH_POISSON_SUCCESS);
 
       REQUIRE(valid_invariants(&vec, VEC_TEST_ALIGNOF(float)));
       REQUIRE(tph_poisson_vec_size(&vec) == VEC_TEST_SIZEOF(values));
       REQUIRE(memcmp((const void *)vec.begin, (const void *)values, sizeof(values)) == 0);
 
-      tph_poisson_vec_free(&vec, &alloc);
+      tph_poisson_vec_free(&vec, &alloc, TPH_POISSON_ALLOC_OTHER);
     }
 
     {
@@ -258,18 +299,23 @@ static void test_append(void)
       memset(&vec, 0, sizeof(tph_poisson_vec));
 
       REQUIRE(
-        tph_poisson_vec_reserve(&vec, &alloc, VEC_TEST_SIZEOF(values), VEC_TEST_ALIGNOF(float))
+        tph_poisson_vec_reserve(
+          &vec, &alloc, VEC_TEST_SIZEOF(values), VEC_TEST_ALIGNOF(float), TPH_POISSON_ALLOC_OTHER)
         == TPH_POISSON_SUCCESS);
 
-      REQUIRE(tph_poisson_vec_append(
-                &vec, &alloc, values, 2 * VEC_TEST_SIZEOF(float), VEC_TEST_ALIGNOF(float))
+      REQUIRE(tph_poisson_vec_append(&vec,
+                &alloc,
+                values,
+                2 * VEC_TEST_SIZEOF(float),
+                VEC_TEST_ALIGNOF(float),
+                TPH_POISSON_ALLOC_OTHER)
               == TPH_POISSON_SUCCESS);
 
       REQUIRE(valid_invariants(&vec, VEC_TEST_ALIGNOF(float)));
       REQUIRE(tph_poisson_vec_size(&vec) == 2 * VEC_TEST_SIZEOF(float));
       REQUIRE(memcmp((const void *)vec.begin, (const void *)values, 2 * sizeof(float)) == 0);
 
-      tph_poisson_vec_free(&vec, &alloc);
+      tph_poisson_vec_free(&vec, &alloc, TPH_POISSON_ALLOC_OTHER);
     }
 
     {
@@ -277,19 +323,27 @@ static void test_append(void)
       tph_poisson_vec vec;
       memset(&vec, 0, sizeof(tph_poisson_vec));
 
-      REQUIRE(tph_poisson_vec_append(
-                &vec, &alloc, values, 2 * VEC_TEST_SIZEOF(float), VEC_TEST_ALIGNOF(float))
+      REQUIRE(tph_poisson_vec_append(&vec,
+                &alloc,
+                values,
+                2 * VEC_TEST_SIZEOF(float),
+                VEC_TEST_ALIGNOF(float),
+                TPH_POISSON_ALLOC_OTHER)
               == TPH_POISSON_SUCCESS);
 
-      REQUIRE(tph_poisson_vec_append(
-                &vec, &alloc, &values[2], 2 * VEC_TEST_SIZEOF(float), VEC_TEST_ALIGNOF(float))
+      REQUIRE(tph_poisson_vec_append(&vec,
+                &alloc,
+                &values[2],
+                2 * VEC_TEST_SIZEOF(float),
+                VEC_TEST_ALIGNOF(float),
+                TPH_POISSON_ALLOC_OTHER)
               == TPH_POISSON_SUCCESS);
 
       REQUIRE(valid_invariants(&vec, VEC_TEST_ALIGNOF(float)));
       REQUIRE(tph_poisson_vec_size(&vec) == 4 * VEC_TEST_SIZEOF(float));
       REQUIRE(memcmp((const void *)vec.begin, (const void *)values, 4 * sizeof(float)) == 0);
 
-      tph_poisson_vec_free(&vec, &alloc);
+      tph_poisson_vec_free(&vec, &alloc, TPH_POISSON_ALLOC_OTHER);
     }
 
     {
@@ -297,8 +351,12 @@ static void test_append(void)
       tph_poisson_vec vec;
       memset(&vec, 0, sizeof(tph_poisson_vec));
 
-      tph_poisson_vec_append(
-        &vec, &alloc, values, VEC_TEST_SIZEOF(values), VEC_TEST_ALIGNOF(float));
+      tph_poisson_vec_append(&vec,
+        &alloc,
+        values,
+        VEC_TEST_SIZEOF(values),
+        VEC_TEST_ALIGNOF(float),
+        TPH_POISSON_ALLOC_OTHER);
       tph_poisson_vec_erase_swap(&vec, 0, VEC_TEST_SIZEOF(values));
       REQUIRE(valid_invariants(&vec, VEC_TEST_ALIGNOF(float)));
       REQUIRE(tph_poisson_vec_size(&vec) == 0);
@@ -310,12 +368,16 @@ static void test_append(void)
       };
       /* clang-format on */
 
-      REQUIRE(tph_poisson_vec_append(
-                &vec, &alloc, values2, VEC_TEST_SIZEOF(values2), VEC_TEST_ALIGNOF(float))
+      REQUIRE(tph_poisson_vec_append(&vec,
+                &alloc,
+                values2,
+                VEC_TEST_SIZEOF(values2),
+                VEC_TEST_ALIGNOF(float),
+                TPH_POISSON_ALLOC_OTHER)
               == TPH_POISSON_SUCCESS);
 
       REQUIRE(valid_invariants(&vec, VEC_TEST_ALIGNOF(float)));
-      tph_poisson_vec_free(&vec, &alloc);
+      tph_poisson_vec_free(&vec, &alloc, TPH_POISSON_ALLOC_OTHER);
     }
 
     {
@@ -323,12 +385,20 @@ static void test_append(void)
       tph_poisson_vec vec;
       memset(&vec, 0, sizeof(tph_poisson_vec));
 
-      REQUIRE(tph_poisson_vec_append(
-                &vec, &alloc, values, 2 * VEC_TEST_SIZEOF(float), VEC_TEST_ALIGNOF(float))
+      REQUIRE(tph_poisson_vec_append(&vec,
+                &alloc,
+                values,
+                2 * VEC_TEST_SIZEOF(float),
+                VEC_TEST_ALIGNOF(float),
+                TPH_POISSON_ALLOC_OTHER)
               == TPH_POISSON_SUCCESS);
 
-      REQUIRE(tph_poisson_vec_append(
-                &vec, &alloc, values, VEC_TEST_SIZEOF(values), VEC_TEST_ALIGNOF(float))
+      REQUIRE(tph_poisson_vec_append(&vec,
+                &alloc,
+                values,
+                VEC_TEST_SIZEOF(values),
+                VEC_TEST_ALIGNOF(float),
+                TPH_POISSON_ALLOC_OTHER)
               == TPH_POISSON_SUCCESS);
 
       REQUIRE(valid_invariants(&vec, VEC_TEST_ALIGNOF(float)));
@@ -339,7 +409,7 @@ static void test_append(void)
                 VEC_TEST_SIZEOF(values))
               == 0);
 
-      tph_poisson_vec_free(&vec, &alloc);
+      tph_poisson_vec_free(&vec, &alloc, TPH_POISSON_ALLOC_OTHER);
     }
 
     {
@@ -348,8 +418,12 @@ static void test_append(void)
       memset(&vec, 0, sizeof(tph_poisson_vec));
 
       alloc_ctx.fail = 1;
-      REQUIRE(tph_poisson_vec_append(
-                &vec, &alloc, values, VEC_TEST_SIZEOF(values), VEC_TEST_ALIGNOF(float))
+      REQUIRE(tph_poisson_vec_append(&vec,
+                &alloc,
+                values,
+                VEC_TEST_SIZEOF(values),
+                VEC_TEST_ALIGNOF(float),
+                TPH_POISSON_ALLOC_OTHER)
               == TPH_POISSON_BAD_ALLOC);
       alloc_ctx.fail = 0;
 
@@ -374,7 +448,12 @@ static void test_erase_swap(void)
     tph_poisson_vec vec;
     memset(&vec, 0, sizeof(tph_poisson_vec));
     REQUIRE(
-      tph_poisson_vec_append(&vec, &alloc, values, VEC_TEST_SIZEOF(values), VEC_TEST_ALIGNOF(float))
+      tph_poisson_vec_append(&vec,
+        &alloc,
+        values,
+        VEC_TEST_SIZEOF(values),
+        VEC_TEST_ALIGNOF(float),
+        TPH_POISSON_ALLOC_OTHER)
       == TPH_POISSON_SUCCESS);
 
     const ptrdiff_t mem_size0 = vec.mem_size;
@@ -440,7 +519,7 @@ static void test_erase_swap(void)
     REQUIRE((intptr_t)vec.begin == (intptr_t)begin0);
     REQUIRE((intptr_t)vec.begin == (intptr_t)vec.end);
 
-    tph_poisson_vec_free(&vec, &alloc);
+    tph_poisson_vec_free(&vec, &alloc, TPH_POISSON_ALLOC_OTHER);
   }
 }
 
@@ -461,7 +540,8 @@ static void test_shrink_to_fit(void)
       tph_poisson_vec vec;
       memset(&vec, 0, sizeof(tph_poisson_vec));
 
-      REQUIRE(tph_poisson_vec_shrink_to_fit(&vec, &alloc, VEC_TEST_ALIGNOF(float))
+      REQUIRE(tph_poisson_vec_shrink_to_fit(
+                &vec, &alloc, VEC_TEST_ALIGNOF(float), TPH_POISSON_ALLOC_OTHER)
               == TPH_POISSON_SUCCESS);
 
       REQUIRE(valid_invariants(&vec, VEC_TEST_ALIGNOF(float)));
@@ -475,10 +555,12 @@ static void test_shrink_to_fit(void)
       memset(&vec, 0, sizeof(tph_poisson_vec));
 
       REQUIRE(
-        tph_poisson_vec_reserve(&vec, &alloc, VEC_TEST_SIZEOF(values), VEC_TEST_ALIGNOF(float))
+        tph_poisson_vec_reserve(
+          &vec, &alloc, VEC_TEST_SIZEOF(values), VEC_TEST_ALIGNOF(float), TPH_POISSON_ALLOC_OTHER)
         == TPH_POISSON_SUCCESS);
 
-      REQUIRE(tph_poisson_vec_shrink_to_fit(&vec, &alloc, VEC_TEST_ALIGNOF(float))
+      REQUIRE(tph_poisson_vec_shrink_to_fit(
+                &vec, &alloc, VEC_TEST_ALIGNOF(float), TPH_POISSON_ALLOC_OTHER)
               == TPH_POISSON_SUCCESS);
 
       REQUIRE(valid_invariants(&vec, VEC_TEST_ALIGNOF(float)));
@@ -492,12 +574,20 @@ static void test_shrink_to_fit(void)
       memset(&vec, 0, sizeof(tph_poisson_vec));
 
       /* Append some values to an empty vector. */
-      REQUIRE(tph_poisson_vec_append(
-                &vec, &alloc, values, VEC_TEST_SIZEOF(values), VEC_TEST_ALIGNOF(float))
+      REQUIRE(tph_poisson_vec_append(&vec,
+                &alloc,
+                values,
+                VEC_TEST_SIZEOF(values),
+                VEC_TEST_ALIGNOF(float),
+                TPH_POISSON_ALLOC_OTHER)
               == TPH_POISSON_SUCCESS);
       if (extra_cap == VEC_TEST_SIZEOF(float)) {
-        REQUIRE(tph_poisson_vec_append(
-                  &vec, &alloc, values, VEC_TEST_SIZEOF(float), VEC_TEST_ALIGNOF(float))
+        REQUIRE(tph_poisson_vec_append(&vec,
+                  &alloc,
+                  values,
+                  VEC_TEST_SIZEOF(float),
+                  VEC_TEST_ALIGNOF(float),
+                  TPH_POISSON_ALLOC_OTHER)
                 == TPH_POISSON_SUCCESS);
       }
 
@@ -505,14 +595,15 @@ static void test_shrink_to_fit(void)
       tph_poisson_vec vec0;
       memcpy(&vec0, &vec, sizeof(tph_poisson_vec));
 
-      REQUIRE(tph_poisson_vec_shrink_to_fit(&vec, &alloc, VEC_TEST_ALIGNOF(float))
+      REQUIRE(tph_poisson_vec_shrink_to_fit(
+                &vec, &alloc, VEC_TEST_ALIGNOF(float), TPH_POISSON_ALLOC_OTHER)
               == TPH_POISSON_SUCCESS);
 
       REQUIRE(valid_invariants(&vec, VEC_TEST_ALIGNOF(float)));
       REQUIRE(memcmp(&vec, &vec0, sizeof(tph_poisson_vec)) == 0);
       REQUIRE(memcmp((const void *)vec.begin, (const void *)values, VEC_TEST_SIZEOF(values)) == 0);
 
-      tph_poisson_vec_free(&vec, &alloc);
+      tph_poisson_vec_free(&vec, &alloc, TPH_POISSON_ALLOC_OTHER);
     }
 
     {
@@ -524,24 +615,33 @@ static void test_shrink_to_fit(void)
       /* Reserve a large capacity and append only a few values so that shrinking removes
        * extraneous capacity (which triggers reallocation). */
       REQUIRE(
-        tph_poisson_vec_reserve(&vec, &alloc, 20 * VEC_TEST_SIZEOF(values), VEC_TEST_ALIGNOF(float))
+        tph_poisson_vec_reserve(&vec,
+          &alloc,
+          20 * VEC_TEST_SIZEOF(values),
+          VEC_TEST_ALIGNOF(float),
+          TPH_POISSON_ALLOC_OTHER)
         == TPH_POISSON_SUCCESS);
-      REQUIRE(tph_poisson_vec_append(
-                &vec, &alloc, values, VEC_TEST_SIZEOF(values), VEC_TEST_ALIGNOF(float))
+      REQUIRE(tph_poisson_vec_append(&vec,
+                &alloc,
+                values,
+                VEC_TEST_SIZEOF(values),
+                VEC_TEST_ALIGNOF(float),
+                TPH_POISSON_ALLOC_OTHER)
               == TPH_POISSON_SUCCESS);
       REQUIRE(valid_invariants(&vec, VEC_TEST_ALIGNOF(float)));
       REQUIRE(tph_poisson_vec_size(&vec) == VEC_TEST_SIZEOF(values));
       REQUIRE(tph_poisson_vec_capacity(&vec) == 20 * VEC_TEST_SIZEOF(values) + extra_cap);
 
       /* Shrink capacity. */
-      REQUIRE(tph_poisson_vec_shrink_to_fit(&vec, &alloc, VEC_TEST_ALIGNOF(float))
+      REQUIRE(tph_poisson_vec_shrink_to_fit(
+                &vec, &alloc, VEC_TEST_ALIGNOF(float), TPH_POISSON_ALLOC_OTHER)
               == TPH_POISSON_SUCCESS);
 
       REQUIRE(valid_invariants(&vec, VEC_TEST_ALIGNOF(float)));
       REQUIRE(tph_poisson_vec_size(&vec) == VEC_TEST_SIZEOF(values));
       REQUIRE(tph_poisson_vec_capacity(&vec) == VEC_TEST_SIZEOF(values) + extra_cap);
       REQUIRE(memcmp((const void *)vec.begin, (const void *)values, sizeof(values)) == 0);
-      tph_poisson_vec_free(&vec, &alloc);
+      tph_poisson_vec_free(&vec, &alloc, TPH_POISSON_ALLOC_OTHER);
     }
 
     {
@@ -552,19 +652,120 @@ static void test_shrink_to_fit(void)
       /* Reserve a large capacity and append only a few values so that shrinking removes
        * extraneous capacity (which triggers reallocation). */
       REQUIRE(
-        tph_poisson_vec_reserve(&vec, &alloc, VEC_TEST_SIZEOF(values), VEC_TEST_ALIGNOF(float))
+        tph_poisson_vec_reserve(
+          &vec, &alloc, VEC_TEST_SIZEOF(values), VEC_TEST_ALIGNOF(float), TPH_POISSON_ALLOC_OTHER)
         == TPH_POISSON_SUCCESS);
-      REQUIRE(tph_poisson_vec_append(
-                &vec, &alloc, values, VEC_TEST_SIZEOF(values) / 2, VEC_TEST_ALIGNOF(float))
+      REQUIRE(tph_poisson_vec_append(&vec,
+                &alloc,
+                values,
+                VEC_TEST_SIZEOF(values) / 2,
+                VEC_TEST_ALIGNOF(float),
+                TPH_POISSON_ALLOC_OTHER)
               == TPH_POISSON_SUCCESS);
 
       /* Check that caller is notified when reallocation fails. */
       alloc_ctx.fail = 1;
-      REQUIRE(tph_poisson_vec_shrink_to_fit(&vec, &alloc, VEC_TEST_ALIGNOF(float))
+      REQUIRE(tph_poisson_vec_shrink_to_fit(
+                &vec, &alloc, VEC_TEST_ALIGNOF(float), TPH_POISSON_ALLOC_OTHER)
+              == TPH_POISSON_BAD_ALLOC);
+      alloc_ctx.fail = 0;
+
+      tph_poisson_vec_free(&vec, &alloc, TPH_POISSON_ALLOC_OTHER);
+    }
+  }
+}
+
+static void test_realloc(void)
+{
+  for (size_t i = 0; i < sizeof(float); ++i) {
+    /* Create an allocator that returns misaligned memory (except when i == 0), and where each
+     * reallocation changes the misalignment. */
+    vec_test_alloc_ctx alloc_ctx = { .align_offset = (ptrdiff_t)i };
+    tph_poisson_allocator alloc = { .malloc = vec_test_malloc,
+      .free = vec_test_free,
+      .ctx = &alloc_ctx,
+      .realloc = vec_test_realloc };
+    const float values[] = { 0.F, 1.F, 13.F, 42.F, 33.F, 18.F, -34.F };
+
+    {
+      /* Reserve on zero-initialized vector uses malloc, since there is no buffer to resize. */
+      tph_poisson_vec vec;
+      memset(&vec, 0, sizeof(tph_poisson_vec));
+
+      REQUIRE(tph_poisson_vec_reserve(&vec,
+                &alloc,
+                /*new_cap=*/VEC_TEST_SIZEOF(values),
+                VEC_TEST_ALIGNOF(float),
+                TPH_POISSON_ALLOC_OTHER)
+              == TPH_POISSON_SUCCESS);
+      REQUIRE(alloc_ctx.realloc_calls == 0);
+      REQUIRE(valid_invariants(&vec, VEC_TEST_ALIGNOF(float)));
+
+      /* Growing a non-empty vector resizes the existing buffer and keeps elements intact. */
+      REQUIRE(tph_poisson_vec_append(&vec,
+                &alloc,
+                values,
+                VEC_TEST_SIZEOF(values),
+                VEC_TEST_ALIGNOF(float),
+                TPH_POISSON_ALLOC_OTHER)
+              == TPH_POISSON_SUCCESS);
+      REQUIRE(tph_poisson_vec_reserve(&vec,
+                &alloc,
+                /*new_cap=*/3 * VEC_TEST_SIZEOF(values),
+                VEC_TEST_ALIGNOF(float),
+                TPH_POISSON_ALLOC_OTHER)
+              == TPH_POISSON_SUCCESS);
+      REQUIRE(alloc_ctx.realloc_calls == 1);
+      REQUIRE(valid_invariants(&vec, VEC_TEST_ALIGNOF(float)));
+      REQUIRE(tph_poisson_vec_capacity(&vec) >= 3 * VEC_TEST_SIZEOF(values));
+      REQUIRE(tph_poisson_vec_size(&vec) == VEC_TEST_SIZEOF(values));
+      REQUIRE(memcmp((const void *)vec.begin, (const void *)values, sizeof(values)) == 0);
+
+      /* Append until the vector grows a few times. */
+      for (int j = 0; j < 8; ++j) {
+        REQUIRE(tph_poisson_vec_append(&vec,
+                  &alloc,
+                  values,
+                  VEC_TEST_SIZEOF(values),
+                  VEC_TEST_ALIGNOF(float),
+                  TPH_POISSON_ALLOC_OTHER)
+                == TPH_POISSON_SUCCESS);
+        REQUIRE(valid_invariants(&vec, VEC_TEST_ALIGNOF(float)));
+      }
+      REQUIRE(alloc_ctx.realloc_calls > 1);
+      REQUIRE(tph_poisson_vec_size(&vec) == 9 * VEC_TEST_SIZEOF(values));
+      for (int j = 0; j < 9; ++j) {
+        REQUIRE(memcmp((const void *)((const float *)vec.begin + j * (ptrdiff_t)7),
+                  (const void *)values,
+                  sizeof(values))
+                == 0);
+      }
+
+      /* Shrinking trims the existing buffer. */
+      const int realloc_calls = alloc_ctx.realloc_calls;
+      tph_poisson_vec_erase_swap(&vec, 0, 8 * VEC_TEST_SIZEOF(values));
+      REQUIRE(tph_poisson_vec_shrink_to_fit(
+                &vec, &alloc, VEC_TEST_ALIGNOF(float), TPH_POISSON_ALLOC_OTHER)
+              == TPH_POISSON_SUCCESS);
+      REQUIRE(alloc_ctx.realloc_calls == realloc_calls + 1);
+      REQUIRE(valid_invariants(&vec, VEC_TEST_ALIGNOF(float)));
+      REQUIRE(tph_poisson_vec_size(&vec) == VEC_TEST_SIZEOF(values));
+      REQUIRE(memcmp((const void *)vec.begin, (const void *)values, sizeof(values)) == 0);
+
+      /* Failed reallocation leaves the vector intact. */
+      alloc_ctx.fail = 1;
+      REQUIRE(tph_poisson_vec_reserve(&vec,
+                &alloc,
+                /*new_cap=*/3 * VEC_TEST_SIZEOF(values),
+                VEC_TEST_ALIGNOF(float),
+                TPH_POISSON_ALLOC_OTHER)
               == TPH_POISSON_BAD_ALLOC);
       alloc_ctx.fail = 0;
+      REQUIRE(valid_invariants(&vec, VEC_TEST_ALIGNOF(float)));
+      REQUIRE(tph_poisson_vec_size(&vec) == VEC_TEST_SIZEOF(values));
+      REQUIRE(memcmp((const void *)vec.begin, (const void *)values, sizeof(values)) == 0);
 
-      tph_poisson_vec_free(&vec, &alloc);
+      tph_poisson_vec_free(&vec, &alloc, TPH_POISSON_ALLOC_OTHER);
     }
   }
 }
@@ -586,5 +787,8 @@ int main(int argc, char *argv[])
   printf("test_shrink_to_fit...\n");
   test_shrink_to_fit();
 
+  printf("test_realloc...\n");
+  test_realloc();
+
   return EXIT_SUCCESS;
 }